@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 批量模式
+ *
+ * 各任务程序除了 `<input> <output>` 之外，也接受 `@<清单>` 形式的命令行。清单
+ * 每行是以空白分隔的一对输入、输出路径，空行和以 # 开头的行被忽略。清单里的
+ * 文件分给一组工作线程处理，每个文件都有自己的 Obj::Mgr 等状态，这样一个进程
+ * 就能跑满所有核，省下逐个启动进程、加载 libLLVM.so 的开销。
+ *
+ * 线程数默认等于核数，可由环境变量 YATCC_JOBS 指定。
+ */
+namespace manifest {
+
+/// 清单中的一项
+struct Entry
+{
+  std::string mInput, mOutput;
+};
+
+/// 命令行是否是 `<程序> @<清单>` 的形式
+inline bool
+is_manifest(int argc, char* argv[])
+{
+  return argc == 2 && argv[1][0] == '@';
+}
+
+/// 读取清单文件 \p path ，打不开或格式有误时返回 false
+inline bool
+read(const char* path, std::vector<Entry>& entries)
+{
+  std::ifstream in(path);
+  if (!in)
+    return false;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    Entry entry;
+    if (!(fields >> entry.mInput) || entry.mInput[0] == '#')
+      continue;
+    if (!(fields >> entry.mOutput))
+      return false;
+    entries.push_back(std::move(entry));
+  }
+  return true;
+}
+
+/// 工作线程数
+inline unsigned
+num_jobs()
+{
+  if (auto env = std::getenv("YATCC_JOBS")) {
+    auto n = std::atoi(env);
+    if (n > 0)
+      return n;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * 用 \p jobs 个线程对每一项调用 \p fn(entry)，返回值的含义同单个文件时
+ * 进程的退出码，非零即失败；抛出的异常也算作失败，各阶段的 ABORT 和 ASSERT
+ * 抛出的 Fatal 也是如此，一个文件出错不影响清单里的其它文件。段错误这类崩溃
+ * 仍会中止整个进程。各项按清单顺序被取走，完成的顺序不定。返回失败的项数。
+ */
+template<typename Fn>
+std::size_t
+run(const std::vector<Entry>& entries, Fn&& fn, unsigned jobs)
+{
+  std::atomic<std::size_t> next{ 0 }, failed{ 0 };
+  std::mutex errMtx;
+
+  auto work = [&] {
+    for (std::size_t i; (i = next++) < entries.size();) {
+      int ret;
+      std::string what;
+      try {
+        ret = fn(entries[i]);
+      } catch (const std::exception& e) {
+        ret = -1, what = e.what();
+      }
+      if (ret != 0) {
+        ++failed;
+        std::lock_guard<std::mutex> lock(errMtx);
+        std::cerr << "失败[" << ret << "]：" << entries[i].mInput << ' '
+                  << what << std::endl;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; ++i)
+    threads.emplace_back(work);
+  work(); // 主线程也干活
+  for (auto& t : threads)
+    t.join();
+  return failed;
+}
+
+/// 处理 `@<清单>` 形式的命令行 \p arg ，返回进程的退出码
+template<typename Fn>
+int
+main(const char* arg, Fn&& fn, unsigned jobs = num_jobs())
+{
+  std::vector<Entry> entries;
+  if (!read(arg + 1, entries)) {
+    std::cout << "Error: unable to read manifest: " << arg + 1 << '\n';
+    return -2;
+  }
+
+  jobs = std::max<std::size_t>(1, std::min<std::size_t>(jobs, entries.size()));
+  auto since = std::chrono::steady_clock::now();
+  auto failed = run(entries, fn, jobs);
+  std::chrono::duration<double, std::milli> ms =
+    std::chrono::steady_clock::now() - since;
+  std::cout << "批量处理 " << entries.size() << " 个文件，失败 " << failed
+            << " 个，线程 " << jobs << " 个，耗时 " << ms.count() << " ms"
+            << std::endl;
+  return failed == 0 ? 0 : 1;
+}
+
+} // namespace manifest
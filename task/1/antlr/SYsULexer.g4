@@ -71,16 +71,18 @@ OctalDigit
     ;
 
 
+// 以下三种词法单元放在隐藏通道里，不输出，但 main.cpp 靠它们维护位置信息
+
 // 预处理信息处理，可以从预处理信息中获得文件名以及行号
 // 预处理信息前面的数组即行号
 LineAfterPreprocessing
     :   '#' Whitespace* ~[\r\n]*
-        -> skip
+        -> channel(HIDDEN)
     ;
 
 Whitespace
     :   [ \t]+
-        -> skip
+        -> channel(HIDDEN)
     ;
 
 // 换行符号，可以利用这个信息来更新行号
@@ -88,6 +90,6 @@ Newline
     :   (   '\r' '\n'?
         |   '\n'
         )
-        -> skip
+        -> channel(HIDDEN)
     ;
 
@@ -1,94 +1,165 @@
 #include "SYsULexer.h" // 确保这里的头文件名与您生成的词法分析器匹配
+#include "Manifest.hpp"
+#include "TokenKinds.hpp"
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
-
-// 映射定义，将ANTLR的tokenTypeName映射到clang的格式
-std::unordered_map<std::string, std::string> tokenTypeMapping = {
-  { "Int", "int" },
-  { "Identifier", "identifier" },
-  { "LeftParen", "l_paren" },
-  { "RightParen", "r_paren" },
-  { "RightBrace", "r_brace" },
-  { "LeftBrace", "l_brace" },
-  { "LeftBracket", "l_square" },
-  { "RightBracket", "r_square" },
-  { "Constant", "numeric_constant" },
-  { "Return", "return" },
-  { "Semi", "semi" },
-  { "EOF", "eof" },
-  { "Equal", "equal" },
-  { "Plus", "plus" },
-  { "Comma", "comma" },
+#include <vector>
+
+// 没有固定写法的词法单元，将 ANTLR 的 tokenTypeName 映射到 clang 的名字；关键字
+// 和标点则按文法里的字面写法查 TokenKinds.hpp，不必在这里列出
+const std::pair<std::string_view, tok::Kind> kTokenTypeMapping[] = {
+  { "Identifier", tok::Kind::kIdentifier },
+  { "Constant", tok::Kind::kNumericConstant },
 
   // 在这里继续添加其他映射
 };
 
-void
-print_token(const antlr4::Token* token,
-            const antlr4::CommonTokenStream& tokens,
-            std::ofstream& outFile,
-            const antlr4::Lexer& lexer)
+/// 按词号下标排好的 clang 名字，开始扫描前构造一次，之后每个词法单元只需查表
+std::vector<std::string>
+token_names(const antlr4::Vocabulary& vocabulary)
 {
-  auto& vocabulary = lexer.getVocabulary();
+  std::vector<std::string> names(vocabulary.getMaxTokenType() + 1);
+  for (std::size_t type = 0; type < names.size(); ++type) {
+    // 字面名字带单引号，如 'int'
+    auto literal = vocabulary.getLiteralName(type);
+    auto kind = tok::Kind::kINVALID;
+    if (literal.size() >= 2)
+      kind = tok::from_spelling(
+        std::string_view(literal).substr(1, literal.size() - 2));
+
+    auto symbolic = vocabulary.getSymbolicName(type);
+    for (auto&& [antlrName, clangKind] : kTokenTypeMapping)
+      if (antlrName == symbolic)
+        kind = clangKind;
+
+    if (kind != tok::Kind::kINVALID)
+      names[type] = tok::name(kind);
+    else if (!symbolic.empty())
+      names[type] = std::move(symbolic); // 没有映射的保留 ANTLR 的名字
+    else
+      names[type] = "<UNKNOWN>";
+  }
+  return names;
+}
 
-  auto tokenTypeName =
-    std::string(vocabulary.getSymbolicName(token->getType()));
+/// 扫描到当前位置为止的状态，由隐藏通道上的空白、换行和行标记逐步更新
+struct LocState
+{
+  std::string mFile;           // 行标记给出的文件路径
+  long mLineDelta{ 0 };        // 行标记换算出的行号与实际行号之差
+  bool mStartOfLine{ true };   // 下一个词法单元是否位于行首
+  bool mLeadingSpace{ false }; // 下一个词法单元是否有前导空格
+};
 
-  if (tokenTypeName.empty())
-    tokenTypeName = "<UNKNOWN>"; // 处理可能的空字符串情况
+/// 处理行标记 `# 行号 "文件" ...`，它说明下一行是该文件的第几行
+void
+line_marker(const antlr4::Token* token, LocState& state)
+{
+  auto text = token->getText();
+  auto p = text.find_first_of("0123456789");
+  if (p == std::string::npos)
+    return; // 不是行标记（如 #pragma），不影响位置
 
-  if (tokenTypeMapping.find(tokenTypeName) != tokenTypeMapping.end()) {
-    tokenTypeName = tokenTypeMapping[tokenTypeName];
+  long line = std::stol(text.substr(p));
+  state.mLineDelta = line - long(token->getLine() + 1);
+
+  auto q = text.find('"', p);
+  if (q != std::string::npos) {
+    auto r = text.find('"', q + 1);
+    state.mFile = text.substr(q + 1, r - q - 1);
   }
-  std::string locInfo = " Loc=<0:0>";
+}
 
-  bool startOfLine = false;
-  bool leadingSpace = false;
+void
+print_token(const antlr4::Token* token,
+            const LocState& state,
+            std::ofstream& outFile,
+            const std::vector<std::string>& names)
+{
+  auto type = token->getType();
+  std::string_view tokenTypeName =
+    type == antlr4::Token::EOF ? tok::name(tok::Kind::kEof) : names[type];
 
   if (token->getText() != "<EOF>")
     outFile << tokenTypeName << " '" << token->getText() << "'";
   else
     outFile << tokenTypeName << " '"
             << "'";
-  if (startOfLine)
-    outFile << "\t [StartOfLine]";
-  if (leadingSpace)
-    outFile << " [LeadingSpace]";
-  outFile << locInfo << std::endl;
+  if (state.mStartOfLine)
+    outFile << "\t[StartOfLine]";
+  if (state.mLeadingSpace)
+    outFile << "\t[LeadingSpace]";
+  outFile << "\tLoc=<" << state.mFile << ':'
+          << long(token->getLine()) + state.mLineDelta << ':'
+          << token->getCharPositionInLine() + 1 << ">\n";
 }
 
-int
-main(int argc, char* argv[])
+/// 把 \p inName 的词法分析结果写到 \p outName ，返回值同进程退出码。
+/// 每次调用有自己的词法分析器，可以在多个线程中同时调用。
+static int
+scan(const char* inName, const char* outName)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
-
-  std::ifstream inFile(argv[1]);
+  std::ifstream inFile(inName);
   if (!inFile) {
-    std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to open input file: " << inName << '\n';
     return -2;
   }
 
-  std::ofstream outFile(argv[2]);
+  std::ofstream outFile(outName);
   if (!outFile) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outName << '\n';
     return -3;
   }
 
-  std::cout << "程序 '" << argv[0] << std::endl;
-  std::cout << "输入 '" << argv[1] << std::endl;
-  std::cout << "输出 '" << argv[2] << std::endl;
-
   antlr4::ANTLRInputStream input(inFile);
   SYsULexer lexer(&input);
 
   antlr4::CommonTokenStream tokens(&lexer);
   tokens.fill();
 
+  auto names = token_names(lexer.getVocabulary());
+  LocState state;
   for (auto&& token : tokens.getTokens()) {
-    print_token(token, tokens, outFile, lexer);
+    switch (token->getType()) {
+      case SYsULexer::LineAfterPreprocessing:
+        line_marker(token, state);
+        break;
+
+      case SYsULexer::Whitespace:
+        state.mLeadingSpace = true;
+        break;
+
+      case SYsULexer::Newline:
+        state.mStartOfLine = true;
+        state.mLeadingSpace = false;
+        break;
+
+      default:
+        print_token(token, state, outFile, names);
+        state.mStartOfLine = false;
+        state.mLeadingSpace = false;
+    }
+  }
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (manifest::is_manifest(argc, argv))
+    return manifest::main(argv[1], [](const manifest::Entry& entry) {
+      return scan(entry.mInput.c_str(), entry.mOutput.c_str());
+    });
+
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " @<manifest>\n";
+    return -1;
   }
+
+  std::cout << "程序 '" << argv[0] << std::endl;
+  std::cout << "输入 '" << argv[1] << std::endl;
+  std::cout << "输出 '" << argv[2] << std::endl;
+
+  return scan(argv[1], argv[2]);
 }
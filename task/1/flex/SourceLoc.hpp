@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 源代码位置
+ *
+ * 文件号、行号、列号打包在 32 位里：文件号 6 位，行号 16 位，列号 10 位，
+ * 超出范围的行列号取各自的最大值。文件号指向本次编译的文件表 Files，0 表示
+ * 未知文件，全零的位置表示无效位置。行列号都从 1 开始，行号是按
+ * `# 行号 "文件"` 行标记换算过的行号，与 clang 的 presumed location 一致。
+ */
+class SourceLoc
+{
+public:
+  class Files;
+
+  static constexpr unsigned kFileBits = 6;
+  static constexpr unsigned kLineBits = 16;
+  static constexpr unsigned kColumnBits = 10;
+
+  SourceLoc() = default;
+
+  SourceLoc(std::uint32_t file, std::uint32_t line, std::uint32_t column)
+  {
+    line = std::min(line, (1u << kLineBits) - 1);
+    column = std::min(column, (1u << kColumnBits) - 1);
+    mBits = (file << (kLineBits + kColumnBits)) | (line << kColumnBits) | column;
+  }
+
+  /// 打包后的 32 位，用于序列化
+  std::uint32_t bits() const { return mBits; }
+
+  static SourceLoc from_bits(std::uint32_t bits)
+  {
+    SourceLoc loc;
+    loc.mBits = bits;
+    return loc;
+  }
+
+  std::uint32_t file() const { return mBits >> (kLineBits + kColumnBits); }
+
+  std::uint32_t line() const
+  {
+    return (mBits >> kColumnBits) & ((1u << kLineBits) - 1);
+  }
+
+  std::uint32_t column() const { return mBits & ((1u << kColumnBits) - 1); }
+
+  bool valid() const { return mBits != 0; }
+
+  bool operator==(SourceLoc other) const { return mBits == other.mBits; }
+
+  bool operator!=(SourceLoc other) const { return mBits != other.mBits; }
+
+private:
+  std::uint32_t mBits{ 0 };
+};
+
+/**
+ * @brief 一次编译的文件表
+ *
+ * 由词法分析器的状态（lex::G、SYsULexer）持有，与一次编译同生共死。批量模式
+ * 在一个进程里分析很多文件，各自的编号互不干扰，也不会越用越满。编号 0 对应
+ * 空路径，一次编译涉及的文件超过 63 个时，之后的文件都记为 0。
+ */
+class SourceLoc::Files
+{
+public:
+  static constexpr std::uint32_t kMaxFiles = 1u << kFileBits;
+
+  /// 登记文件路径 \p path 并返回文件号，文件表已满时返回 0
+  std::uint32_t id(std::string_view path);
+
+  /// 文件号对应的路径，登记过的路径不会移动
+  const std::string& name(std::uint32_t id) const { return mNames[id]; }
+
+  /// 按 clang 的格式 `文件:行:列` 输出 \p loc
+  void print(std::ostream& os, SourceLoc loc) const;
+
+private:
+  std::uint32_t mCount{ 1 };
+  std::string mNames[kMaxFiles];
+};
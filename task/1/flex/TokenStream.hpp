@@ -0,0 +1,224 @@
+#pragma once
+
+#include "SourceLoc.hpp"
+#include "TokenKinds.hpp"
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 二进制词法单元流
+ *
+ * 任务一到任务二之间默认以 clang -dump-tokens 的文本格式传递词法单元，每行都
+ * 要重新切分、转换数字。这里定义一种紧凑的二进制格式，作为整条流水线的快速
+ * 通道；文本格式仍然留给评分脚本使用。
+ *
+ * 文件以 8 字节的 kMagic 开头，之后是一条条记录，其中的整数都是 LEB128 变长
+ * 编码：
+ *
+ * - 词法单元：head = 种类 << 2 | LeadingSpace << 1 | StartOfLine，种类是
+ *   tok::Kind 的值（不为 0）。种类没有固定写法时接着是文本号，等于已定义的文本
+ *   数时表示新文本，后面再跟长度和字节。最后是 4 字节小端的位置，布局同
+ *   SourceLoc，但其中的文件号是流内的编号。
+ * - 文件定义：head = 0，后接长度和路径字节，按出现顺序从 1 开始编号。
+ *
+ * 相同的文本只出现一次，读取方可以按文本号缓存由它得到的东西（如驻留后的
+ * Symbol），读到的文本直接指向输入，不复制。
+ */
+namespace tokstream {
+
+inline constexpr std::string_view kMagic{ "YATCCTK1", 8 };
+
+/// 把词法单元编码成记录，编码结果由调用者写到任意输出
+class Writer
+{
+public:
+  /// 编码一个词法单元，返回的字节在下一次调用前有效
+  std::string_view token(tok::Kind kind,
+                         std::string_view text,
+                         std::string_view file,
+                         std::uint32_t line,
+                         std::uint32_t column,
+                         bool startOfLine,
+                         bool leadingSpace)
+  {
+    mBuf.clear();
+
+    // 文件路径不变时不必查找
+    if (mFileId == 0 || file != mFiles[mFileId - 1]) {
+      mFileId = 0;
+      for (std::size_t i = 0; i < mFiles.size(); ++i)
+        if (mFiles[i] == file)
+          mFileId = i + 1;
+      if (mFileId == 0) {
+        mFiles.emplace_back(file);
+        mFileId = mFiles.size();
+        put_varint(0);
+        put_bytes(file);
+      }
+    }
+
+    put_varint(std::uint32_t(kind) << 2 | std::uint32_t(leadingSpace) << 1 |
+               std::uint32_t(startOfLine));
+
+    if (tok::spelling(kind).empty()) {
+      auto iter = mTextIds.find(text);
+      if (iter != mTextIds.end())
+        put_varint(iter->second);
+      else {
+        auto id = std::uint32_t(mTexts.size());
+        mTextIds.emplace(mTexts.emplace_back(text), id);
+        put_varint(id);
+        put_bytes(text);
+      }
+    }
+
+    // 文件太多、文件号放不下时记为未知文件
+    auto fileId = mFileId < (1u << SourceLoc::kFileBits) ? mFileId : 0;
+    auto loc = SourceLoc(fileId, line, column).bits();
+    for (int i = 0; i < 4; ++i)
+      mBuf.push_back(char(loc >> (i * 8)));
+
+    return mBuf;
+  }
+
+private:
+  std::string mBuf;
+  std::vector<std::string> mFiles;
+  std::uint32_t mFileId{ 0 }; ///< 上一个词法单元的文件号，0 表示还没有
+  std::deque<std::string> mTexts;
+  std::unordered_map<std::string_view, std::uint32_t> mTextIds;
+
+  void put_varint(std::uint32_t v)
+  {
+    for (; v >= 0x80; v >>= 7)
+      mBuf.push_back(char(v | 0x80));
+    mBuf.push_back(char(v));
+  }
+
+  void put_bytes(std::string_view s)
+  {
+    put_varint(s.size());
+    mBuf.append(s);
+  }
+};
+
+/// 读出的一个词法单元
+struct Token
+{
+  tok::Kind mKind;
+  bool mStartOfLine, mLeadingSpace;
+  std::uint32_t mText; ///< 文本号，种类有固定写法时无意义
+  SourceLoc mLoc;      ///< 文件号是流内的编号，见 Reader::file
+};
+
+/// 直接在内存中的整个流上读取记录，不复制其中的文本
+class Reader
+{
+public:
+  /// [\p begin, \p end) 须以 kMagic 开头，并在读取期间保持有效
+  Reader(const char* begin, const char* end)
+    : mCur(begin + kMagic.size())
+    , mEnd(end)
+  {
+    mFiles.emplace_back(); // 文件号 0 表示未知文件
+  }
+
+  /// \p data 是否是二进制词法单元流
+  static bool is_stream(std::string_view data)
+  {
+    return data.substr(0, kMagic.size()) == kMagic;
+  }
+
+  /// 读下一个词法单元，读完或数据损坏时返回 false
+  bool next(Token& token)
+  {
+    while (mCur != mEnd) {
+      std::uint32_t head;
+      if (!get_varint(head))
+        return false;
+
+      if (head == 0) {
+        std::string_view file;
+        if (!get_bytes(file))
+          return false;
+        mFiles.push_back(file);
+        continue;
+      }
+
+      token.mKind = tok::Kind(head >> 2);
+      token.mStartOfLine = head & 1;
+      token.mLeadingSpace = head >> 1 & 1;
+      if (std::size_t(token.mKind) >= tok::kNumKinds)
+        return false;
+
+      if (tok::spelling(token.mKind).empty()) {
+        if (!get_varint(token.mText) || token.mText > mTexts.size())
+          return false;
+        if (token.mText == mTexts.size()) {
+          std::string_view text;
+          if (!get_bytes(text))
+            return false;
+          mTexts.push_back(text);
+        }
+      }
+
+      if (mEnd - mCur < 4)
+        return false;
+      std::uint32_t loc = 0;
+      for (int i = 0; i < 4; ++i)
+        loc |= std::uint32_t(std::uint8_t(*mCur++)) << (i * 8);
+      token.mLoc = SourceLoc::from_bits(loc);
+      return true;
+    }
+    return false;
+  }
+
+  /// 词法单元的文本，有固定写法的种类返回其写法
+  std::string_view text(const Token& token) const
+  {
+    auto spelling = tok::spelling(token.mKind);
+    return spelling.empty() ? mTexts[token.mText] : spelling;
+  }
+
+  /// 文本号对应的文本
+  std::string_view text(std::uint32_t id) const { return mTexts[id]; }
+
+  /// 已读到的文本个数，文本号都小于它
+  std::size_t num_texts() const { return mTexts.size(); }
+
+  /// 流内文件号对应的路径
+  std::string_view file(std::uint32_t id) const { return mFiles[id]; }
+
+  std::size_t num_files() const { return mFiles.size(); }
+
+private:
+  const char *mCur, *mEnd;
+  std::vector<std::string_view> mTexts, mFiles;
+
+  bool get_varint(std::uint32_t& v)
+  {
+    v = 0;
+    for (int shift = 0; mCur != mEnd && shift < 35; shift += 7) {
+      auto byte = std::uint8_t(*mCur++);
+      v |= std::uint32_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool get_bytes(std::string_view& s)
+  {
+    std::uint32_t size;
+    if (!get_varint(size) || std::size_t(mEnd - mCur) < size)
+      return false;
+    s = { mCur, size };
+    mCur += size;
+    return true;
+  }
+};
+
+} // namespace tokstream
@@ -1,4 +1,5 @@
 #include "lex.hpp"
+#include <algorithm>
 #include <iostream>
 
 void
@@ -17,7 +18,7 @@ static const char* kTokenNames[] = {
 const char*
 id2str(Id id)
 {
-  static char sCharBuf[2] = { 0, 0 };
+  static thread_local char sCharBuf[2] = { 0, 0 };
   if (id == Id::YYEOF) {
     return "eof";
   }
@@ -28,16 +29,76 @@ id2str(Id id)
   return kTokenNames[int(id) - int(Id::IDENTIFIER)];
 }
 
-G g;
+thread_local G g;
+
+const char*
+blank(const char* yytext)
+{
+  // 空白（空格、\t、\n、\v、\f、\r）大多只有一两个字节，逐字节扫完整段即可；
+  // 空白之后总有一个非空白的字节，至少是 flex 缓冲区末尾的 '\0' 哨兵
+  auto p = yytext;
+  const char* lastNewline = nullptr;
+  int newlines = 0;
+  for (;; ++p) {
+    char c = *p;
+    if (c == '\n')
+      lastNewline = p, ++newlines;
+    else if (c != ' ' && (c < '\t' || c > '\r'))
+      break;
+  }
+
+  if (newlines != 0) {
+    // 最后一个换行之后的空白决定列号和是否有前导空格
+    g.mLine += newlines;
+    g.mColumn = p - lastNewline;
+    g.mStartOfLine = true;
+    g.mLeadingSpace = g.mColumn > 1;
+  } else {
+    g.mColumn += p - yytext;
+    g.mLeadingSpace = true;
+  }
+  return p;
+}
+
+void
+line_marker(const char* yytext, int yyleng)
+{
+  auto p = yytext + 1, end = yytext + yyleng;
+  while (p < end && (*p == ' ' || *p == '\t'))
+    ++p;
+  if (end - p >= 4 && std::strncmp(p, "line", 4) == 0) // #line 指令
+    p += 4;
+  while (p < end && (*p == ' ' || *p == '\t'))
+    ++p;
+
+  // 不是行标记（如 #pragma），不影响位置
+  if (p == end || *p < '0' || *p > '9')
+    return;
+  int line = 0;
+  while (p < end && '0' <= *p && *p <= '9')
+    line = line * 10 + (*p++ - '0');
+
+  while (p < end && (*p == ' ' || *p == '\t'))
+    ++p;
+  if (p < end && *p == '"') {
+    auto q = ++p;
+    while (q < end && *q != '"')
+      q += *q == '\\' ? 2 : 1;
+    g.mFile.assign(p, std::min(q, end));
+  }
+
+  // 行标记本身所在行末尾的换行会再把行号加一
+  g.mLine = line - 1;
+}
 
 int
-come(int tokenId, const char* yytext, int yyleng, int yylineno)
+come(int tokenId, const char* yytext, int yyleng)
 {
   g.mId = Id(tokenId);
   g.mText = { yytext, std::size_t(yyleng) };
-  g.mLine = yylineno;
 
   print_token();
+  g.mColumn += yyleng;
   g.mStartOfLine = false;
   g.mLeadingSpace = false;
 
@@ -35,16 +35,27 @@ id2str(Id id);
 struct G
 {
   Id mId{ YYEOF };              // 词号
-  std::string_view mText;       // 对应文本
+  std::string_view mText;       // 对应文本，输入被映射时在整个编译期间有效
   std::string mFile;            // 文件路径
   int mLine{ 1 }, mColumn{ 1 }; // 行号、列号
   bool mStartOfLine{ true };    // 是否是行首
   bool mLeadingSpace{ false };  // 是否有前导空格
 };
 
-extern G g;
+/// 扫描状态，每个线程各有一份，批量模式下多个线程可以同时扫描不同的文件
+extern thread_local G g;
 
+/// 从 \p yytext 开始的一段空白（含换行），整段一次扫完并更新行列号和两个标志，
+/// 返回空白之后的第一个字节
+const char*
+blank(const char* yytext);
+
+/// 预处理器留下的行标记 `# 行号 "文件" ...`，说明下一行是该文件的第几行
+void
+line_marker(const char* yytext, int yyleng);
+
+/// 报告一个词法单元，之后列号后移到它的末尾
 int
-come(int tokenId, const char* yytext, int yyleng, int yylineno);
+come(int tokenId, const char* yytext, int yyleng);
 
 } // namespace lex
@@ -1,93 +1,268 @@
+#include "Manifest.hpp"
+#include "TokenStream.hpp"
 #include "lex.hpp"
 #include "lex.l.hh"
-#include <fstream>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static std::ofstream outFile;
+/// 输出先攒在这块缓冲区里，满了才整块写入文件，而不是每个词法单元都写一次。
+/// 批量模式下每个线程写自己的文件，所以这些状态都是线程局部的。
+static thread_local std::FILE* outFile;
+static thread_local char sOutBuf[1 << 16];
+static thread_local std::size_t sOutLen = 0;
 
-static std::string
-escape(std::string_view sv)
+static void
+flush_out()
 {
-  std::string result;
-  for (char c : sv) {
-    switch (c) {
-      case '\n':
-        result += "\\n";
-        break;
-      case '\t':
-        result += "\\t";
-        break;
-      case '\r':
-        result += "\\r";
-        break;
-      case '\v':
-        result += "\\v";
-        break;
-      case '\f':
-        result += "\\f";
-        break;
-      case '\a':
-        result += "\\a";
-        break;
-      case '\b':
-        result += "\\b";
-        break;
-      case '\\':
-        result += "\\\\";
-        break;
-      case '\'':
-        result += "\\\'";
-        break;
-      case '\0':
-        break;
-      default:
-        result += c;
-        break;
+  std::fwrite(sOutBuf, 1, sOutLen, outFile);
+  sOutLen = 0;
+}
+
+static void
+put(std::string_view sv)
+{
+  if (sOutLen + sv.size() > sizeof(sOutBuf)) {
+    flush_out();
+    if (sv.size() > sizeof(sOutBuf)) {
+      std::fwrite(sv.data(), 1, sv.size(), outFile);
+      return;
+    }
+  }
+  std::memcpy(sOutBuf + sOutLen, sv.data(), sv.size());
+  sOutLen += sv.size();
+}
+
+static void
+put_int(int v)
+{
+  char buf[16];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+  put({ buf, std::size_t(end - buf) });
+}
+
+/// 转义 \p sv 并直接写进输出缓冲区，不构造中间字符串
+static void
+put_escaped(std::string_view sv)
+{
+  while (!sv.empty()) {
+    // 每个字符至多转义成两个字节，按缓冲区剩余空间分段处理
+    auto n = std::min(sv.size(), (sizeof(sOutBuf) - sOutLen) / 2);
+    if (n == 0) {
+      flush_out();
+      continue;
+    }
+
+    auto p = sOutBuf + sOutLen;
+    for (char c : sv.substr(0, n)) {
+      switch (c) {
+        case '\n':
+          *p++ = '\\', *p++ = 'n';
+          break;
+        case '\t':
+          *p++ = '\\', *p++ = 't';
+          break;
+        case '\r':
+          *p++ = '\\', *p++ = 'r';
+          break;
+        case '\v':
+          *p++ = '\\', *p++ = 'v';
+          break;
+        case '\f':
+          *p++ = '\\', *p++ = 'f';
+          break;
+        case '\a':
+          *p++ = '\\', *p++ = 'a';
+          break;
+        case '\b':
+          *p++ = '\\', *p++ = 'b';
+          break;
+        case '\\':
+          *p++ = '\\', *p++ = '\\';
+          break;
+        case '\'':
+          *p++ = '\\', *p++ = '\'';
+          break;
+        case '\0':
+          break;
+        default:
+          *p++ = c;
+          break;
+      }
     }
+    sOutLen = p - sOutBuf;
+    sv.remove_prefix(n);
   }
-  return result;
 }
 
+/// 输出文件名以 .tok 结尾时改写二进制词法单元流，供任务二直接读取
+static thread_local std::optional<tokstream::Writer> sWriter;
+
 void
 print_token()
 {
-  outFile << lex::id2str(lex::g.mId) << " \'" << escape(lex::g.mText) << "\'";
+  if (sWriter) {
+    put(sWriter->token(tok::from_name(lex::id2str(lex::g.mId)),
+                       lex::g.mText,
+                       lex::g.mFile,
+                       lex::g.mLine,
+                       lex::g.mColumn,
+                       lex::g.mStartOfLine,
+                       lex::g.mLeadingSpace));
+    return;
+  }
+
+  put(lex::id2str(lex::g.mId));
+  put(" \'");
+  put_escaped(lex::g.mText);
+  put("\'");
   if (lex::g.mStartOfLine)
-    outFile << "\t[StartOfLine]";
+    put("\t[StartOfLine]");
   if (lex::g.mLeadingSpace)
-    outFile << "\t[LeadingSpace]";
-  outFile << "\tLoc=<0:0>\n";
-  outFile << std::flush;
+    put("\t[LeadingSpace]");
+  put("\tLoc=<");
+  put(lex::g.mFile);
+  put(":");
+  put_int(lex::g.mLine);
+  put(":");
+  put_int(lex::g.mColumn);
+  put(">\n");
 }
 
-int
-main(int argc, char* argv[])
+/**
+ * 把整个输入文件映射到内存，末尾带两个 '\0' 作为 yy_scan_buffer 要求的哨兵。
+ * flex 会临时改写词法单元后面的一个字节，所以映射是可写的私有映射。失败（如
+ * 输入不是普通文件）时返回 nullptr。
+ */
+static char*
+map_input(const char* path, std::size_t& size, std::size_t& mapSize)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return nullptr;
   }
+  size = st.st_size;
 
-  yyin = fopen(argv[1], "r");
-  if (!yyin) {
-    std::cerr << "Failed to open " << argv[1] << '\n';
-    return -2;
+  // 先保留一段全零的匿名映射，再把文件覆盖映射到开头。文件恰好占满整页时，
+  // 哨兵落在后面的匿名页上，不会越过文件末尾去访问。
+  std::size_t page = sysconf(_SC_PAGESIZE);
+  mapSize = (size + 2 + page - 1) / page * page;
+  auto base = mmap(nullptr,
+                   mapSize,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1,
+                   0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return nullptr;
   }
+  if (size > 0 && mmap(base,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_FIXED,
+                       fd,
+                       0) == MAP_FAILED) {
+    munmap(base, mapSize);
+    close(fd);
+    return nullptr;
+  }
+
+  close(fd);
+  return static_cast<char*>(base);
+}
 
-  outFile = std::ofstream(argv[2]);
+/// 把 \p inName 的词法分析结果写到 \p outName ，返回值同进程退出码。
+/// 扫描器是可重入的，其余状态线程局部，可以在多个线程中同时调用。
+static int
+scan(const char* inName, const char* outName)
+{
+  yyscan_t scanner;
+  if (yylex_init(&scanner) != 0)
+    return -4;
+
+  // 优先让 flex 直接扫描映射的整个文件，不行再退回到 stdio 读取
+  std::size_t inSize, inMapSize;
+  std::FILE* inFile = nullptr;
+  char* inMap = map_input(inName, inSize, inMapSize);
+  if (inMap)
+    yy_scan_buffer(inMap, inSize + 2, scanner);
+  else {
+    inFile = fopen(inName, "r");
+    if (!inFile) {
+      std::cerr << "Failed to open " << inName << '\n';
+      yylex_destroy(scanner);
+      return -2;
+    }
+    yyset_in(inFile, scanner);
+  }
+
+  outFile = fopen(outName, "w");
   if (!outFile) {
-    std::cerr << "Failed to open " << argv[2] << '\n';
+    std::cerr << "Failed to open " << outName << '\n';
+    yylex_destroy(scanner);
+    if (inMap)
+      munmap(inMap, inMapSize);
+    else
+      fclose(inFile);
     return -3;
   }
 
-  std::cout << "程序 '" << argv[0] << std::endl;
-  std::cout << "输入 '" << argv[1] << std::endl;
-  std::cout << "输出 '" << argv[2] << std::endl;
+  // 同一个线程会依次扫描多个文件，开始前复位上一个文件留下的状态
+  lex::g = lex::G();
+  sOutLen = 0;
+  sWriter.reset();
+  std::string_view outPath(outName);
+  if (outPath.size() >= 4 && outPath.substr(outPath.size() - 4) == ".tok") {
+    sWriter.emplace();
+    put(tokstream::kMagic);
+  }
 
   // 这个循环完成词法分析，yylex()中会调用print_token()，从而向
   // 输出文件中写入词法分析结果。
-  while (yylex())
+  while (yylex(scanner))
     ;
+  flush_out();
+
+  // 映射的缓冲区不归 flex 所有，yylex_destroy 只释放缓冲区的控制结构
+  yylex_destroy(scanner);
+  if (inMap)
+    munmap(inMap, inMapSize);
+  else
+    fclose(inFile);
+  fclose(outFile);
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (manifest::is_manifest(argc, argv))
+    return manifest::main(argv[1], [](const manifest::Entry& entry) {
+      return scan(entry.mInput.c_str(), entry.mOutput.c_str());
+    });
+
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " @<manifest>\n";
+    return -1;
+  }
+
+  std::cout << "程序 '" << argv[0] << std::endl;
+  std::cout << "输入 '" << argv[1] << std::endl;
+  std::cout << "输出 '" << argv[2] << std::endl;
 
-  fclose(yyin);
+  return scan(argv[1], argv[2]);
 }
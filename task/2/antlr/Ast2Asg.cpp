@@ -6,7 +6,7 @@
 namespace asg {
 
 // 符号表，保存当前作用域的所有声明
-struct Ast2Asg::Symtbl : public std::unordered_map<std::string, Decl*>
+struct Ast2Asg::Symtbl : public std::unordered_map<Symbol, Decl*>
 {
   Ast2Asg& m;
   Symtbl* mPrev;
@@ -20,11 +20,11 @@ struct Ast2Asg::Symtbl : public std::unordered_map<std::string, Decl*>
 
   ~Symtbl() { m.mSymtbl = mPrev; }
 
-  Decl* resolve(const std::string& name);
+  Decl* resolve(Symbol name);
 };
 
 Decl*
-Ast2Asg::Symtbl::resolve(const std::string& name)
+Ast2Asg::Symtbl::resolve(Symbol name)
 {
   auto iter = find(name);
   if (iter != end())
@@ -94,91 +94,30 @@ Ast2Asg::operator()(ast::DeclarationSpecifiersContext* ctx)
   return ret;
 }
 
-std::pair<TypeExpr*, std::string>
+std::pair<TypeExpr*, Symbol>
 Ast2Asg::operator()(ast::DeclaratorContext* ctx, TypeExpr* sub)
 {
   return self(ctx->directDeclarator(), sub);
 }
 
-static int
-eval_arrlen(Expr* expr)
-{
-  if (auto p = expr->dcst<IntegerLiteral>())
-    return p->val;
-
-  if (auto p = expr->dcst<DeclRefExpr>()) {
-    if (p->decl == nullptr)
-      ABORT();
-
-    auto var = p->decl->dcst<VarDecl>();
-    if (!var || !var->type->qual.const_)
-      ABORT(); // 数组长度必须是编译期常量
-
-    switch (var->type->spec) {
-      case Type::Spec::kChar:
-      case Type::Spec::kInt:
-      case Type::Spec::kLong:
-      case Type::Spec::kLongLong:
-        return eval_arrlen(var->init);
-
-      default:
-        ABORT(); // 长度表达式必须是数值类型
-    }
-  }
-
-  if (auto p = expr->dcst<UnaryExpr>()) {
-    auto sub = eval_arrlen(p->sub);
-
-    switch (p->op) {
-      case UnaryExpr::kPos:
-        return sub;
-
-      case UnaryExpr::kNeg:
-        return -sub;
-
-      default:
-        ABORT();
-    }
-  }
-
-  if (auto p = expr->dcst<BinaryExpr>()) {
-    auto lft = eval_arrlen(p->lft);
-    auto rht = eval_arrlen(p->rht);
-
-    switch (p->op) {
-      case BinaryExpr::kAdd:
-        return lft + rht;
-
-      case BinaryExpr::kSub:
-        return lft - rht;
-
-      default:
-        ABORT();
-    }
-  }
-
-  if (auto p = expr->dcst<InitListExpr>()) {
-    if (p->list.empty())
-      return 0;
-    return eval_arrlen(p->list[0]);
-  }
-
-  ABORT();
-}
-
-std::pair<TypeExpr*, std::string>
+std::pair<TypeExpr*, Symbol>
 Ast2Asg::operator()(ast::DirectDeclaratorContext* ctx, TypeExpr* sub)
 {
   if (auto p = ctx->Identifier())
-    return { sub, p->getText() };
+    return { sub, Symbol(p->getText()) };
 
   if (ctx->LeftBracket()) {
     auto arrayType = make<ArrayType>();
     arrayType->sub = sub;
 
-    if (auto p = ctx->assignmentExpression())
-      arrayType->len = eval_arrlen(self(p));
-    else
+    if (auto p = ctx->assignmentExpression()) {
+      // 字面量直接取值，其它常量表达式留给 Typing 求值
+      auto len = self(p);
+      if (auto lit = len->dcst<IntegerLiteral>())
+        arrayType->len = lit->val;
+      else
+        arrayType->lenExpr = len;
+    } else
       arrayType->len = ArrayType::kUnLen;
 
     return self(ctx->directDeclarator(), arrayType);
@@ -199,6 +138,7 @@ Ast2Asg::operator()(ast::ExpressionContext* ctx)
 
   for (unsigned i = 1; i < list.size(); ++i) {
     auto node = make<BinaryExpr>();
+    node->loc = loc(ctx->Comma(i - 1));
     node->op = node->kComma;
     node->lft = ret;
     node->rht = self(list[i]);
@@ -215,6 +155,7 @@ Ast2Asg::operator()(ast::AssignmentExpressionContext* ctx)
     return self(p);
 
   auto ret = make<BinaryExpr>();
+  ret->loc = loc(ctx->Equal());
   ret->op = ret->kAssign;
   ret->lft = self(ctx->unaryExpression());
   ret->rht = self(ctx->assignmentExpression());
@@ -229,10 +170,10 @@ Ast2Asg::operator()(ast::AdditiveExpressionContext* ctx)
   for (unsigned i = 1; i < children.size(); ++i) {
     auto node = make<BinaryExpr>();
 
-    auto token = dynamic_cast<antlr4::tree::TerminalNode*>(children[i])
-                   ->getSymbol()
-                   ->getType();
-    switch (token) {
+    auto symbol =
+      dynamic_cast<antlr4::tree::TerminalNode*>(children[i])->getSymbol();
+    node->loc = loc(symbol);
+    switch (symbol->getType()) {
       case ast::Plus:
         node->op = node->kAdd;
         break;
@@ -260,6 +201,7 @@ Ast2Asg::operator()(ast::UnaryExpressionContext* ctx)
     return self(p);
 
   auto ret = make<UnaryExpr>();
+  ret->loc = loc(ctx);
 
   switch (
     dynamic_cast<antlr4::tree::TerminalNode*>(ctx->unaryOperator()->children[0])
@@ -295,8 +237,9 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
 {
 
   if (auto p = ctx->Identifier()) {
-    auto name = p->getText();
+    Symbol name(p->getText());
     auto ret = make<DeclRefExpr>();
+    ret->loc = loc(p);
     ret->decl = mSymtbl->resolve(name);
     return ret;
   }
@@ -305,6 +248,7 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
     auto text = p->getText();
 
     auto ret = make<IntegerLiteral>();
+    ret->loc = loc(p);
 
     ASSERT(!text.empty());
     if (text[0] != '0')
@@ -332,6 +276,7 @@ Ast2Asg::operator()(ast::InitializerContext* ctx)
     return self(p);
 
   auto ret = make<InitListExpr>();
+  ret->loc = loc(ctx);
 
   if (auto p = ctx->initializerList()) {
     for (auto&& i : p->initializer()) {
@@ -372,6 +317,7 @@ CompoundStmt*
 Ast2Asg::operator()(ast::CompoundStatementContext* ctx)
 {
   auto ret = make<CompoundStmt>();
+  ret->loc = loc(ctx);
 
   if (auto p = ctx->blockItemList()) {
     Symtbl localDecls(self);
@@ -379,6 +325,7 @@ Ast2Asg::operator()(ast::CompoundStatementContext* ctx)
     for (auto&& i : p->blockItem()) {
       if (auto q = i->declaration()) {
         auto sub = make<DeclStmt>();
+        sub->loc = loc(q);
         sub->decls = self(q);
         ret->subs.push_back(sub);
       }
@@ -399,11 +346,14 @@ Ast2Asg::operator()(ast::ExpressionStatementContext* ctx)
 {
   if (auto p = ctx->expression()) {
     auto ret = make<ExprStmt>();
+    ret->loc = loc(ctx);
     ret->expr = self(p);
     return ret;
   }
 
-  return make<NullStmt>();
+  auto ret = make<NullStmt>();
+  ret->loc = loc(ctx);
+  return ret;
 }
 
 Stmt*
@@ -411,6 +361,7 @@ Ast2Asg::operator()(ast::JumpStatementContext* ctx)
 {
   if (ctx->Return()) {
     auto ret = make<ReturnStmt>();
+    ret->loc = loc(ctx);
     ret->func = mCurrentFunc;
     if (auto p = ctx->expression())
       ret->expr = self(p);
@@ -456,7 +407,8 @@ Ast2Asg::operator()(ast::FunctionDefinitionContext* ctx)
   auto funcType = make<FunctionType>();
   funcType->sub = texp;
   type->texp = funcType;
-  ret->name = std::move(name);
+  ret->name = name;
+  ret->loc = loc(ctx->directDeclarator());
 
   Symtbl localDecls(self);
 
@@ -483,7 +435,8 @@ Ast2Asg::operator()(ast::InitDeclaratorContext* ctx, SpecQual sq)
     type->qual = sq.second;
     type->texp = funcType;
 
-    fdecl->name = std::move(name);
+    fdecl->name = name;
+    fdecl->loc = loc(ctx->declarator());
     for (auto p : funcType->params) {
       auto paramDecl = make<VarDecl>();
       paramDecl->type = p;
@@ -505,7 +458,8 @@ Ast2Asg::operator()(ast::InitDeclaratorContext* ctx, SpecQual sq)
     type->spec = sq.first;
     type->qual = sq.second;
     type->texp = texp;
-    vdecl->name = std::move(name);
+    vdecl->name = name;
+    vdecl->loc = loc(ctx->declarator());
 
     if (auto p = ctx->initializer())
       vdecl->init = self(p);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SYsULexer.hpp"
 #include "SYsUParser.h"
 #include "asg.hpp"
 
@@ -11,9 +12,11 @@ class Ast2Asg
 {
 public:
   Obj::Mgr& mMgr;
+  const SYsULexer& mLexer; ///< 用于查询词法单元的位置
 
-  Ast2Asg(Obj::Mgr& mgr)
+  Ast2Asg(Obj::Mgr& mgr, const SYsULexer& lexer)
     : mMgr(mgr)
+    , mLexer(lexer)
   {
   }
 
@@ -27,10 +30,10 @@ public:
 
   SpecQual operator()(ast::DeclarationSpecifiersContext* ctx);
 
-  std::pair<TypeExpr*, std::string> operator()(ast::DeclaratorContext* ctx,
-                                               TypeExpr* sub);
+  std::pair<TypeExpr*, Symbol> operator()(ast::DeclaratorContext* ctx,
+                                          TypeExpr* sub);
 
-  std::pair<TypeExpr*, std::string> operator()(
+  std::pair<TypeExpr*, Symbol> operator()(
     ast::DirectDeclaratorContext* ctx,
     TypeExpr* sub);
 
@@ -85,6 +88,19 @@ private:
   {
     return mMgr.make<T>(args...);
   }
+
+  SourceLoc loc(antlr4::Token* token) { return mLexer.loc(token); }
+
+  SourceLoc loc(antlr4::tree::TerminalNode* node)
+  {
+    return mLexer.loc(node->getSymbol());
+  }
+
+  /// 语法结构的位置取其第一个词法单元的位置
+  SourceLoc loc(antlr4::ParserRuleContext* ctx)
+  {
+    return mLexer.loc(ctx->getStart());
+  }
 };
 
 } // namespace asg
@@ -0,0 +1,52 @@
+#include "Prediction.hpp"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+namespace prediction {
+
+namespace atn = antlr4::atn;
+
+Options
+Options::from_env()
+{
+  Options opts;
+  auto env = std::getenv("YATCC_ANTLR");
+  if (!env)
+    return opts;
+
+  std::istringstream in(env);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (item == "ll")
+      opts.mTwoStage = false;
+  }
+  return opts;
+}
+
+SYsUParser::CompilationUnitContext*
+parse(SYsUParser& parser, bool twoStage, bool& fellBack)
+{
+  auto interp = parser.getInterpreter<atn::ParserATNSimulator>();
+  fellBack = false;
+
+  if (twoStage) {
+    interp->setPredictionMode(atn::PredictionMode::SLL);
+    parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+    parser.removeErrorListeners(); // 第一段的错误不一定是真的，不报告
+    try {
+      return parser.compilationUnit();
+    } catch (const antlr4::ParseCancellationException&) {
+      fellBack = true;
+    }
+
+    parser.addErrorListener(&antlr4::ConsoleErrorListener::INSTANCE);
+    parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+    parser.reset(); // 回到第一个词法单元，词法单元已在流中缓存，不会重新读
+  }
+
+  interp->setPredictionMode(atn::PredictionMode::LL);
+  return parser.compilationUnit();
+}
+
+} // namespace prediction
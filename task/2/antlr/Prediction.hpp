@@ -0,0 +1,31 @@
+#pragma once
+
+#include "SYsUParser.h"
+
+/**
+ * @brief 语法分析的预测策略
+ *
+ * ANTLR 默认用完整的 LL 预测，每次决策都要带上调用栈上下文。SLL 预测不看调用栈，
+ * 快得多，对绝大多数输入结果也一样；少数情况下 SLL 会误报语法错误，这时再用 LL
+ * 重新分析一遍即可。于是分两段：先用 SLL 加 BailErrorStrategy，一遇到错误就放弃；
+ * 失败了再用 LL 加默认的错误恢复，这样真正有语法错误的输入得到的报错与原来相同。
+ *
+ * 由环境变量 YATCC_ANTLR 控制，值为逗号分隔的若干项，目前只有 ll：只用 LL
+ * 预测，不分两段。
+ */
+namespace prediction {
+
+struct Options
+{
+  bool mTwoStage{ true }; ///< 先 SLL 后 LL
+
+  /// 从环境变量 YATCC_ANTLR 读取
+  static Options from_env();
+};
+
+/// 分析整个编译单元，\p twoStage 为真时先 SLL 后 LL，\p fellBack 表示是否
+/// 用到了第二段
+SYsUParser::CompilationUnitContext*
+parse(SYsUParser& parser, bool twoStage, bool& fellBack);
+
+} // namespace prediction
@@ -1,6 +1,6 @@
 #include "SYsULexer.hpp"
 #include "SYsULexer.tokens.hpp"
-#include <unordered_map>
+#include "TokenKinds.hpp"
 #include <vector>
 
 using antlr4::ParseCancellationException;
@@ -10,24 +10,47 @@ namespace {
 
 using namespace SYsULexerTokens;
 
-static const std::unordered_map<std::string, size_t> kClangTokens{
-  { "eof", antlr4::Token::EOF },
-  { "int", kInt },
-  { "identifier", kIdentifier },
-  { "l_paren", kLeftParen },
-  { "r_paren", kRightParen },
-  { "return", kReturn },
-  { "r_brace", kRightBrace },
-  { "l_brace", kLeftBrace },
-  { "numeric_constant", kConstant },
-  { "semi", kSemi },
-  { "equal", kEqual },
-  { "plus", kPlus },
-  { "minus", kMinus },
-  { "comma", kComma },
-  { "l_square", kLeftBracket },
-  { "r_square", kRightBracket }
-};
+/// clang 的词法单元种类对应的 ANTLR 词号，文法里没有的返回 INVALID_TYPE
+std::size_t
+token_type(tok::Kind kind)
+{
+  switch (kind) {
+    case tok::Kind::kEof:
+      return antlr4::Token::EOF;
+    case tok::Kind::kInt:
+      return kInt;
+    case tok::Kind::kIdentifier:
+      return kIdentifier;
+    case tok::Kind::kLParen:
+      return kLeftParen;
+    case tok::Kind::kRParen:
+      return kRightParen;
+    case tok::Kind::kReturn:
+      return kReturn;
+    case tok::Kind::kRBrace:
+      return kRightBrace;
+    case tok::Kind::kLBrace:
+      return kLeftBrace;
+    case tok::Kind::kNumericConstant:
+      return kConstant;
+    case tok::Kind::kSemi:
+      return kSemi;
+    case tok::Kind::kEqual:
+      return kEqual;
+    case tok::Kind::kPlus:
+      return kPlus;
+    case tok::Kind::kMinus:
+      return kMinus;
+    case tok::Kind::kComma:
+      return kComma;
+    case tok::Kind::kLSquare:
+      return kLeftBracket;
+    case tok::Kind::kRSquare:
+      return kRightBracket;
+    default:
+      return antlr4::Token::INVALID_TYPE;
+  }
+}
 
 } // namespace
 
@@ -75,14 +98,12 @@ SYsULexer::nextToken()
 
   // 提取类型段
   {
-    decltype(kClangTokens)::const_iterator typeIter;
     typeEnd = line.find(' ');
     if (typeEnd == std::string::npos)
       goto FAIL;
-    typeIter = kClangTokens.find(line.substr(0, typeEnd));
-    if (typeIter == kClangTokens.end())
+    type = token_type(tok::from_name({ line.data(), typeEnd }));
+    if (type == antlr4::Token::INVALID_TYPE)
       goto FAIL;
-    type = typeIter->second;
   }
 
   // 提取文本段
@@ -112,7 +133,12 @@ SYsULexer::nextToken()
     if (rowStart == std::string::npos)
       goto FAIL;
 
-    mSourceName = line.substr(locStart + 5, rowStart - locStart - 5);
+    // 文件路径不变时不必再查文件表
+    auto sourceName = line.substr(locStart + 5, rowStart - locStart - 5);
+    if (mFileId == 0 || sourceName != mSourceName) {
+      mSourceName = std::move(sourceName);
+      mFileId = mFiles.id(mSourceName);
+    }
     mLine = std::stoul(line.substr(rowStart + 1, colStart - rowStart - 1));
     mColumn = std::stoul(line.substr(colStart + 1, locEnd - colStart - 1));
   }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SourceLoc.hpp"
 #include <antlr4-runtime.h>
 #include <deque>
 #include <memory>
@@ -29,19 +30,34 @@ public:
 
   antlr4::TokenFactory<antlr4::CommonToken>* getTokenFactory() override;
 
+  /// 词法单元 \p token 带文件号的位置
+  SourceLoc loc(const antlr4::Token* token) const
+  {
+    return mLocs[token->getTokenIndex()];
+  }
+
+  /// 位置中的文件号对应的文件表
+  const SourceLoc::Files& files() const { return mFiles; }
+
 private:
   antlr4::CharStream* mInput;
   std::pair<TokenSource*, antlr4::CharStream*> mSource;
   antlr4::TokenFactory<antlr4::CommonToken>* mFactory;
 
   std::string mSourceName;
+  std::uint32_t mFileId = 0; ///< mSourceName 在 mFiles 中的编号
+  SourceLoc::Files mFiles;   ///< 本次分析的文件表
   size_t mLine = 1, mColumn = 0;
 
+  /// 按产生顺序记下每个词法单元的位置，下标即词法单元的编号
+  std::vector<SourceLoc> mLocs;
+
   std::unique_ptr<antlr4::CommonToken> common_token(size_t type,
                                                     size_t start,
                                                     size_t stop,
                                                     std::string text = {})
   {
+    mLocs.emplace_back(mFileId, mLine, mColumn);
     return mFactory->create(mSource,
                             type,
                             std::move(text),
@@ -1,36 +1,60 @@
 #include "Asg2Json.hpp"
 #include "Ast2Asg.hpp"
+#include "Compact.hpp"
+#include "Manifest.hpp"
+#include "Pool.hpp"
+#include "Prediction.hpp"
 #include "SYsULexer.hpp"
 #include "Typing.hpp"
 #include "asg.hpp"
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 
-int
-main(int argc, char* argv[])
+/// 打印从 \p since 到现在经过的时间，并把 \p since 更新为现在
+static void
+print_elapsed(const char* phase, std::chrono::steady_clock::time_point& since)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> ms = now - since;
+  std::cout << "耗时[" << phase << "]：" << ms.count() << " ms" << std::endl;
+  since = now;
+}
 
-  std::ifstream inFile(argv[1]);
+/// 分析词法单元转储 \p inName ，把类型检查后的语义图以 JSON 写到 \p outName ，
+/// 返回值同进程退出码。每次调用有自己的 Obj::Mgr，可以在多个线程中同时调用。
+/// 类型检查时用 \p jobs 个线程按函数并行。
+static int
+compile(const char* inName,
+        const char* outName,
+        bool verbose,
+        const prediction::Options& opts,
+        unsigned jobs)
+{
+  std::ifstream inFile(inName);
   if (!inFile) {
-    std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to open input file: " << inName << '\n';
     return -2;
   }
 
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
+  llvm::StringRef outPath(outName);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outName << '\n';
     return -3;
   }
 
-  std::cout << "程序 " << argv[0] << std::endl;
-  std::cout << "输入 " << argv[1] << std::endl;
-  std::cout << "输出 " << argv[2] << std::endl;
+  auto since = std::chrono::steady_clock::now();
+  auto elapsed = [&](const char* phase) {
+    if (verbose)
+      print_elapsed(phase, since);
+  };
+  auto collected = [&](const Obj::Mgr::Stats& stats, const char* phase) {
+    if (verbose)
+      stats.print(phase);
+  };
 
   antlr4::ANTLRInputStream input(inFile);
   SYsULexer lexer(&input);
@@ -38,20 +62,58 @@ main(int argc, char* argv[])
   antlr4::CommonTokenStream tokens(&lexer);
   SYsUParser parser(&tokens);
 
-  auto ast = parser.compilationUnit();
-  Obj::Mgr mgr;
+  bool fellBack;
+  auto ast = prediction::parse(parser, opts.mTwoStage, fellBack);
+  if (verbose && fellBack)
+    std::cout << "SLL 预测失败，已改用 LL 重新分析" << std::endl;
+  elapsed("语法分析");
+  Obj::Mgr mgr(true); // 启用内存池模式
 
-  asg::Ast2Asg ast2asg(mgr);
+  asg::Ast2Asg ast2asg(mgr, lexer);
   auto asg = ast2asg(ast->translationUnit());
   mgr.mRoot = asg;
-  mgr.gc();
+  elapsed("构建语义图");
+  collected(mgr.gc(), "语法分析");
+  elapsed("垃圾回收");
 
   asg::Typing inferType(mgr);
-  inferType(asg);
-  mgr.gc();
+  inferType(asg, jobs);
+  elapsed("类型检查");
+  collected(mgr.gc_young(), "类型检查"); // 只回收类型检查新建的结点
+  elapsed("垃圾回收");
+  // 由环境变量 YATCC_COMPACT 打开，比较指针布局和紧凑布局，见 Compact.hpp
+  if (verbose && std::getenv("YATCC_COMPACT")) {
+    asg::compact::report(asg, std::cout);
+    elapsed("比较布局");
+  }
+
+  asg::Asg2Json asg2json(outFile);
+  asg2json(asg);
 
-  asg::Asg2Json asg2json;
-  llvm::json::Value json = asg2json(asg);
+  outFile << '\n';
+  elapsed("输出 JSON");
+  return 0;
+}
 
-  outFile << json << '\n';
+int
+main(int argc, char* argv[])
+{
+  bool batch = manifest::is_manifest(argc, argv);
+  if (!batch && argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " @<manifest>\n";
+    return -1;
+  }
+
+  auto opts = prediction::Options::from_env();
+  if (batch)
+    return manifest::main(argv[1], [&opts](const manifest::Entry& entry) {
+      return compile(
+        entry.mInput.c_str(), entry.mOutput.c_str(), false, opts, 1);
+    });
+
+  std::cout << "程序 " << argv[0] << std::endl;
+  std::cout << "输入 " << argv[1] << std::endl;
+  std::cout << "输出 " << argv[2] << std::endl;
+  return compile(argv[1], argv[2], true, opts, pool::num_jobs());
 }
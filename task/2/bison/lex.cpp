@@ -1,49 +1,147 @@
 #include "lex.hpp"
-#include <cstring>
+#include <algorithm>
+#include <cassert>
 #include <iostream>
-#include <unordered_map>
+#include <vector>
 
 namespace lex {
 
-G g;
-
 int
-come_line(const char* yytext, int yyleng, int yylineno)
+token_id(tok::Kind kind)
 {
-  char name[64];
-  char value[64];
-  sscanf(yytext, "%s '%[^']'", name, value);
-
-  static const std::unordered_map<std::string, int> kTokenId = {
-    { "identifier", IDENTIFIER },
-    { "numeric_constant", CONSTANT },
-    { "int", INT },
-    { "void", VOID },
-    { "return", RETURN },
-    { "l_paren", '(' },
-    { "r_paren", ')' },
-    { "l_brace", '{' },
-    { "r_brace", '}' },
-    { "semi", ';' },
-    { "equal", '=' },
-    { "l_square", '[' },
-    { "r_square", ']' },
-    { "comma", ',' },
-    { "minus", '-' },
-    { "plus", '+' },
-    { "eof", YYEOF },
+  switch (kind) {
+    case tok::Kind::kEof:
+      return YYEOF;
+    case tok::Kind::kIdentifier:
+      return IDENTIFIER;
+    case tok::Kind::kNumericConstant:
+      return CONSTANT;
+    case tok::Kind::kInt:
+      return INT;
+    case tok::Kind::kVoid:
+      return VOID;
+    case tok::Kind::kReturn:
+      return RETURN;
     // TODO 添加其他的 token
-  };
+    default:
+      break;
+  }
+
+  // 单字符的标点直接以字符作词号
+  auto spelling = tok::spelling(kind);
+  if (spelling.size() == 1)
+    return spelling[0];
+  return YYUNDEF;
+}
+
+tok::Kind
+token_kind(int tokenId)
+{
+  switch (tokenId) {
+    case YYEOF:
+      return tok::Kind::kEof;
+    case IDENTIFIER:
+      return tok::Kind::kIdentifier;
+    case CONSTANT:
+      return tok::Kind::kNumericConstant;
+    case INT:
+      return tok::Kind::kInt;
+    case VOID:
+      return tok::Kind::kVoid;
+    case RETURN:
+      return tok::Kind::kReturn;
+    default:
+      break;
+  }
+
+  if (0 < tokenId && tokenId < 256) {
+    char c = tokenId;
+    return tok::from_spelling({ &c, 1 });
+  }
+  return tok::Kind::kINVALID;
+}
+
+int
+come_line(G& g, const char* yytext, int yyleng, int yylineno)
+{
+  // 每行形如 名字 '原文'\t[StartOfLine]\t[LeadingSpace]\tLoc=<文件:行:列>
+  std::string_view text(yytext, yyleng);
+  auto nameEnd = std::min(text.find(' '), text.size());
+  auto kind = tok::from_name(text.substr(0, nameEnd));
+  assert(kind != tok::Kind::kINVALID);
+  auto tokenId = token_id(kind);
+
+  // 位置段形如 Loc=<文件:行:列>，文件路径不变时不必再查文件表
+  auto locBegin = text.rfind("Loc=<");
+  if (locBegin != std::string_view::npos) {
+    auto locEnd = text.find('>', locBegin);
+    auto colSep = text.rfind(':', locEnd);
+    auto lineSep = colSep == 0 ? text.npos : text.rfind(':', colSep - 1);
+    if (locEnd != text.npos && lineSep != text.npos && lineSep >= locBegin + 5) {
+      auto file = text.substr(locBegin + 5, lineSep - locBegin - 5);
+      if (file != g.mFile) {
+        g.mFile = file;
+        g.mFileId = g.mFiles.id(file);
+      }
+      g.mLine = atoi(yytext + lineSep + 1);
+      g.mColumn = atoi(yytext + colSep + 1);
+      *g.mLloc = SourceLoc(g.mFileId, g.mLine, g.mColumn);
+    }
+  }
 
-  auto iter = kTokenId.find(name);
-  assert(iter != kTokenId.end());
+  // 原文在第一个单引号和位置段前的最后一个单引号之间，其中可能还有单引号
+  std::string_view value;
+  auto valueEnd = text.rfind('\'', locBegin);
+  if (valueEnd != text.npos && valueEnd > nameEnd + 1)
+    value = text.substr(nameEnd + 2, valueEnd - nameEnd - 2);
 
-  yylval.RawStr = new std::string(value, strlen(value));
-  return iter->second;
+  // 标识符和常量都直接驻留，相同的常量只保存一份
+  if (tokenId == IDENTIFIER || tokenId == CONSTANT)
+    g.mLval->Sym = Symbol(value);
+  return tokenId;
+}
+
+bool
+open_binary(G& g, std::string_view data)
+{
+  if (!tokstream::Reader::is_stream(data))
+    return false;
+  g.mReader.emplace(data.data(), data.data() + data.size());
+  return true;
+}
+
+int
+come_binary(G& g)
+{
+  tokstream::Token token;
+  if (!g.mReader->next(token))
+    return YYEOF;
+
+  while (g.mFileIds.size() < g.mReader->num_files())
+    g.mFileIds.push_back(g.mFiles.id(g.mReader->file(g.mFileIds.size())));
+  auto loc = token.mLoc;
+  g.mFileId = g.mFileIds[loc.file()];
+  g.mLine = loc.line();
+  g.mColumn = loc.column();
+  g.mStartOfLine = token.mStartOfLine;
+  g.mLeadingSpace = token.mLeadingSpace;
+  *g.mLloc = SourceLoc(g.mFileId, g.mLine, g.mColumn);
+
+  // 每个不同的文本只驻留一次
+  auto tokenId = token_id(token.mKind);
+  if (tokenId == IDENTIFIER || tokenId == CONSTANT) {
+    g.mSymbols.resize(g.mReader->num_texts(), Symbol{});
+    auto& sym = g.mSymbols[token.mText];
+    if (sym.empty())
+      sym = Symbol(g.mReader->text(token.mText));
+    g.mLval->Sym = sym;
+  }
+  g.mId = tokenId;
+  return tokenId;
 }
 
 int
-come(int tokenId, const char* yytext, int yyleng, int yylineno)
+come(G& g, int tokenId, const char* yytext, int yyleng, int yylineno)
 {
   g.mId = tokenId;
   g.mText = { yytext, std::size_t(yyleng) };
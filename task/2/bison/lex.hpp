@@ -1,28 +1,68 @@
 #pragma once
 
+#include "TokenKinds.hpp"
+#include "TokenStream.hpp"
 #include "par.y.hh"
+#include <cstdio>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <cstdio>
+#include <vector>
 
 namespace lex {
 
+/// 一个词法分析器的全部状态，par::Context::mLex 指向它。扫描器是可重入的，
+/// 每个线程各用一个 G 就可以同时分析不同的文件。
 struct G
 {
   int mId{ YYEOF };             // 词号
   std::string_view mText;       // 对应文本
   std::string mFile;            // 文件路径
+  std::uint32_t mFileId{ 0 };   // mFile 在 mFiles 中的编号
   int mLine{ 0 }, mColumn{ 0 }; // 行号、列号
   bool mStartOfLine{ true };    // 是否是行首
   bool mLeadingSpace{ false };  // 是否有前导空格
+
+  YYSTYPE* mLval{ nullptr }; // 语义值写到这里，每次 yylex 时更新
+  SourceLoc* mLloc{ nullptr }; // 位置写到这里，每次 yylex 时更新
+  void* mScanner{ nullptr };   // flex 的 yyscan_t，读取文本格式时有效
+
+  std::optional<tokstream::Reader> mReader; // 读取二进制词法单元流时有效
+  std::vector<Symbol> mSymbols;             // 按流内文本号缓存的符号
+  std::vector<std::uint32_t> mFileIds;      // 流内文件号到 mFiles 中的编号
+
+  SourceLoc::Files mFiles; // 本次分析的文件表，位置中的文件号都指向这里
 };
 
-extern G g;
+/// clang 的词法单元种类对应的 par.y 词号，文法里没有的返回 YYUNDEF
+int
+token_id(tok::Kind kind);
+
+/// token_id 的逆映射，不认识的词号返回 tok::Kind::kINVALID
+tok::Kind
+token_kind(int tokenId);
+
+/// 为 \p g 创建 flex 扫描器，从 \p in 读取文本格式的词法单元
+void
+open_text(G& g, std::FILE* in);
+
+/// 若 \p data 是二进制词法单元流，之后 \p g 改由 come_binary 从中读取并返回
+/// true。\p data 在语法分析期间须保持有效。
+bool
+open_binary(G& g, std::string_view data);
+
+/// 释放 open_text 创建的扫描器
+void
+close(G& g);
+
+int
+come_line(G& g, const char* yytext, int yyleng, int yylineno);
 
+/// 从二进制词法单元流中读取下一个词法单元
 int
-come_line(const char* yytext, int yyleng, int yylineno);
+come_binary(G& g);
 
 int
-come(int tokenId, const char* yytext, int yyleng, int yylineno);
+come(G& g, int tokenId, const char* yytext, int yyleng, int yylineno);
 
 } // namespace lex
@@ -1,55 +1,144 @@
 #include "Asg2Json.hpp"
+#include "Compact.hpp"
+#include "Manifest.hpp"
+#include "Pool.hpp"
 #include "Typing.hpp"
-#include "lex.l.hh"
+#include "lex.hpp"
 #include "par.y.hh"
+#include "trace.hpp"
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <llvm/Support/MemoryBuffer.h>
+#include <optional>
 
 extern int yydebug;
 
-int
-main(int argc, char* argv[])
+/// 打印从 \p since 到现在经过的时间，并把 \p since 更新为现在
+static void
+print_elapsed(const char* phase, std::chrono::steady_clock::time_point& since)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> ms = now - since;
+  std::cout << "耗时[" << phase << "]：" << ms.count() << " ms" << std::endl;
+  since = now;
+}
 
-  yyin = fopen(argv[1], "r");
-  if (!yyin) {
-    std::cerr << "Failed to open " << argv[1] << '\n';
+/// 分析词法单元流 \p inName ，把类型检查后的语义图以 JSON 写到 \p outName ，
+/// 返回值同进程退出码。状态都在局部的 par::Context 和 lex::G 里，可以在多个
+/// 线程中同时调用。类型检查时用 \p jobs 个线程按函数并行。
+static int
+compile(const char* inName,
+        const char* outName,
+        bool verbose,
+        const par::Trace::Options& traceOpts,
+        unsigned jobs)
+{
+  // 二进制词法单元流直接在映射的文件上读取，文本格式仍交给 flex
+  auto inBuf = llvm::MemoryBuffer::getFile(inName);
+  if (!inBuf) {
+    std::cerr << "Failed to open " << inName << '\n';
     return -2;
   }
 
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
+  llvm::StringRef outPath(outName);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outName << '\n';
     return -3;
   }
 
-  std::cout << "程序 " << argv[0] << std::endl;
-  std::cout << "输入 " << argv[1] << std::endl;
-  std::cout << "输出 " << argv[2] << std::endl;
+  lex::G lexer;
+  std::FILE* inFile = nullptr;
+  if (!lex::open_binary(lexer, (*inBuf)->getBuffer())) {
+    inFile = fopen(inName, "r");
+    if (!inFile) {
+      std::cerr << "Failed to open " << inName << '\n';
+      return -2;
+    }
+    lex::open_text(lexer, inFile);
+  }
+
+  auto since = std::chrono::steady_clock::now();
+  auto elapsed = [&](const char* phase) {
+    if (verbose)
+      print_elapsed(phase, since);
+  };
+  auto collected = [&](const Obj::Mgr::Stats& stats, const char* phase) {
+    if (verbose)
+      stats.print(phase);
+  };
 
   // 从源代码生成抽象语义图
-  yydebug = 1; // 启用 Bison 的调试输出
-  if (auto e = yyparse())
+  par::Context ctx;
+  ctx.mLex = &lexer;
+  std::optional<par::Trace> trace;
+  if (traceOpts.enabled())
+    ctx.mTrace = &trace.emplace(traceOpts);
+  auto e = yyparse(ctx);
+  lex::close(lexer);
+  if (inFile)
+    fclose(inFile);
+  if (trace) {
+    trace->finish();
+    if (traceOpts.mSummary)
+      trace->print_summary(std::cout, inName);
+    if (e && traceOpts.mRing)
+      trace->print_ring(std::cerr); // 出错时看看之前发生了什么
+  }
+  if (e)
     return e;
-  par::gMgr.mRoot = par::gTranslationUnit;
-  par::gMgr.gc();
+  ctx.mMgr.mRoot = ctx.mTranslationUnit;
+  elapsed("语法分析");
+  collected(ctx.mMgr.gc(), "语法分析");
+  elapsed("垃圾回收");
 
   // 执行类型检查
-  asg::Typing typing(par::gMgr);
-  typing(par::gTranslationUnit);
+  asg::Typing typing(ctx.mMgr);
+  typing(ctx.mTranslationUnit, jobs);
+  elapsed("类型检查");
   typing.mTypeCache.clear();
-  par::gMgr.gc();
+  collected(ctx.mMgr.gc_young(), "类型检查"); // 只回收类型检查新建的结点
+  elapsed("垃圾回收");
+  // 由环境变量 YATCC_COMPACT 打开，比较指针布局和紧凑布局，见 Compact.hpp
+  if (verbose && std::getenv("YATCC_COMPACT")) {
+    asg::compact::report(ctx.mTranslationUnit, std::cout);
+    elapsed("比较布局");
+  }
 
   // 将抽象语义图转换为 JSON 并输出
-  asg::Asg2Json asg2json;
-  llvm::json::Value json = asg2json(par::gTranslationUnit);
-  outFile << json << '\n';
+  asg::Asg2Json asg2json(outFile);
+  asg2json(ctx.mTranslationUnit);
+  outFile << '\n';
+  elapsed("输出 JSON");
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  // 跟踪默认关闭，由环境变量 YATCC_TRACE 逐次打开，见 trace.hpp。yydebug 是
+  // Bison 仍保留的全局变量，在启动工作线程之前设置。
+  auto traceOpts = par::Trace::Options::from_env();
+  yydebug = traceOpts.mText;
+
+  if (manifest::is_manifest(argc, argv))
+    return manifest::main(argv[1], [&](const manifest::Entry& entry) {
+      return compile(
+        entry.mInput.c_str(), entry.mOutput.c_str(), false, traceOpts, 1);
+    });
+
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " @<manifest>\n";
+    return -1;
+  }
+
+  std::cout << "程序 " << argv[0] << std::endl;
+  std::cout << "输入 " << argv[1] << std::endl;
+  std::cout << "输出 " << argv[2] << std::endl;
 
-  fclose(yyin);
+  return compile(argv[1], argv[2], true, traceOpts, pool::num_jobs());
 }
@@ -6,16 +6,28 @@
 
 namespace par {
 
-Obj::Mgr gMgr;
-asg::TranslationUnit* gTranslationUnit;
-asg::FunctionDecl* gCurrentFunction;
+Symtbl::Symtbl(Context& ctx)
+  : mCtx(ctx)
+  , mPrev(ctx.mSymtbl)
+{
+  ctx.mSymtbl = this;
+}
 
-Symtbl* Symtbl::g{ nullptr };
+Symtbl::~Symtbl()
+{
+  mCtx.mSymtbl = mPrev;
+}
+
+Context::~Context()
+{
+  while (mSymtbl)
+    delete mSymtbl;
+}
 
 asg::Decl*
-Symtbl::resolve(const std::string& name)
+Context::resolve(Symbol name) const
 {
-  auto cur = g;
+  auto cur = mSymtbl;
   while (cur) {
     auto iter = cur->find(name);
     if (iter != cur->end())
@@ -28,8 +40,8 @@ Symtbl::resolve(const std::string& name)
 } // namespace par
 
 void
-yyerror(char const* s)
+yyerror(SourceLoc* loc, par::Context&, char const* s)
 {
   fflush(stdout);
-  printf("\n%*s\n%*s\n", lex::g.mLine, "^", lex::g.mColumn, s);
+  printf("\n%*s\n%*s\n", int(loc->line()), "^", int(loc->column()), s);
 }
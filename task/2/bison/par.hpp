@@ -4,32 +4,59 @@
 #include <memory>
 #include <stack>
 #include <unordered_map>
+#include <vector>
+
+namespace lex {
+struct G;
+}
 
 namespace par {
 
-extern Obj::Mgr gMgr;
-extern asg::TranslationUnit* gTranslationUnit;
-extern asg::FunctionDecl* gCurrentFunction;
+struct Context;
+class Trace;
 
-/// 符号表，语法树遍历的过程中，Symtbl::g 和 Symtbl::mPrev
+/// 符号表，语法树遍历的过程中，Context::mSymtbl 和 Symtbl::mPrev
 /// 隐式地构成了一个单向链表，每一个结点对应一个作用域。
-struct Symtbl : std::unordered_map<std::string, asg::Decl*>
+struct Symtbl : std::unordered_map<Symbol, asg::Decl*>
 {
-  static Symtbl* g; ///< 当前符号表
-
-  /// 查找符号表，返回标识符 \p name 对应的声明语义结点
-  static asg::Decl* resolve(const std::string& name);
+  /// 开启新的作用域，成为 \p ctx 的当前符号表
+  explicit Symtbl(Context& ctx);
 
-  Symtbl()
-    : mPrev(g)
-  {
-    g = this;
-  }
-
-  ~Symtbl() { g = mPrev; }
+  ~Symtbl();
 
 private:
+  Context& mCtx;
   Symtbl* mPrev; ///< 上一级符号表
+
+  friend struct Context;
+};
+
+/**
+ * @brief 一次语法分析的全部状态
+ *
+ * 语法分析器是纯的（api.pure），不使用任何全局变量，动作中通过 yyparse 的参数
+ * ctx 访问这里的状态。每个 Context 有自己的 Obj::Mgr，因此不同线程可以各用一个
+ * Context 同时分析不同的文件。
+ */
+struct Context
+{
+  Obj::Mgr mMgr{ true }; ///< 语义图结点都分配在这里，启用内存池模式
+  asg::TranslationUnit* mTranslationUnit{ nullptr }; ///< 分析结果
+  asg::FunctionDecl* mCurrentFunction{ nullptr };    ///< 正在分析的函数
+  Symtbl* mSymtbl{ nullptr };                        ///< 当前符号表
+  lex::G* mLex{ nullptr }; ///< 词法分析器的状态，由调用者设置
+  Trace* mTrace{ nullptr }; ///< 非空时记录跟踪信息，见 trace.hpp
+  std::vector<char> mStacks[3]; ///< 扩大后的分析栈，见 par.y 中的 yyoverflow
+
+  Context() = default;
+  Context(const Context&) = delete;
+  Context& operator=(const Context&) = delete;
+
+  /// 语法错误时可能还有未关闭的作用域
+  ~Context();
+
+  /// 查找符号表，返回标识符 \p name 对应的声明语义结点
+  asg::Decl* resolve(Symbol name) const;
 };
 
 using Decls = std::vector<asg::Decl*>;
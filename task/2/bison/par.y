@@ -4,18 +4,69 @@
 /* 用于调试 (yydebug) */
 %define parse.trace
 
-%code top {
-int yylex (void);             // 该函数由 Flex 生成
-void yyerror (char const *);	// 该函数定义在 par.cpp 中
-}
+/* 位置即 SourceLoc，由词法分析器写入 yylloc，动作中用 @n 取得 */
+%locations
+%define api.location.type {SourceLoc}
+
+/* 纯语法分析器：yylval、yylloc 都是 yyparse 的局部变量，其余状态在 ctx 里，
+ * yyparse、yylex 和 yyerror 都多一个 ctx 参数 */
+%define api.pure full
+%param {par::Context& ctx}
 
 %code requires {
 #include "par.hpp"
 #include <iostream>
 }
 
+%code provides {
+int yylex (YYSTYPE* yylval, SourceLoc* yylloc, par::Context& ctx); // 定义在 lex.l 中
+void yyerror (SourceLoc* yylloc, par::Context& ctx, char const* s); // 定义在 par.cpp 中
+}
+
+%code {
+#include "trace.hpp"
+#include <cstring>
+
+/* 非终结符的位置取其第一个符号的位置，空产生式取前一个符号的位置。
+ * 每次归约执行语义动作前都会求默认位置，顺便在这里埋点跟踪，此时 yyn 是
+ * 要归约的产生式编号。文法里没有 error 产生式，出错恢复时不会走到这里。 */
+#define YYLLOC_DEFAULT(Cur, Rhs, N) \
+  ((Cur) = (N) ? YYRHSLOC(Rhs, 1) : YYRHSLOC(Rhs, 0), \
+   ctx.mTrace ? ctx.mTrace->reduce(yyn, (Cur)) : void())
+
+/* yyparse 的三个分析栈一开始是原生栈上 YYINITDEPTH 层的数组。以 C++ 编译时
+ * bison 不认为自定义的位置类型可以按字节搬动，栈满了也不会扩大，`a = b = ...`
+ * 这样右递归的输入稍长就报 memory exhausted。这里提供 yyoverflow，把三个栈按
+ * 字节搬到 ctx 名下的堆内存里，每次翻倍，直到 YYMAXDEPTH 层。 */
+#define YYMAXDEPTH 10000000
+
+static_assert(std::is_trivially_copyable_v<SourceLoc>);
+
+template<typename T>
+static void
+relocate(std::vector<char>& buf, T** stack, std::size_t bytes, std::size_t size)
+{
+  std::vector<char> bigger(size * sizeof(T));
+  std::memcpy(bigger.data(), *stack, bytes);
+  buf.swap(bigger);
+  *stack = reinterpret_cast<T*>(buf.data());
+}
+
+#define yyoverflow(Msg, Ss, SsBytes, Vs, VsBytes, Ls, LsBytes, Size) \
+  do { \
+    if (*(Size) >= YYMAXDEPTH) { \
+      yyerror(&yylloc, ctx, Msg); \
+      break; /* 栈没有扩大，yyparse 随后返回 1 */ \
+    } \
+    *(Size) = std::min<std::size_t>(*(Size) * 2, YYMAXDEPTH); \
+    relocate(ctx.mStacks[0], Ss, SsBytes, *(Size)); \
+    relocate(ctx.mStacks[1], Vs, VsBytes, *(Size)); \
+    relocate(ctx.mStacks[2], Ls, LsBytes, *(Size)); \
+  } while (0)
+}
+
 %union {
-  std::string* RawStr;
+  Symbol Sym;
   par::Decls* Decls;
   par::Exprs* Exprs;
 
@@ -54,7 +105,8 @@ void yyerror (char const *);	// 该函数定义在 par.cpp 中
 
 %type <TranslationUnit> translation_unit
 
-%token <RawStr> IDENTIFIER CONSTANT
+%token <Sym> IDENTIFIER
+%token <Sym> CONSTANT
 %token INT VOID
 
 %token RETURN
@@ -66,19 +118,19 @@ void yyerror (char const *);	// 该函数定义在 par.cpp 中
 // 起始符号
 start
   :	{
-      par::Symtbl::g = new par::Symtbl();
+      new par::Symtbl(ctx);
     }
     translation_unit
     {
-      par::gTranslationUnit = $2;
-      delete par::Symtbl::g;
+      ctx.mTranslationUnit = $2;
+      delete ctx.mSymtbl;
     }
   ;
 
 translation_unit
   : external_declaration
     {
-      $$ = par::gMgr.make<asg::TranslationUnit>();
+      $$ = ctx.mMgr.make<asg::TranslationUnit>();
       for (auto&& decl: *$1)
         $$->decls.push_back(decl);
       delete $1;
@@ -107,8 +159,8 @@ function_definition
       auto funcDecl = $2->dcst<asg::FunctionDecl>();
       ASSERT(funcDecl);
       // 设置当前全局的函数作用变量
-      par::gCurrentFunction = funcDecl; 
-      auto ty = par::gMgr.make<asg::Type>();
+      ctx.mCurrentFunction = funcDecl; 
+      auto ty = ctx.mMgr.make<asg::Type>();
       if (funcDecl->type != nullptr)
         ty->texp = funcDecl->type->texp; 
       ty->spec = $1->spec, ty->qual = $1->qual;
@@ -117,7 +169,7 @@ function_definition
     }
     compound_statement
     {	
-      $$ = par::gCurrentFunction;
+      $$ = ctx.mCurrentFunction;
       $$->name = $2->name;
       $$->body = $4;
     }
@@ -128,7 +180,7 @@ declaration
     {
       for (auto decl: *$2)
       {
-        auto ty = par::gMgr.make<asg::Type>();
+        auto ty = ctx.mMgr.make<asg::Type>();
         if (decl->type != nullptr)
           ty->texp = decl->type->texp; // 保留前面 ArrayType 的texp
         ty->spec = $1->spec, ty->qual = $1->qual;
@@ -156,12 +208,12 @@ declaration_specifiers
 type_specifier
   : VOID
     {
-      $$ = par::gMgr.make<asg::Type>();
+      $$ = ctx.mMgr.make<asg::Type>();
       $$->spec = asg::Type::Spec::kVoid;
     }
   | INT
     {
-      $$ = par::gMgr.make<asg::Type>();
+      $$ = ctx.mMgr.make<asg::Type>();
       $$->spec = asg::Type::Spec::kInt;
     }
   ;
@@ -169,21 +221,21 @@ type_specifier
 declarator
   : IDENTIFIER
     {
-      $$ = par::gMgr.make<asg::VarDecl>();
-      $$->name = std::move(*$1);
-      delete $1;
+      $$ = ctx.mMgr.make<asg::VarDecl>();
+      $$->name = $1;
+      $$->loc = @1;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      ctx.mSymtbl->insert_or_assign($$->name, $$);
     }
   | declarator '[' ']' // 未知长度数组
     {
       $$ = $1; 
       // 填充Type
-      auto ty = par::gMgr.make<asg::Type>();
+      auto ty = ctx.mMgr.make<asg::Type>();
       if ($$->type != nullptr)
         ty->texp=$$->type->texp;
-      auto p = par::gMgr.make<asg::ArrayType>();
+      auto p = ctx.mMgr.make<asg::ArrayType>();
       p->len = asg::ArrayType::kUnLen;
       if (ty->texp == nullptr)
       {
@@ -196,19 +248,21 @@ declarator
       $$->type = ty;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      ctx.mSymtbl->insert_or_assign($$->name, $$);
     }
   | declarator '[' assignment_expression ']' // 数组定义
     {
       $$ = $1; 
       // 填充Type
-      auto ty = par::gMgr.make<asg::Type>();
+      auto ty = ctx.mMgr.make<asg::Type>();
       if ($$->type != nullptr)
         ty->texp=$$->type->texp;
-      auto p = par::gMgr.make<asg::ArrayType>();
-      auto integerLiteral = $3->dcst<asg::IntegerLiteral>();
-      ASSERT(integerLiteral);
-      p->len = integerLiteral->val;
+      auto p = ctx.mMgr.make<asg::ArrayType>();
+      // 字面量直接取值，其它常量表达式留给 Typing 求值
+      if (auto integerLiteral = $3->dcst<asg::IntegerLiteral>())
+        p->len = integerLiteral->val;
+      else
+        p->lenExpr = $3;
       if (ty->texp == nullptr)
       {
         ty->texp = p;
@@ -220,28 +274,30 @@ declarator
       $$->type = ty;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      ctx.mSymtbl->insert_or_assign($$->name, $$);
     }
   | declarator '(' ')'
     {
-      $$ = par::gMgr.make<asg::FunctionDecl>();
+      $$ = ctx.mMgr.make<asg::FunctionDecl>();
       $$->name = $1->name;
-      auto ty = par::gMgr.make<asg::Type>();
-      auto p = par::gMgr.make<asg::FunctionType>();
+      $$->loc = $1->loc;
+      auto ty = ctx.mMgr.make<asg::Type>();
+      auto p = ctx.mMgr.make<asg::FunctionType>();
       ty->texp = p;
       $$->type = ty;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      ctx.mSymtbl->insert_or_assign($$->name, $$);
     }
   // 函数列表的定义
   | declarator '(' parameter_list ')'
     {
-      auto p = par::gMgr.make<asg::FunctionDecl>();
+      auto p = ctx.mMgr.make<asg::FunctionDecl>();
       p->name = $1->name;
+      p->loc = $1->loc;
       p->params = *$3;
-      auto ty = par::gMgr.make<asg::Type>();
-      auto functionType = par::gMgr.make<asg::FunctionType>();
+      auto ty = ctx.mMgr.make<asg::Type>();
+      auto functionType = ctx.mMgr.make<asg::FunctionType>();
       for (auto decl: *$3)
       {
         functionType->params.push_back(decl->type);
@@ -251,7 +307,7 @@ declarator
       $$ = p;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      ctx.mSymtbl->insert_or_assign($$->name, $$);
     }
   ;
 
@@ -272,7 +328,7 @@ parameter_declaration
   : declaration_specifiers declarator
     {
       // 保留之前定义的 Type
-      auto ty = par::gMgr.make<asg::Type>();
+      auto ty = ctx.mMgr.make<asg::Type>();
       if ($2->type != nullptr)
         ty->texp = $2->type->texp;
       ty->spec = $1->spec, ty->qual = $1->qual;
@@ -282,22 +338,27 @@ parameter_declaration
   ;
 
 compound_statement
-  : {$$ = par::gMgr.make<asg::CompoundStmt>();} // 代码块为空的情况
-  |'{' '}' { $$ = par::gMgr.make<asg::CompoundStmt>(); }
+  : {$$ = ctx.mMgr.make<asg::CompoundStmt>();} // 代码块为空的情况
+  |'{' '}'
+    {
+      $$ = ctx.mMgr.make<asg::CompoundStmt>();
+      $$->loc = @1;
+    }
   | '{'
-    { new par::Symtbl(); } 		// 开启新的符号表作用域
+    { new par::Symtbl(ctx); } 		// 开启新的符号表作用域
     block_item_list
     '}'
     {
-      delete par::Symtbl::g; 	// 结束符号表作用域
+      delete ctx.mSymtbl; 	// 结束符号表作用域
       $$ = $block_item_list;
+      $$->loc = @1;
     }
   ;
 
 block_item_list
   : block_item
     {
-      $$ = par::gMgr.make<asg::CompoundStmt>();
+      $$ = ctx.mMgr.make<asg::CompoundStmt>();
       $$->subs.push_back($1);
     }
   | block_item_list block_item
@@ -310,7 +371,8 @@ block_item_list
 block_item
   : declaration
     {
-      auto p = par::gMgr.make<asg::DeclStmt>();
+      auto p = ctx.mMgr.make<asg::DeclStmt>();
+      p->loc = @1;
       for (auto decl: *$1)
         p->decls.push_back(decl);
       $$ = p;
@@ -327,7 +389,8 @@ statement
 expression_statement
   : expression ';'
     {
-      $$ = par::gMgr.make<asg::ExprStmt>();
+      $$ = ctx.mMgr.make<asg::ExprStmt>();
+      $$->loc = @1;
       $$->expr = $1;
     }
   ;
@@ -335,13 +398,15 @@ expression_statement
 jump_statement
   : RETURN ';'
     {
-      $$ = par::gMgr.make<asg::ReturnStmt>();
-      $$->func = par::gCurrentFunction;
+      $$ = ctx.mMgr.make<asg::ReturnStmt>();
+      $$->loc = @1;
+      $$->func = ctx.mCurrentFunction;
     }
   | RETURN expression ';'
     {
-      $$ = par::gMgr.make<asg::ReturnStmt>();
-      $$->func = par::gCurrentFunction;
+      $$ = ctx.mMgr.make<asg::ReturnStmt>();
+      $$->loc = @1;
+      $$->func = ctx.mCurrentFunction;
       $$->expr = $2;
     }
 
@@ -349,7 +414,8 @@ expression
   : assignment_expression { $$ = $1; }
   | expression ',' assignment_expression
     {
-      auto p = par::gMgr.make<asg::BinaryExpr>();
+      auto p = ctx.mMgr.make<asg::BinaryExpr>();
+      p->loc = @2;
       p->op = asg::BinaryExpr::Op::kComma;
       p->lft = $1, p->rht = $3;
       $$ = p;
@@ -360,7 +426,8 @@ assignment_expression
   : logical_or_expression { $$ = $1; }
   | unary_expression '=' assignment_expression
     {
-      auto p = par::gMgr.make<asg::BinaryExpr>();
+      auto p = ctx.mMgr.make<asg::BinaryExpr>();
+      p->loc = @2;
       p->op = asg::BinaryExpr::Op::kAssign;;
       p->lft = $1, p->rht = $3;
       $$ = p;
@@ -387,14 +454,16 @@ additive_expression
   : multiplicative_expression { $$ = $1;}
   | additive_expression '+' multiplicative_expression
     {
-      auto p = par::gMgr.make<asg::BinaryExpr>();
+      auto p = ctx.mMgr.make<asg::BinaryExpr>();
+      p->loc = @2;
       p->op = asg::BinaryExpr::Op::kAdd;
       p->lft = $1, p->rht = $3;
       $$ = p;
     }
   | additive_expression '-' multiplicative_expression
     {
-      auto p = par::gMgr.make<asg::BinaryExpr>();
+      auto p = ctx.mMgr.make<asg::BinaryExpr>();
+      p->loc = @2;
       p->op = asg::BinaryExpr::Op::kSub;
       p->lft = $1, p->rht = $3;
       $$ = p;
@@ -409,7 +478,8 @@ unary_expression
   : postfix_expression { $$ = $1;}
   | '-' unary_expression
     {
-      auto p = par::gMgr.make<asg::UnaryExpr>();
+      auto p = ctx.mMgr.make<asg::UnaryExpr>();
+      p->loc = @1;
       p->op = asg::UnaryExpr::Op::kNeg;
       p->sub = $2;
       $$ = p;
@@ -424,18 +494,18 @@ primary_expression
   : IDENTIFIER
     {
       // 查找符号表, 找到对应的Decl
-      auto decl = par::Symtbl::resolve(*$1);
+      auto decl = ctx.resolve($1);
       ASSERT(decl);
-      delete $1;
-      auto p = par::gMgr.make<asg::DeclRefExpr>();
+      auto p = ctx.mMgr.make<asg::DeclRefExpr>();
+      p->loc = @1;
       p->decl = decl;
       $$ = p;
     }
   | CONSTANT
     {
-      auto p = par::gMgr.make<asg::IntegerLiteral>();
-      p->val = std::stoull(*$1, nullptr, 10);
-      delete $1;
+      auto p = ctx.mMgr.make<asg::IntegerLiteral>();
+      p->loc = @1;
+      p->val = std::stoull($1.str(), nullptr, 10);
       $$ = p;
     }
   ;
@@ -491,7 +561,8 @@ initializer
       }
       else
       {
-        auto p = par::gMgr.make<asg::InitListExpr>();
+        auto p = ctx.mMgr.make<asg::InitListExpr>();
+        p->loc = @1;
         p->list.push_back($1);
         $$ = p;
       }
@@ -503,7 +574,8 @@ initializer
     }
   | '{' '}'
     {
-      auto p = par::gMgr.make<asg::InitListExpr>();
+      auto p = ctx.mMgr.make<asg::InitListExpr>();
+      p->loc = @1;
       $$ = p;
     }
   ;
@@ -525,3 +597,21 @@ initializer_list
   ;
 
 %%
+
+namespace par {
+
+std::string
+rule_name(int rule)
+{
+  // yysymbol_name、yyr1 和 yyrline 是生成文件里的静态表，只能在这里访问
+  return std::string(yysymbol_name(yysymbol_kind_t(yyr1[rule]))) + '@' +
+         std::to_string(yyrline[rule]);
+}
+
+int
+num_rules()
+{
+  return YYNRULES + 1;
+}
+
+} // namespace par
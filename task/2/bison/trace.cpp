@@ -0,0 +1,118 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace par {
+
+Trace::Options
+Trace::Options::from_env()
+{
+  Options opts;
+  auto env = std::getenv("YATCC_TRACE");
+  if (!env)
+    return opts;
+
+  std::istringstream in(env);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (item == "text")
+      opts.mText = true;
+    else if (item == "summary")
+      opts.mSummary = true;
+    else if (item == "ring")
+      opts.mRing = 4096;
+    else if (item.compare(0, 5, "ring=") == 0)
+      opts.mRing = std::strtoul(item.c_str() + 5, nullptr, 10);
+  }
+  return opts;
+}
+
+Trace::Trace(const Options& opts)
+  : mSummary(opts.mSummary)
+  , mLast(Clock::now())
+{
+  if (mSummary)
+    mRules.resize(num_rules());
+
+  if (opts.mRing != 0) {
+    std::size_t size = 1;
+    while (size < opts.mRing)
+      size <<= 1;
+    mRing.resize(size);
+  }
+}
+
+void
+Trace::record(Clock::time_point now, int rule, int token, SourceLoc loc)
+{
+  auto nanos =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(now - mLast).count();
+  mLast = now;
+
+  auto& e = mRing[mNext++ & (mRing.size() - 1)];
+  e.mNanos = std::uint32_t(
+    std::min<std::int64_t>(nanos, std::numeric_limits<std::uint32_t>::max()));
+  e.mLoc = loc.bits();
+  e.mRule = std::uint16_t(rule);
+  e.mToken = std::uint16_t(token);
+}
+
+void
+Trace::print_summary(std::ostream& os, const char* title) const
+{
+  using Ms = std::chrono::duration<double, std::milli>;
+
+  std::vector<int> order;
+  Clock::duration total{};
+  for (int i = 0; i < int(mRules.size()); ++i) {
+    if (mRules[i].mCount != 0)
+      order.push_back(i);
+    total += mRules[i].mTime;
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return mRules[a].mTime > mRules[b].mTime;
+  });
+
+  // 先拼成一整段再输出，批量模式下不同线程的统计不会交错
+  std::ostringstream out;
+  out << "归约统计[" << title << "]：词法单元 " << mTokens << "，读取耗时 "
+      << Ms(mLexTime).count() << " ms，归约耗时 " << Ms(total).count()
+      << " ms\n";
+  out << std::setw(10) << "次数" << std::setw(12) << "耗时(ms)"
+      << std::setw(10) << "ns/次"
+      << "  产生式\n";
+  for (auto i : order) {
+    auto& r = mRules[i];
+    auto ns = std::chrono::duration<double, std::nano>(r.mTime).count();
+    out << std::setw(10) << r.mCount << std::setw(12) << std::fixed
+        << std::setprecision(3) << Ms(r.mTime).count() << std::setw(10)
+        << std::setprecision(1) << ns / r.mCount << "  " << rule_name(i)
+        << '\n';
+  }
+  os << out.str() << std::flush;
+}
+
+void
+Trace::print_ring(std::ostream& os) const
+{
+  std::ostringstream out;
+  auto size = std::min<std::uint64_t>(mNext, mRing.size());
+  out << "最近的 " << size << " 个语法分析事件：\n";
+  for (auto i = mNext - size; i != mNext; ++i) {
+    auto& e = mRing[i & (mRing.size() - 1)];
+    auto loc = SourceLoc::from_bits(e.mLoc);
+    out << "  +" << e.mNanos << "ns\t" << loc.line() << ':' << loc.column()
+        << '\t';
+    if (e.mRule != 0)
+      out << "归约 " << rule_name(e.mRule) << '\n';
+    else
+      out << "读入 " << e.mToken << '\n';
+  }
+  os << out.str() << std::flush;
+}
+
+} // namespace par
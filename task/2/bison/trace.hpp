@@ -0,0 +1,131 @@
+#pragma once
+
+#include "SourceLoc.hpp"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace par {
+
+/// 产生式 \p rule 的名字，形如 `左部@行号`，行号指 par.y 中的行，定义在 par.y 里
+std::string
+rule_name(int rule);
+
+/// 产生式的个数，产生式编号都小于它，定义在 par.y 里
+int
+num_rules();
+
+/**
+ * @brief 语法分析跟踪
+ *
+ * Bison 自带的 yydebug 把每一次移进、归约都以文本打印出来，只适合调试很小的
+ * 输入。这里在语法分析器的两个位置埋点：每次归约开始时，以及每次向词法分析器
+ * 要词法单元的前后，据此统计每个产生式的归约次数和耗时。耗时从归约开始算到下
+ * 一个埋点，即包括语义动作和随后的状态转移，但不包括读词法单元。
+ *
+ * 另外可以把最近的事件以紧凑的二进制记录保存在一个环形缓冲区里，出错时打印
+ * 出来，看看出错前语法分析器都做了什么。
+ *
+ * par::Context::mTrace 为空时不跟踪，埋点只多一次判空。
+ */
+class Trace
+{
+public:
+  /// 跟踪的方式，由环境变量 YATCC_TRACE 指定
+  struct Options
+  {
+    bool mText{ false };    ///< 打开 Bison 的 yydebug 文本输出
+    bool mSummary{ false }; ///< 统计各产生式的归约次数和耗时
+    std::size_t mRing{ 0 }; ///< 环形缓冲区保存的事件数，0 表示不保存
+
+    /// 从 YATCC_TRACE 读取，值为逗号分隔的 text、summary、ring 或 ring=<事件数>
+    static Options from_env();
+
+    /// 是否需要 Trace 对象，只打开 text 时不需要
+    bool enabled() const { return mSummary || mRing != 0; }
+  };
+
+  explicit Trace(const Options& opts);
+
+  /// 开始用产生式 \p rule 归约，结果位于 \p loc
+  void reduce(int rule, SourceLoc loc)
+  {
+    auto now = mark();
+    if (mSummary) {
+      mRuleStart = now;
+      mRule = rule;
+    }
+    if (!mRing.empty())
+      record(now, rule, 0, loc);
+  }
+
+  /// 向词法分析器要下一个词法单元之前
+  void lex_begin() { mLexStart = mark(); }
+
+  /// 词法分析器返回了词号 \p token ，位置是 \p loc
+  void lex_end(int token, SourceLoc loc)
+  {
+    auto now = Clock::now();
+    mLexTime += now - mLexStart;
+    ++mTokens;
+    if (!mRing.empty())
+      record(now, 0, token, loc);
+  }
+
+  /// 语法分析结束，结算最后一个产生式
+  void finish() { mark(); }
+
+  /// 按耗时从高到低打印各产生式的统计，\p title 一般是输入文件名
+  void print_summary(std::ostream& os, const char* title) const;
+
+  /// 按时间顺序打印环形缓冲区里的事件
+  void print_ring(std::ostream& os) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /// 环形缓冲区里的一条记录
+  struct Event
+  {
+    std::uint32_t mNanos; ///< 距上一条记录的纳秒数，过大时饱和
+    std::uint32_t mLoc;   ///< SourceLoc::bits()
+    std::uint16_t mRule;  ///< 归约的产生式，0 表示读入了一个词法单元
+    std::uint16_t mToken; ///< 读入的词号
+  };
+
+  /// 各产生式的统计
+  struct RuleStats
+  {
+    std::uint64_t mCount{ 0 };
+    Clock::duration mTime{};
+  };
+
+  bool mSummary;
+  std::vector<RuleStats> mRules;
+  int mRule{ -1 }; ///< 正在计时的产生式，-1 表示没有
+  Clock::time_point mRuleStart, mLexStart;
+  Clock::duration mLexTime{};
+  std::uint64_t mTokens{ 0 };
+
+  std::vector<Event> mRing; ///< 大小是 2 的幂，为空时不记录
+  std::uint64_t mNext{ 0 }; ///< 下一条记录的序号
+  Clock::time_point mLast;  ///< 上一条记录的时间
+
+  /// 结算正在计时的产生式，返回当前时间
+  Clock::time_point mark()
+  {
+    auto now = Clock::now();
+    if (mRule >= 0) {
+      ++mRules[mRule].mCount;
+      mRules[mRule].mTime += now - mRuleStart;
+      mRule = -1;
+    }
+    return now;
+  }
+
+  void record(Clock::time_point now, int rule, int token, SourceLoc loc);
+};
+
+} // namespace par
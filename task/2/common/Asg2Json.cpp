@@ -4,19 +4,80 @@
 
 namespace asg {
 
-json::Object
-Asg2Json::operator()(TranslationUnit* tu)
+namespace {
+
+/// 按 C 语法转义字符串字面量的值，带上两侧的引号
+std::string
+quote(const std::string& val)
 {
-  json::Object ret;
+  std::string value;
+  value.push_back('"');
+  for (auto&& c : val) {
+    switch (c) {
+      case '\'':
+        value += "\\'";
+        break;
 
-  ret["kind"] = "TranslationUnitDecl";
+      case '"':
+        value += "\\\"";
+        break;
 
-  json::Array inner;
-  for (auto&& i : tu->decls)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+      case '\?':
+        value += "\\?";
+        break;
 
-  return ret;
+      case '\\':
+        value += "\\\\";
+        break;
+
+      case '\a':
+        value += "\\a";
+        break;
+
+      case '\b':
+        value += "\\b";
+        break;
+
+      case '\f':
+        value += "\\f";
+        break;
+
+      case '\n':
+        value += "\\n";
+        break;
+
+      case '\r':
+        value += "\\r";
+        break;
+
+      case '\t':
+        value += "\\t";
+        break;
+
+      case '\v':
+        value += "\\v";
+        break;
+
+      default:
+        value.push_back(c);
+    }
+  }
+  value.push_back('"');
+  return value;
+}
+
+} // namespace
+
+void
+Asg2Json::operator()(TranslationUnit* tu)
+{
+  mOut.object([&] {
+    mOut.attributeArray("inner", [&] {
+      for (auto&& i : tu->decls)
+        walk(i);
+    });
+    mOut.attribute("kind", "TranslationUnitDecl");
+  });
 }
 
 //==============================================================================
@@ -105,7 +166,7 @@ Asg2Json::operator()(TypeExpr* texp)
     return ret;
   }
 
-  if (auto p = texp->dcst<PointerType>()) {
+  if (texp->dcst<PointerType>()) {
     if (auto arrayType = texp->sub->dcst<ArrayType>()) {
       std::string ret;
       if (arrayType->sub != nullptr) {
@@ -142,594 +203,356 @@ Asg2Json::operator()(TypeExpr* texp)
 }
 
 //==============================================================================
-// 表达式
+// 结点
 //==============================================================================
 
-json::Object
-Asg2Json::operator()(Expr* obj)
+bool
+Asg2Json::has_inner(Kind tag)
 {
-  json::Object ret;
-
-  if (auto p = obj->dcst<IntegerLiteral>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<StringLiteral>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<DeclRefExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ParenExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<UnaryExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<BinaryExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<CallExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<InitListExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ImplicitInitExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ImplicitCastExpr>())
-    ret = std::move(self(p));
-
-  else
-    ABORT();
-
-  ret["type"] = json::Object({ { "qualType", self(obj->type) } });
-
-  switch (obj->cate) {
-    case Expr::Cate::kINVALID:
-      ret["valueCategory"] = "INVALID";
-      break;
-
-    case Expr::Cate::kLValue:
-      ret["valueCategory"] = "lvalue";
-      break;
-
-    case Expr::Cate::kRValue:
-      ret["valueCategory"] = "prvalue";
-      break;
+  switch (tag) {
+    case Kind::kParenExpr:
+    case Kind::kUnaryExpr:
+    case Kind::kBinaryExpr:
+    case Kind::kCallExpr:
+    case Kind::kInitListExpr:
+    case Kind::kImplicitCastExpr:
+    case Kind::kDeclStmt:
+    case Kind::kCompoundStmt:
+    case Kind::kIfStmt:
+    case Kind::kWhileStmt:
+    case Kind::kDoStmt:
+    case Kind::kReturnStmt:
+    case Kind::kVarDecl:
+    case Kind::kFunctionDecl:
+      return true;
 
     default:
-      ABORT();
+      return false;
   }
-
-  return ret;
 }
 
-json::Object
-Asg2Json::operator()(IntegerLiteral* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
+//==============================================================================
+// 表达式
+//==============================================================================
 
-  ret["kind"] = "IntegerLiteral";
-  ret["value"] = std::to_string(obj->val);
+// 表达式对象的键依次为 inner、kind、opcode、type、value、valueCategory。
 
-  return ret;
+bool
+Asg2Json::pre(Expr* obj)
+{
+  mOut.objectBegin();
+  if (has_inner(obj->tag)) {
+    mOut.attributeBegin("inner");
+    mOut.arrayBegin();
+  }
+  return true;
 }
 
-json::Object
-Asg2Json::operator()(StringLiteral* obj)
+Expr*
+Asg2Json::post(Expr* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
+  if (has_inner(obj->tag)) {
+    mOut.arrayEnd();
+    mOut.attributeEnd();
+  }
 
-  ret["kind"] = "StringLiteral";
+  const char* kind;
+  const char* opcode = nullptr;
+  switch (obj->tag) {
+    case Kind::kIntegerLiteral:
+      kind = "IntegerLiteral";
+      break;
 
-  std::string value;
-  value.push_back('"');
-  for (auto&& c : obj->val) {
-    switch (c) {
-      case '\'':
-        value += "\\'";
-        break;
+    case Kind::kStringLiteral:
+      kind = "StringLiteral";
+      break;
 
-      case '"':
-        value += "\\\"";
-        break;
+    case Kind::kDeclRefExpr:
+      kind = "DeclRefExpr";
+      break;
 
-      case '\?':
-        value += "\\?";
-        break;
+    case Kind::kParenExpr:
+      kind = "ParenExpr";
+      break;
 
-      case '\\':
-        value += "\\\\";
-        break;
+    case Kind::kUnaryExpr:
+      kind = "UnaryOperator";
+      switch (obj->scst<UnaryExpr>()->op) {
+        case UnaryExpr::kPos:
+          opcode = "+";
+          break;
 
-      case '\a':
-        value += "\\a";
-        break;
+        case UnaryExpr::kNeg:
+          opcode = "-";
+          break;
 
-      case '\b':
-        value += "\\b";
-        break;
+        case UnaryExpr::kNot:
+          opcode = "!";
+          break;
 
-      case '\f':
-        value += "\\f";
-        break;
+        default:
+          ABORT();
+      }
+      break;
 
-      case '\n':
-        value += "\\n";
-        break;
+    case Kind::kBinaryExpr:
+      kind = "BinaryOperator";
+      switch (obj->scst<BinaryExpr>()->op) {
+        case BinaryExpr::kMul:
+          opcode = "*";
+          break;
 
-      case '\r':
-        value += "\\r";
-        break;
+        case BinaryExpr::kDiv:
+          opcode = "/";
+          break;
 
-      case '\t':
-        value += "\\t";
-        break;
+        case BinaryExpr::kMod:
+          opcode = "%";
+          break;
 
-      case '\v':
-        value += "\\v";
-        break;
+        case BinaryExpr::kAdd:
+          opcode = "+";
+          break;
 
-      default:
-        value.push_back(c);
-    }
-  }
-  value.push_back('"');
-  ret["value"] = std::move(value);
+        case BinaryExpr::kSub:
+          opcode = "-";
+          break;
 
-  return ret;
-}
+        case BinaryExpr::kGt:
+          opcode = ">";
+          break;
 
-json::Object
-Asg2Json::operator()(DeclRefExpr* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
+        case BinaryExpr::kLt:
+          opcode = "<";
+          break;
 
-  ret["kind"] = "DeclRefExpr";
+        case BinaryExpr::kGe:
+          opcode = ">=";
+          break;
 
-  return ret;
-}
+        case BinaryExpr::kLe:
+          opcode = "<=";
+          break;
 
-json::Object
-Asg2Json::operator()(ParenExpr* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
+        case BinaryExpr::kEq:
+          opcode = "==";
+          break;
 
-  ret["kind"] = "ParenExpr";
+        case BinaryExpr::kNe:
+          opcode = "!=";
+          break;
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
+        case BinaryExpr::kAnd:
+          opcode = "&&";
+          break;
 
-  return ret;
-}
+        case BinaryExpr::kOr:
+          opcode = "||";
+          break;
 
-json::Object
-Asg2Json::operator()(UnaryExpr* obj)
-{
-  assert(obj->sub);
+        case BinaryExpr::kAssign:
+          opcode = "=";
+          break;
 
-  json::Object ret;
-  Obj::Walked guard(obj);
+        case BinaryExpr::kComma:
+          opcode = ",";
+          break;
 
-  ret["kind"] = "UnaryOperator";
+        case BinaryExpr::kIndex:
+          kind = "ArraySubscriptExpr";
+          break;
 
-  switch (obj->op) {
-    case UnaryExpr::kPos:
-      ret["opcode"] = "+";
+        default:
+          ABORT();
+      }
       break;
 
-    case UnaryExpr::kNeg:
-      ret["opcode"] = "-";
+    case Kind::kCallExpr:
+      kind = "CallExpr";
       break;
 
-    case UnaryExpr::kNot:
-      ret["opcode"] = "!";
+    case Kind::kInitListExpr:
+    case Kind::kImplicitInitExpr:
+      kind = "InitListExpr";
+      break;
+
+    case Kind::kImplicitCastExpr:
+      kind = "ImplicitCastExpr";
       break;
 
     default:
       ABORT();
   }
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
+  mOut.attribute("kind", kind);
+  if (opcode != nullptr)
+    mOut.attribute("opcode", opcode);
 
-  return ret;
-}
+  mOut.attributeObject("type",
+                       [&] { mOut.attribute("qualType", self(obj->type)); });
 
-json::Object
-Asg2Json::operator()(BinaryExpr* obj)
-{
-  assert(obj->lft && obj->rht);
-
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "BinaryOperator";
-
-  switch (obj->op) {
-    case BinaryExpr::kMul:
-      ret["opcode"] = "*";
-      break;
-
-    case BinaryExpr::kDiv:
-      ret["opcode"] = "/";
+  switch (obj->tag) {
+    case Kind::kIntegerLiteral:
+      mOut.attribute("value",
+                     std::to_string(obj->scst<IntegerLiteral>()->val));
       break;
 
-    case BinaryExpr::kMod:
-      ret["opcode"] = "%";
+    case Kind::kStringLiteral:
+      mOut.attribute("value", quote(obj->scst<StringLiteral>()->val));
       break;
 
-    case BinaryExpr::kAdd:
-      ret["opcode"] = "+";
-      break;
-
-    case BinaryExpr::kSub:
-      ret["opcode"] = "-";
-      break;
-
-    case BinaryExpr::kGt:
-      ret["opcode"] = ">";
-      break;
-
-    case BinaryExpr::kLt:
-      ret["opcode"] = "<";
-      break;
-
-    case BinaryExpr::kGe:
-      ret["opcode"] = ">=";
-      break;
-
-    case BinaryExpr::kLe:
-      ret["opcode"] = "<=";
-      break;
-
-    case BinaryExpr::kEq:
-      ret["opcode"] = "==";
-      break;
-
-    case BinaryExpr::kNe:
-      ret["opcode"] = "!=";
-      break;
-
-    case BinaryExpr::kAnd:
-      ret["opcode"] = "&&";
-      break;
-
-    case BinaryExpr::kOr:
-      ret["opcode"] = "||";
+    default:
       break;
+  }
 
-    case BinaryExpr::kAssign:
-      ret["opcode"] = "=";
+  switch (obj->cate) {
+    case Expr::Cate::kINVALID:
+      mOut.attribute("valueCategory", "INVALID");
       break;
 
-    case BinaryExpr::kComma:
-      ret["opcode"] = ",";
+    case Expr::Cate::kLValue:
+      mOut.attribute("valueCategory", "lvalue");
       break;
 
-    case BinaryExpr::kIndex:
-      ret["kind"] = "ArraySubscriptExpr";
+    case Expr::Cate::kRValue:
+      mOut.attribute("valueCategory", "prvalue");
       break;
 
     default:
       ABORT();
   }
 
-  json::Array inner;
-  inner.push_back(self(obj->lft));
-  inner.push_back(self(obj->rht));
-  ret["inner"] = std::move(inner);
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(CallExpr* obj)
-{
-  assert(obj->head);
-
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "CallExpr";
-
-  json::Array inner;
-  inner.push_back(self(obj->head));
-  for (auto&& i : obj->args)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(InitListExpr* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "InitListExpr";
-
-  json::Array inner;
-  for (auto&& i : obj->list)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(ImplicitInitExpr* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "InitListExpr";
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(ImplicitCastExpr* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "ImplicitCastExpr";
-
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  mOut.objectEnd();
+  return obj;
 }
 
 //==============================================================================
 // 语句
 //==============================================================================
 
-json::Object
-Asg2Json::operator()(Stmt* obj)
-{
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
+// 语句对象只有 inner 和 kind 两个键。
 
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<NullStmt>()) {
-    json::Object ret;
-    ret["kind"] = "NullStmt";
-    return ret;
-  }
-
-  ABORT();
-}
-
-json::Object
-Asg2Json::operator()(DeclStmt* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "DeclStmt";
-
-  json::Array inner;
-  for (auto&& i : obj->decls)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(ExprStmt* obj)
-{
-  assert(obj->expr);
-  return self(obj->expr);
-}
-
-json::Object
-Asg2Json::operator()(CompoundStmt* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "CompoundStmt";
-
-  json::Array inner;
-  for (auto&& i : obj->subs)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(IfStmt* obj)
-{
-  assert(obj->cond && obj->then);
-
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "IfStmt";
-
-  json::Array inner;
-  inner.push_back(self(obj->cond));
-  inner.push_back(self(obj->then));
-  if (obj->else_)
-    inner.push_back(self(obj->else_));
-  ret["inner"] = std::move(inner);
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(WhileStmt* obj)
+bool
+Asg2Json::pre(Stmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "WhileStmt";
-
-  json::Array inner;
-  inner.push_back(self(obj->cond));
-  inner.push_back(self(obj->body));
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  // ExprStmt 直接输出其中的表达式，自己不占一层对象
+  if (obj->tag == Kind::kExprStmt)
+    return true;
+
+  mOut.objectBegin();
+  if (has_inner(obj->tag)) {
+    mOut.attributeBegin("inner");
+    mOut.arrayBegin();
+  }
+  return true;
 }
 
-json::Object
-Asg2Json::operator()(DoStmt* obj)
+void
+Asg2Json::post(Stmt* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "DoStmt";
+  if (obj->tag == Kind::kExprStmt)
+    return;
 
-  json::Array inner;
-  inner.push_back(self(obj->body));
-  inner.push_back(self(obj->cond));
-  ret["inner"] = std::move(inner);
+  if (has_inner(obj->tag)) {
+    mOut.arrayEnd();
+    mOut.attributeEnd();
+  }
 
-  return ret;
-}
+  switch (obj->tag) {
+    case Kind::kNullStmt:
+      mOut.attribute("kind", "NullStmt");
+      break;
 
-json::Object
-Asg2Json::operator()(BreakStmt* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
+    case Kind::kDeclStmt:
+      mOut.attribute("kind", "DeclStmt");
+      break;
 
-  ret["kind"] = "BreakStmt";
+    case Kind::kCompoundStmt:
+      mOut.attribute("kind", "CompoundStmt");
+      break;
 
-  return ret;
-}
+    case Kind::kIfStmt:
+      mOut.attribute("kind", "IfStmt");
+      break;
 
-json::Object
-Asg2Json::operator()(ContinueStmt* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
+    case Kind::kWhileStmt:
+      mOut.attribute("kind", "WhileStmt");
+      break;
 
-  ret["kind"] = "ContinueStmt";
+    case Kind::kDoStmt:
+      mOut.attribute("kind", "DoStmt");
+      break;
 
-  return ret;
-}
+    case Kind::kBreakStmt:
+      mOut.attribute("kind", "BreakStmt");
+      break;
 
-json::Object
-Asg2Json::operator()(ReturnStmt* obj)
-{
-  json::Object ret;
-  Obj::Walked guard(obj);
+    case Kind::kContinueStmt:
+      mOut.attribute("kind", "ContinueStmt");
+      break;
 
-  ret["kind"] = "ReturnStmt";
+    case Kind::kReturnStmt:
+      mOut.attribute("kind", "ReturnStmt");
+      break;
 
-  json::Array inner;
-  if (obj->expr)
-    inner.push_back(self(obj->expr));
-  ret["inner"] = std::move(inner);
+    default:
+      ABORT();
+  }
 
-  return ret;
+  mOut.objectEnd();
 }
 
 //==============================================================================
 // 声明
 //==============================================================================
 
-json::Object
-Asg2Json::operator()(Decl* obj)
-{
-  json::Object ret;
-
-  if (auto p = obj->dcst<VarDecl>())
-    ret = std::move(self(p));
+// 声明对象的键依次为 inner、kind、name、type。
 
-  else if (auto p = obj->dcst<FunctionDecl>())
-    ret = std::move(self(p));
-
-  else
-    ABORT();
-
-  ret["type"] = json::Object({ { "qualType", self(obj->type) } });
-
-  return ret;
-}
-
-json::Object
-Asg2Json::operator()(VarDecl* obj)
+bool
+Asg2Json::pre(Decl* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "VarDecl";
-
-  ret["name"] = obj->name;
-
-  json::Array inner;
-  if (obj->init)
-    inner.push_back(self(obj->init));
-  ret["inner"] = std::move(inner);
+  mOut.objectBegin();
+  mOut.attributeBegin("inner");
+  mOut.arrayBegin();
+
+  // 参数不是 Walker 遍历的子结点，在函数体之前写出
+  if (obj->tag == Kind::kFunctionDecl) {
+    for (auto&& i : obj->scst<FunctionDecl>()->params) {
+      mOut.object([&] {
+        mOut.attribute("kind", "ParmVarDecl");
+        mOut.attribute("name", i->name.str());
+        mOut.attributeObject(
+          "type", [&] { mOut.attribute("qualType", self(i->type)); });
+      });
+    }
+  }
 
-  return ret;
+  return true;
 }
 
-json::Object
-Asg2Json::operator()(FunctionDecl* obj)
+void
+Asg2Json::post(Decl* obj)
 {
-  json::Object ret;
-  Obj::Walked guard(obj);
-
-  ret["kind"] = "FunctionDecl";
+  mOut.arrayEnd();
+  mOut.attributeEnd();
 
-  ret["name"] = obj->name;
+  switch (obj->tag) {
+    case Kind::kVarDecl:
+      mOut.attribute("kind", "VarDecl");
+      break;
 
-  json::Array inner;
-  for (auto&& i : obj->params) {
-    json::Object pobj;
-    pobj["kind"] = "ParmVarDecl";
-    pobj["name"] = i->name;
-    pobj["type"] = json::Object({ { "qualType", self(i->type) } });
+    case Kind::kFunctionDecl:
+      mOut.attribute("kind", "FunctionDecl");
+      break;
 
-    inner.push_back(std::move(pobj));
+    default:
+      ABORT();
   }
+  mOut.attribute("name", obj->name.str());
 
-  if (obj->body)
-    inner.push_back(self(obj->body));
-
-  ret["inner"] = std::move(inner);
-
-  return ret;
+  mOut.attributeObject("type",
+                       [&] { mOut.attribute("qualType", self(obj->type)); });
+  mOut.objectEnd();
 }
 
 } // namespace asg
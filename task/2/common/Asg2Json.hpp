@@ -1,16 +1,37 @@
-#include "asg.hpp"
+#include "Walker.hpp"
 #include <llvm/Support/JSON.h>
 
 namespace asg {
 
 namespace json = llvm::json;
 
-class Asg2Json
+/**
+ * @brief 把抽象语义图输出为 clang 格式的 JSON
+ *
+ * 边遍历边写出，不构造中间的 json::Object 树。json::Value 打印对象时按键的
+ * 字典序输出，这里按同样的顺序逐个写出键，结果与先建树再打印逐字节相同。
+ *
+ * 由 Walker 遍历：先序写出对象的开头和 inner 数组的开头，子结点写在 inner
+ * 里，后序再写出其余的键。
+ */
+class Asg2Json : public Walker<Asg2Json>
 {
+  friend Walker;
+
 public:
-  json::Object operator()(TranslationUnit* tu);
+  explicit Asg2Json(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  void operator()(TranslationUnit* tu);
 
 private:
+  json::OStream mOut;
+
+  using Walker::post;
+  using Walker::pre;
+
   //============================================================================
   // 类型
   //============================================================================
@@ -20,64 +41,23 @@ private:
   std::string operator()(TypeExpr* texp);
 
   //============================================================================
-  // 表达式
+  // 结点
   //============================================================================
 
-  json::Object operator()(Expr* obj);
-
-  json::Object operator()(IntegerLiteral* obj);
-
-  json::Object operator()(StringLiteral* obj);
-
-  json::Object operator()(ParenExpr* obj);
+  bool pre(Expr* obj);
 
-  json::Object operator()(DeclRefExpr* obj);
+  Expr* post(Expr* obj);
 
-  json::Object operator()(UnaryExpr* obj);
+  bool pre(Stmt* obj);
 
-  json::Object operator()(BinaryExpr* obj);
-
-  json::Object operator()(CallExpr* obj);
-
-  json::Object operator()(InitListExpr* obj);
-
-  json::Object operator()(ImplicitInitExpr* obj);
-
-  json::Object operator()(ImplicitCastExpr* obj);
-
-  //============================================================================
-  // 语句
-  //============================================================================
-
-  json::Object operator()(Stmt* obj);
-
-  json::Object operator()(DeclStmt* obj);
-
-  json::Object operator()(ExprStmt* obj);
-
-  json::Object operator()(CompoundStmt* obj);
-
-  json::Object operator()(IfStmt* obj);
-
-  json::Object operator()(WhileStmt* obj);
-
-  json::Object operator()(DoStmt* obj);
-
-  json::Object operator()(BreakStmt* obj);
-
-  json::Object operator()(ContinueStmt* obj);
-
-  json::Object operator()(ReturnStmt* obj);
-
-  //============================================================================
-  // 声明
-  //============================================================================
+  void post(Stmt* obj);
 
-  json::Object operator()(Decl* obj);
+  bool pre(Decl* obj);
 
-  json::Object operator()(VarDecl* obj);
+  void post(Decl* obj);
 
-  json::Object operator()(FunctionDecl* obj);
+  /// 种类为 \p tag 的结点是否写出 inner 键，没有子结点时也可能写出空数组
+  static bool has_inner(Kind tag);
 };
 
 } // namespace asg
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "asg.hpp"
+#include <cstdint>
+#include <ostream>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 语义图的紧凑只读快照，面向生成 IR 这类只读的遍历
+ *
+ * 指针布局里每个结点都带着虚表指针、环形指针和 any 三个字，子结点指针各占
+ * 8 字节，子结点列表是各自在堆上另分配缓冲区的 std::vector，遍历时在内存里
+ * 到处跳。紧凑布局把一棵已经定型的语义图按种类拷进各自连续的数组：
+ *
+ * - 结点用 32 位的 Ref 指代，高 5 位是种类，低 27 位是在该种类数组中的下标；
+ * - 子结点列表是公共的 Ref 池里的一段 Slice，不再各自分配；
+ * - 类型指针换成类型表中的 32 位下标，名字和字符串字面量都是驻留的 Symbol。
+ *
+ * 父结点的子结点在建立父结点时一起分配，在各自的数组里相邻，按源代码的顺序
+ * 遍历时基本是顺序访问。记录的字段名与指针布局相同，按 Ref 取出记录后照原来的
+ * 写法访问即可。
+ *
+ * 这只是快照：语义图仍以指针布局存放，包括 EmitIR 在内的各阶段照旧使用指针
+ * 布局。快照只读，建好之后不随原语义图变化。建一次快照的耗时比在它上面遍历
+ * 一遍省下的时间多出一个数量级，只遍历一两遍时并不划算，见 report。
+ */
+namespace asg::compact {
+
+/// 结点的 32 位引用，全零为空
+struct Ref
+{
+  static constexpr unsigned kIndexBits = 27;
+
+  std::uint32_t bits{ 0 };
+
+  Ref() = default;
+
+  Ref(Kind kind, std::uint32_t index)
+    : bits(std::uint32_t(kind) << kIndexBits | index)
+  {
+  }
+
+  Kind kind() const { return Kind(bits >> kIndexBits); }
+
+  std::uint32_t index() const { return bits & ((1u << kIndexBits) - 1); }
+
+  explicit operator bool() const { return bits != 0; }
+};
+
+/// Ref 池中的一段
+struct Slice
+{
+  std::uint32_t begin{ 0 }, size{ 0 };
+};
+
+/// 一段 Ref 的只读视图
+struct List
+{
+  const Ref *mBegin, *mEnd;
+
+  const Ref* begin() const { return mBegin; }
+  const Ref* end() const { return mEnd; }
+  std::size_t size() const { return mEnd - mBegin; }
+  Ref operator[](std::size_t i) const { return mBegin[i]; }
+};
+
+/// 结点 T 在紧凑布局中的记录。type 是类型表中的下标，op 等枚举字段按原来的
+/// 枚举值存成一个字节。
+template<typename T>
+struct Rec;
+
+//==============================================================================
+// 表达式
+//==============================================================================
+
+template<>
+struct Rec<IntegerLiteral>
+{
+  static constexpr Kind kKind = Kind::kIntegerLiteral;
+  std::uint64_t val;
+  std::uint32_t type;
+  SourceLoc loc;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<StringLiteral>
+{
+  static constexpr Kind kKind = Kind::kStringLiteral;
+  std::uint32_t type;
+  SourceLoc loc;
+  Symbol val;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<DeclRefExpr>
+{
+  static constexpr Kind kKind = Kind::kDeclRefExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Ref decl;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<ParenExpr>
+{
+  static constexpr Kind kKind = Kind::kParenExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Ref sub;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<UnaryExpr>
+{
+  static constexpr Kind kKind = Kind::kUnaryExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Ref sub;
+  Expr::Cate cate;
+  std::uint8_t op; /// UnaryExpr::Op
+};
+
+template<>
+struct Rec<BinaryExpr>
+{
+  static constexpr Kind kKind = Kind::kBinaryExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Ref lft, rht;
+  Expr::Cate cate;
+  std::uint8_t op; /// BinaryExpr::Op
+};
+
+template<>
+struct Rec<CallExpr>
+{
+  static constexpr Kind kKind = Kind::kCallExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Ref head;
+  Slice args;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<InitListExpr>
+{
+  static constexpr Kind kKind = Kind::kInitListExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Slice list;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<ImplicitInitExpr>
+{
+  static constexpr Kind kKind = Kind::kImplicitInitExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Expr::Cate cate;
+};
+
+template<>
+struct Rec<ImplicitCastExpr>
+{
+  static constexpr Kind kKind = Kind::kImplicitCastExpr;
+  std::uint32_t type;
+  SourceLoc loc;
+  Ref sub;
+  Expr::Cate cate;
+  std::uint8_t kind; /// ImplicitCastExpr::kind
+};
+
+//==============================================================================
+// 语句
+//==============================================================================
+
+template<>
+struct Rec<NullStmt>
+{
+  static constexpr Kind kKind = Kind::kNullStmt;
+  SourceLoc loc;
+};
+
+template<>
+struct Rec<DeclStmt>
+{
+  static constexpr Kind kKind = Kind::kDeclStmt;
+  SourceLoc loc;
+  Slice decls;
+};
+
+template<>
+struct Rec<ExprStmt>
+{
+  static constexpr Kind kKind = Kind::kExprStmt;
+  SourceLoc loc;
+  Ref expr;
+};
+
+template<>
+struct Rec<CompoundStmt>
+{
+  static constexpr Kind kKind = Kind::kCompoundStmt;
+  SourceLoc loc;
+  Slice subs;
+};
+
+template<>
+struct Rec<IfStmt>
+{
+  static constexpr Kind kKind = Kind::kIfStmt;
+  SourceLoc loc;
+  Ref cond, then, else_;
+};
+
+template<>
+struct Rec<WhileStmt>
+{
+  static constexpr Kind kKind = Kind::kWhileStmt;
+  SourceLoc loc;
+  Ref cond, body;
+};
+
+template<>
+struct Rec<DoStmt>
+{
+  static constexpr Kind kKind = Kind::kDoStmt;
+  SourceLoc loc;
+  Ref body, cond;
+};
+
+template<>
+struct Rec<BreakStmt>
+{
+  static constexpr Kind kKind = Kind::kBreakStmt;
+  SourceLoc loc;
+  Ref loop;
+};
+
+template<>
+struct Rec<ContinueStmt>
+{
+  static constexpr Kind kKind = Kind::kContinueStmt;
+  SourceLoc loc;
+  Ref loop;
+};
+
+template<>
+struct Rec<ReturnStmt>
+{
+  static constexpr Kind kKind = Kind::kReturnStmt;
+  SourceLoc loc;
+  Ref func, expr;
+};
+
+//==============================================================================
+// 声明
+//==============================================================================
+
+template<>
+struct Rec<VarDecl>
+{
+  static constexpr Kind kKind = Kind::kVarDecl;
+  std::uint32_t type;
+  Symbol name;
+  SourceLoc loc;
+  Ref init;
+};
+
+template<>
+struct Rec<FunctionDecl>
+{
+  static constexpr Kind kKind = Kind::kFunctionDecl;
+  std::uint32_t type;
+  Symbol name;
+  SourceLoc loc;
+  Slice params;
+  Ref body;
+};
+
+//==============================================================================
+// 整个翻译单元
+//==============================================================================
+
+class Graph
+{
+public:
+  /// 把 \p tu 拷成紧凑布局。\p tu 应当已经定型，引用的声明和循环都在引用者
+  /// 之前出现，比如经过了 Typing 或者来自 clang 的语义图。
+  explicit Graph(TranslationUnit* tu);
+
+  /// 顶层声明
+  List decls() const { return list(mDecls); }
+
+  template<typename T>
+  const Rec<T>& get(Ref ref) const
+  {
+    ASSERT(ref.kind() == Rec<T>::kKind);
+    return std::get<std::vector<Rec<T>>>(mNodes)[ref.index()];
+  }
+
+  List list(Slice slice) const
+  {
+    auto begin = mRefs.data() + slice.begin;
+    return { begin, begin + slice.size };
+  }
+
+  const Type* type(std::uint32_t id) const { return mTypes[id]; }
+
+  /// 结点总数，不含类型
+  std::size_t nodes() const;
+
+  /// 各数组占用的字节数
+  std::size_t bytes() const;
+
+  /// 建立时统计的原语义图占用的字节数：结点本身的尺寸，加上子结点列表和字符串
+  /// 在堆上的缓冲区。类型结点被共享，两边都不算。
+  std::size_t source_bytes() const { return mSourceBytes; }
+
+  /// 按源代码的顺序先序遍历全部结点，把种类、位置和字面量混成一个校验和，
+  /// 与 checksum(TranslationUnit*) 的结果相同。
+  std::uint64_t checksum() const;
+
+private:
+  struct Builder;
+
+  std::tuple<std::vector<Rec<IntegerLiteral>>,
+             std::vector<Rec<StringLiteral>>,
+             std::vector<Rec<DeclRefExpr>>,
+             std::vector<Rec<ParenExpr>>,
+             std::vector<Rec<UnaryExpr>>,
+             std::vector<Rec<BinaryExpr>>,
+             std::vector<Rec<CallExpr>>,
+             std::vector<Rec<InitListExpr>>,
+             std::vector<Rec<ImplicitInitExpr>>,
+             std::vector<Rec<ImplicitCastExpr>>,
+             std::vector<Rec<NullStmt>>,
+             std::vector<Rec<DeclStmt>>,
+             std::vector<Rec<ExprStmt>>,
+             std::vector<Rec<CompoundStmt>>,
+             std::vector<Rec<IfStmt>>,
+             std::vector<Rec<WhileStmt>>,
+             std::vector<Rec<DoStmt>>,
+             std::vector<Rec<BreakStmt>>,
+             std::vector<Rec<ContinueStmt>>,
+             std::vector<Rec<ReturnStmt>>,
+             std::vector<Rec<VarDecl>>,
+             std::vector<Rec<FunctionDecl>>>
+    mNodes;
+
+  std::vector<Ref> mRefs;          /// 子结点列表共用的 Ref 池
+  std::vector<const Type*> mTypes; /// 类型表，下标 0 为空
+  Slice mDecls;
+  std::size_t mSourceBytes{ 0 };
+};
+
+/// 在指针布局上做与 Graph::checksum 相同的遍历
+std::uint64_t
+checksum(TranslationUnit* tu);
+
+/**
+ * @brief 比较两种布局，把结点数、占用的内存和遍历耗时打印到 \p os
+ *
+ * 由环境变量 YATCC_COMPACT 打开，在各阶段的语义图上调用。两种布局各遍历
+ * 若干遍取最快的一次，校验和必须相同。
+ */
+void
+report(TranslationUnit* tu, std::ostream& os);
+
+} // namespace asg::compact
@@ -0,0 +1,234 @@
+#include "ConstEval.hpp"
+
+#define self (*this)
+
+namespace asg {
+
+unsigned
+ConstEval::bits(Type::Spec spec)
+{
+  switch (spec) {
+    case Type::Spec::kChar:
+      return 8;
+    case Type::Spec::kInt:
+      return 32;
+    case Type::Spec::kLong:
+    case Type::Spec::kLongLong:
+      return 64;
+    default:
+      return 0;
+  }
+}
+
+std::int64_t
+ConstEval::wrap(std::uint64_t v, Type::Spec spec)
+{
+  auto n = bits(spec);
+  if (n == 0 || n == 64)
+    return std::int64_t(v);
+  auto sign = std::uint64_t(1) << (n - 1);
+  v &= (sign << 1) - 1;
+  return std::int64_t(v ^ sign) - std::int64_t(sign);
+}
+
+ConstEval::Value
+ConstEval::operator()(Expr* obj)
+{
+  // 只有整数类型的表达式才可能是常量
+  if (obj->type == nullptr || obj->type->texp != nullptr ||
+      bits(obj->type->spec) == 0)
+    return std::nullopt;
+
+  // 先占位再求值，`const int a = a;` 这样引用自身的初始化就不会无限递归
+  auto [iter, inserted] = mMemo.try_emplace(obj);
+  if (!inserted)
+    return iter->second;
+
+  auto val = visit(obj);
+  if (val)
+    val = wrap(*val, obj->type->spec);
+  return mMemo[obj] = val;
+}
+
+bool
+ConstEval::constant_init(Expr* init)
+{
+  switch (init->tag) {
+    case Kind::kInitListExpr:
+      for (auto&& i : init->scst<InitListExpr>()->list)
+        if (!constant_init(i))
+          return false;
+      return true;
+
+    case Kind::kImplicitInitExpr:
+      return true; // 数组的隐式初始化也是零
+
+    default:
+      return self(init).has_value();
+  }
+}
+
+ConstEval::Value
+ConstEval::operator()(IntegerLiteral* obj)
+{
+  return std::int64_t(obj->val);
+}
+
+ConstEval::Value
+ConstEval::operator()(StringLiteral*)
+{
+  return std::nullopt;
+}
+
+ConstEval::Value
+ConstEval::operator()(DeclRefExpr* obj)
+{
+  auto var = obj->decl ? obj->decl->dcst<VarDecl>() : nullptr;
+  if (var == nullptr || !var->type->qual.const_ || var->init == nullptr)
+    return std::nullopt;
+  return self(var->init);
+}
+
+ConstEval::Value
+ConstEval::operator()(ParenExpr* obj)
+{
+  return self(obj->sub);
+}
+
+ConstEval::Value
+ConstEval::operator()(UnaryExpr* obj)
+{
+  auto sub = self(obj->sub);
+  if (!sub)
+    return std::nullopt;
+
+  switch (obj->op) {
+    case UnaryExpr::kPos:
+      return sub;
+
+    case UnaryExpr::kNeg:
+      // 用无符号数取负，最小值取负时按补码回绕
+      return std::int64_t(0 - std::uint64_t(*sub));
+
+    case UnaryExpr::kNot:
+      return *sub == 0;
+
+    default:
+      return std::nullopt;
+  }
+}
+
+ConstEval::Value
+ConstEval::operator()(BinaryExpr* obj)
+{
+  // 短路求值，不会求值的一侧不必是常量
+  if (obj->op == BinaryExpr::kAnd || obj->op == BinaryExpr::kOr) {
+    auto lft = self(obj->lft);
+    if (!lft)
+      return std::nullopt;
+    if ((*lft != 0) == (obj->op == BinaryExpr::kOr))
+      return *lft != 0;
+    auto rht = self(obj->rht);
+    if (!rht)
+      return std::nullopt;
+    return *rht != 0;
+  }
+
+  switch (obj->op) {
+    case BinaryExpr::kAssign:
+    case BinaryExpr::kIndex:
+      return std::nullopt;
+    default:
+      break;
+  }
+
+  auto lft = self(obj->lft);
+  if (!lft)
+    return std::nullopt;
+  auto rht = self(obj->rht);
+  if (!rht)
+    return std::nullopt;
+
+  // 两侧已由 Typing 提升到相同的类型，加减乘在 64 位无符号数上做，再由调用者
+  // 截断到结果类型
+  auto a = std::uint64_t(*lft), b = std::uint64_t(*rht);
+  switch (obj->op) {
+    case BinaryExpr::kMul:
+      return std::int64_t(a * b);
+
+    case BinaryExpr::kAdd:
+      return std::int64_t(a + b);
+
+    case BinaryExpr::kSub:
+      return std::int64_t(a - b);
+
+    case BinaryExpr::kDiv:
+    case BinaryExpr::kMod: {
+      if (*rht == 0)
+        return std::nullopt;
+      // 最小值除以 -1 的商溢出，x86 上会触发异常
+      auto n = bits(obj->lft->type->spec);
+      auto min = n == 64 ? INT64_MIN : -(std::int64_t(1) << (n - 1));
+      if (*rht == -1 && *lft == min)
+        return std::nullopt;
+      return obj->op == BinaryExpr::kDiv ? *lft / *rht : *lft % *rht;
+    }
+
+    case BinaryExpr::kGt:
+      return *lft > *rht;
+    case BinaryExpr::kLt:
+      return *lft < *rht;
+    case BinaryExpr::kGe:
+      return *lft >= *rht;
+    case BinaryExpr::kLe:
+      return *lft <= *rht;
+    case BinaryExpr::kEq:
+      return *lft == *rht;
+    case BinaryExpr::kNe:
+      return *lft != *rht;
+
+    case BinaryExpr::kComma:
+      // 左侧是常量就没有副作用，可以丢掉
+      return rht;
+
+    default:
+      return std::nullopt;
+  }
+}
+
+ConstEval::Value
+ConstEval::operator()(CallExpr*)
+{
+  return std::nullopt;
+}
+
+ConstEval::Value
+ConstEval::operator()(InitListExpr* obj)
+{
+  // 走到这里的都是整数类型，即用花括号初始化标量，只有第一个元素有用
+  if (obj->list.empty())
+    return 0;
+  return self(obj->list[0]);
+}
+
+ConstEval::Value
+ConstEval::operator()(ImplicitInitExpr*)
+{
+  return 0;
+}
+
+ConstEval::Value
+ConstEval::operator()(ImplicitCastExpr* obj)
+{
+  switch (obj->kind) {
+    case ImplicitCastExpr::kLValueToRValue:
+    case ImplicitCastExpr::kIntegralCast:
+    case ImplicitCastExpr::kNoOp:
+      return self(obj->sub);
+
+    default:
+      return std::nullopt;
+  }
+}
+
+} // namespace asg
@@ -1,26 +1,152 @@
 #include "Obj.hpp"
 
+namespace {
+
+/// 标记栈，每个线程一个，容量在多次回收之间复用
+thread_local std::vector<Obj*> sMarkStack;
+
+/// 预取队列深度，必须为 2 的幂
+constexpr std::size_t kPrefetchDepth = 8;
+
+inline void
+prefetch(const void* ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#endif
+}
+
+} // namespace
+
+Obj::Mgr::Mgr(bool arena)
+  : Obj(this)
+{
+  if (arena)
+    mArena = std::make_unique<Arena>();
+}
+
+Obj::Mgr::~Mgr()
+{
+  // 析构剩余的全部对象，内存池模式下内存随后由 mArena 整块释放
+  auto obj = ring_next(this);
+  while (obj != this) {
+    auto next = ring_next(obj);
+    destroy(obj);
+    obj = next;
+  }
+}
+
 void
+Obj::Mgr::adopt(Mgr& other)
+{
+  ASSERT(arena() == other.arena());
+
+  auto first = ring_next(&other);
+  if (first != &other) {
+    auto last = first;
+    while (ring_next(last) != &other)
+      last = ring_next(last);
+    ring_link(last, ring_next(this));
+    ring_link(this, first);
+    ring_link(&other, &other);
+  }
+
+  mCount += other.mCount, mYoung += other.mYoung;
+  other.mCount = other.mYoung = 0;
+  mRemembered.insert(
+    mRemembered.end(), other.mRemembered.begin(), other.mRemembered.end());
+  other.mRemembered.clear();
+  if (mArena)
+    mArena->adopt(*other.mArena);
+}
+
+void
+Obj::Mgr::Stats::print(const char* phase) const
+{
+  printf("垃圾回收[%s]：新分配 %zu，遍历 %zu，释放 %zu，存活 %zu\n",
+         phase,
+         mAllocated,
+         mTraced,
+         mFreed,
+         mLive);
+}
+
+Obj::Mgr::Stats
 Obj::Mgr::gc()
 {
+  Stats stats;
+  stats.mAllocated = mYoung;
+  forget();
+
   // 标记可达对象
-  gc_mark_dfs(this);
+  sMarkStack.push_back(this);
+  stats.mTraced = gc_mark_all(&gc_mark_push);
 
   // 清扫不可达对象
+  gc_sweep(false, stats);
+
+  mYoung = 0;
+  stats.mLive = mCount;
+  return stats;
+}
+
+Obj::Mgr::Stats
+Obj::Mgr::gc_young()
+{
+  Stats stats;
+  stats.mAllocated = mYoung;
+
+  // 记忆集里的老对象作为根，只浅扫一层，并且只有新对象才会入栈
+  sMarkStack.push_back(this);
+  for (auto obj : mRemembered)
+    obj->__mark__(&gc_mark_push_young);
+  forget();
+  stats.mTraced = gc_mark_all(&gc_mark_push_young);
+
+  // 只清扫新生代
+  gc_sweep(true, stats);
+
+  mYoung = 0;
+  stats.mLive = mCount;
+  return stats;
+}
+
+void
+Obj::Mgr::forget()
+{
+  for (auto obj : mRemembered)
+    gc_unmark(obj);
+  mRemembered.clear();
+}
+
+void
+Obj::Mgr::gc_sweep(bool young, Stats& stats)
+{
   Obj* here = this;
+  gc_unmark(this);
   while (true) {
-    gc_unmark(here);
-    auto next = here->__next__;
-    if (next == this)
+    auto next = ring_next(here);
+    if (next == this || (young && gc_old(next)))
       break;
 
     if (!gc_marked(next))
-      here->__next__ = next->__next__, delete next;
+      ring_link(here, ring_next(next)), destroy(next), ++stats.mFreed;
     else
-      here = next;
+      gc_unmark(next), gc_promote(next), here = next;
   }
 }
 
+void
+Obj::Mgr::destroy(Obj* obj)
+{
+  --mCount;
+  if (mArena) {
+    obj->~Obj();
+    mArena->free(obj);
+  } else
+    delete obj;
+}
+
 void
 Obj::Mgr::__mark__(Mark mark)
 {
@@ -28,9 +154,90 @@ Obj::Mgr::__mark__(Mark mark)
 }
 
 void
-Obj::Mgr::gc_mark_dfs(Obj* obj)
+Obj::Mgr::gc_mark_push(Obj* obj)
+{
+  if (obj != nullptr)
+    sMarkStack.push_back(obj);
+}
+
+void
+Obj::Mgr::gc_mark_push_young(Obj* obj)
+{
+  if (obj != nullptr && !gc_old(obj))
+    sMarkStack.push_back(obj);
+}
+
+std::size_t
+Obj::Mgr::gc_mark_all(Mark push)
+{
+  auto& stack = sMarkStack;
+  std::size_t count = 0;
+
+  // 对象出栈后先发出预取并进入队列，等到它之后又有若干对象出栈时才真正访问，
+  // 这样访问对象时其所在的缓存行大概率已经就绪。
+  Obj* queue[kPrefetchDepth];
+  std::size_t head = 0, size = 0;
+
+  while (true) {
+    while (size < kPrefetchDepth && !stack.empty()) {
+      auto obj = stack.back();
+      stack.pop_back();
+      prefetch(obj);
+      queue[(head + size++) & (kPrefetchDepth - 1)] = obj;
+    }
+    if (size == 0)
+      break;
+
+    auto obj = queue[head];
+    head = (head + 1) & (kPrefetchDepth - 1), --size;
+    if (gc_marked(obj))
+      continue;
+    gc_mark(obj), obj->__mark__(push), ++count;
+  }
+
+  return count;
+}
+
+Obj::Mgr::Arena::~Arena()
+{
+  while (mChunks) {
+    auto next = mChunks->mNext;
+    std::free(mChunks);
+    mChunks = next;
+  }
+}
+
+void
+Obj::Mgr::Arena::adopt(Arena& other)
 {
-  if (obj == nullptr || gc_marked(obj))
+  if (other.mChunks == nullptr)
     return;
-  gc_mark(obj), obj->__mark__(&gc_mark_dfs);
+
+  auto last = other.mChunks;
+  while (last->mNext)
+    last = last->mNext;
+  last->mNext = mChunks;
+  mChunks = other.mChunks;
+
+  other.mChunks = nullptr;
+  for (auto&& cls : other.mClasses)
+    cls = Class();
+}
+
+void
+Obj::Mgr::Arena::refill(Class& cls, std::size_t size)
+{
+  auto chunk =
+    reinterpret_cast<Chunk*>(std::aligned_alloc(kChunkSize, kChunkSize));
+  if (chunk == nullptr)
+    throw std::bad_alloc();
+  chunk->mNext = mChunks, chunk->mSize = size;
+  mChunks = chunk;
+
+  // 槽位从头部之后按粒度对齐处开始
+  auto begin = reinterpret_cast<char*>(chunk) +
+               (sizeof(Chunk) + kGrain - 1) / kGrain * kGrain;
+  auto end = reinterpret_cast<char*>(chunk) + kChunkSize;
+  cls.mTop = begin;
+  cls.mEnd = begin + std::size_t(end - begin) / size * size;
 }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 驻留后的标识符
+ *
+ * 所有相同的字符串在全局驻留表中只保存一份，Symbol 里只存它的 32 位编号，
+ * 比较和哈希都只看编号。编号 0 留给空串。
+ *
+ * 为了能放进 bison 的 %union，默认构造是平凡的，不会清零；需要空符号时请用
+ * `Symbol{}` 值初始化。
+ */
+class Symbol
+{
+public:
+  Symbol() = default;
+
+  /// 驻留字符串 \p str，线程安全
+  explicit Symbol(std::string_view str);
+
+  /// 驻留表里的原字符串，在程序退出前一直有效
+  const std::string& str() const;
+
+  std::uint32_t id() const { return mId; }
+
+  bool empty() const { return mId == 0; }
+
+  bool operator==(Symbol other) const { return mId == other.mId; }
+
+  bool operator!=(Symbol other) const { return mId != other.mId; }
+
+  bool operator<(Symbol other) const { return mId < other.mId; }
+
+private:
+  std::uint32_t mId;
+};
+
+template<>
+struct std::hash<Symbol>
+{
+  std::size_t operator()(Symbol sym) const noexcept { return sym.id(); }
+};
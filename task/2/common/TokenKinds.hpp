@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+/**
+ * @brief clang 的词法单元种类
+ *
+ * 几个前端之间以 clang -dump-tokens 的文本格式交换词法单元，这里列出 C 语言
+ * 用到的种类，以及它们在转储里的名字和在源代码里的写法。名字和写法都可以通过
+ * 编译期构造的完美散列表在 O(1) 时间内查回种类，查找时不分配内存。
+ */
+namespace tok {
+
+enum struct Kind : std::uint8_t
+{
+  kINVALID,
+
+  kEof,
+  kIdentifier,
+  kNumericConstant,
+  kCharConstant,
+  kStringLiteral,
+
+  // 关键字
+  kAuto,
+  kBreak,
+  kCase,
+  kChar,
+  kConst,
+  kContinue,
+  kDefault,
+  kDo,
+  kDouble,
+  kElse,
+  kEnum,
+  kExtern,
+  kFloat,
+  kFor,
+  kGoto,
+  kIf,
+  kInline,
+  kInt,
+  kLong,
+  kRegister,
+  kRestrict,
+  kReturn,
+  kShort,
+  kSigned,
+  kSizeof,
+  kStatic,
+  kStruct,
+  kSwitch,
+  kTypedef,
+  kUnion,
+  kUnsigned,
+  kVoid,
+  kVolatile,
+  kWhile,
+
+  // 标点
+  kLSquare,
+  kRSquare,
+  kLParen,
+  kRParen,
+  kLBrace,
+  kRBrace,
+  kPeriod,
+  kEllipsis,
+  kAmp,
+  kAmpAmp,
+  kAmpEqual,
+  kStar,
+  kStarEqual,
+  kPlus,
+  kPlusPlus,
+  kPlusEqual,
+  kMinus,
+  kArrow,
+  kMinusMinus,
+  kMinusEqual,
+  kTilde,
+  kExclaim,
+  kExclaimEqual,
+  kSlash,
+  kSlashEqual,
+  kPercent,
+  kPercentEqual,
+  kLess,
+  kLessLess,
+  kLessEqual,
+  kLessLessEqual,
+  kGreater,
+  kGreaterGreater,
+  kGreaterEqual,
+  kGreaterGreaterEqual,
+  kCaret,
+  kCaretEqual,
+  kPipe,
+  kPipePipe,
+  kPipeEqual,
+  kQuestion,
+  kColon,
+  kSemi,
+  kEqual,
+  kEqualEqual,
+  kComma,
+  kHash,
+  kHashHash,
+};
+
+struct Info
+{
+  Kind kind;
+  std::string_view name;     ///< 转储里的名字，如 l_paren
+  std::string_view spelling; ///< 源代码里的写法，如 (，没有固定写法的为空
+};
+
+/// 按 Kind 的顺序排列，下标即种类的值
+inline constexpr Info kInfos[] = {
+  { Kind::kINVALID, "unknown", "" },
+
+  { Kind::kEof, "eof", "" },
+  { Kind::kIdentifier, "identifier", "" },
+  { Kind::kNumericConstant, "numeric_constant", "" },
+  { Kind::kCharConstant, "char_constant", "" },
+  { Kind::kStringLiteral, "string_literal", "" },
+
+  { Kind::kAuto, "auto", "auto" },
+  { Kind::kBreak, "break", "break" },
+  { Kind::kCase, "case", "case" },
+  { Kind::kChar, "char", "char" },
+  { Kind::kConst, "const", "const" },
+  { Kind::kContinue, "continue", "continue" },
+  { Kind::kDefault, "default", "default" },
+  { Kind::kDo, "do", "do" },
+  { Kind::kDouble, "double", "double" },
+  { Kind::kElse, "else", "else" },
+  { Kind::kEnum, "enum", "enum" },
+  { Kind::kExtern, "extern", "extern" },
+  { Kind::kFloat, "float", "float" },
+  { Kind::kFor, "for", "for" },
+  { Kind::kGoto, "goto", "goto" },
+  { Kind::kIf, "if", "if" },
+  { Kind::kInline, "inline", "inline" },
+  { Kind::kInt, "int", "int" },
+  { Kind::kLong, "long", "long" },
+  { Kind::kRegister, "register", "register" },
+  { Kind::kRestrict, "restrict", "restrict" },
+  { Kind::kReturn, "return", "return" },
+  { Kind::kShort, "short", "short" },
+  { Kind::kSigned, "signed", "signed" },
+  { Kind::kSizeof, "sizeof", "sizeof" },
+  { Kind::kStatic, "static", "static" },
+  { Kind::kStruct, "struct", "struct" },
+  { Kind::kSwitch, "switch", "switch" },
+  { Kind::kTypedef, "typedef", "typedef" },
+  { Kind::kUnion, "union", "union" },
+  { Kind::kUnsigned, "unsigned", "unsigned" },
+  { Kind::kVoid, "void", "void" },
+  { Kind::kVolatile, "volatile", "volatile" },
+  { Kind::kWhile, "while", "while" },
+
+  { Kind::kLSquare, "l_square", "[" },
+  { Kind::kRSquare, "r_square", "]" },
+  { Kind::kLParen, "l_paren", "(" },
+  { Kind::kRParen, "r_paren", ")" },
+  { Kind::kLBrace, "l_brace", "{" },
+  { Kind::kRBrace, "r_brace", "}" },
+  { Kind::kPeriod, "period", "." },
+  { Kind::kEllipsis, "ellipsis", "..." },
+  { Kind::kAmp, "amp", "&" },
+  { Kind::kAmpAmp, "ampamp", "&&" },
+  { Kind::kAmpEqual, "ampequal", "&=" },
+  { Kind::kStar, "star", "*" },
+  { Kind::kStarEqual, "starequal", "*=" },
+  { Kind::kPlus, "plus", "+" },
+  { Kind::kPlusPlus, "plusplus", "++" },
+  { Kind::kPlusEqual, "plusequal", "+=" },
+  { Kind::kMinus, "minus", "-" },
+  { Kind::kArrow, "arrow", "->" },
+  { Kind::kMinusMinus, "minusminus", "--" },
+  { Kind::kMinusEqual, "minusequal", "-=" },
+  { Kind::kTilde, "tilde", "~" },
+  { Kind::kExclaim, "exclaim", "!" },
+  { Kind::kExclaimEqual, "exclaimequal", "!=" },
+  { Kind::kSlash, "slash", "/" },
+  { Kind::kSlashEqual, "slashequal", "/=" },
+  { Kind::kPercent, "percent", "%" },
+  { Kind::kPercentEqual, "percentequal", "%=" },
+  { Kind::kLess, "less", "<" },
+  { Kind::kLessLess, "lessless", "<<" },
+  { Kind::kLessEqual, "lessequal", "<=" },
+  { Kind::kLessLessEqual, "lesslessequal", "<<=" },
+  { Kind::kGreater, "greater", ">" },
+  { Kind::kGreaterGreater, "greatergreater", ">>" },
+  { Kind::kGreaterEqual, "greaterequal", ">=" },
+  { Kind::kGreaterGreaterEqual, "greatergreaterequal", ">>=" },
+  { Kind::kCaret, "caret", "^" },
+  { Kind::kCaretEqual, "caretequal", "^=" },
+  { Kind::kPipe, "pipe", "|" },
+  { Kind::kPipePipe, "pipepipe", "||" },
+  { Kind::kPipeEqual, "pipeequal", "|=" },
+  { Kind::kQuestion, "question", "?" },
+  { Kind::kColon, "colon", ":" },
+  { Kind::kSemi, "semi", ";" },
+  { Kind::kEqual, "equal", "=" },
+  { Kind::kEqualEqual, "equalequal", "==" },
+  { Kind::kComma, "comma", "," },
+  { Kind::kHash, "hash", "#" },
+  { Kind::kHashHash, "hashhash", "##" },
+};
+
+inline constexpr std::size_t kNumKinds = std::size(kInfos);
+
+constexpr std::string_view
+name(Kind kind)
+{
+  return kInfos[std::size_t(kind)].name;
+}
+
+constexpr std::string_view
+spelling(Kind kind)
+{
+  return kInfos[std::size_t(kind)].spelling;
+}
+
+namespace detail {
+
+constexpr bool
+check_order()
+{
+  for (std::size_t i = 0; i < kNumKinds; ++i)
+    if (std::size_t(kInfos[i].kind) != i)
+      return false;
+  return true;
+}
+
+static_assert(check_order(), "kInfos 必须按 Kind 的顺序排列");
+
+/// FNV-1a，查找时只对字符串散列这一次，两级散列都由它导出
+constexpr std::uint32_t
+hash(std::string_view s)
+{
+  std::uint32_t h = 2166136261u;
+  for (char c : s) {
+    h ^= std::uint8_t(c);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/**
+ * @brief 编译期构造的完美散列表（hash and displace）
+ *
+ * 键的散列值先决定它落在 kBuckets 个桶中的哪一个，每个桶再各自找一个种子，
+ * 使桶内的键与种子混合后都落到互不相同的空槽里。构造时先处理大桶，小桶最后往
+ * 剩下的空位里填。查找时只散列一次字符串，再比较一次即可，不会有第二次探测。
+ */
+template<std::size_t kSlots, std::size_t kBuckets>
+class PerfectHash
+{
+public:
+  static_assert((kSlots & (kSlots - 1)) == 0, "槽数须为 2 的幂");
+  static constexpr unsigned kSlotBits = [] {
+    unsigned n = 0;
+    while ((std::size_t(1) << n) < kSlots)
+      ++n;
+    return n;
+  }();
+  static_assert(kNumKinds < 0xff, "槽里用一个字节存种类");
+
+  /// 用 kInfos 中成员 \p key 非空的项构造，kINVALID 不参与
+  explicit constexpr PerfectHash(std::string_view Info::*key)
+    : mKey(key)
+  {
+    // 先按散列值分桶，桶里记下种类的值
+    std::uint8_t members[kBuckets][kNumKinds]{};
+    std::size_t count[kBuckets]{};
+    for (std::size_t i = 1; i < kNumKinds; ++i) {
+      auto s = kInfos[i].*key;
+      if (!s.empty()) {
+        auto b = hash(s) % kBuckets;
+        members[b][count[b]++] = std::uint8_t(i);
+      }
+    }
+
+    // 按桶的大小从大到小处理，桶数很少，每轮直接挑出最大的
+    bool done[kBuckets]{};
+    for (std::size_t round = 0; round < kBuckets; ++round) {
+      std::size_t b = 0;
+      for (std::size_t i = 0; i < kBuckets; ++i)
+        if (!done[i] && (done[b] || count[i] > count[b]))
+          b = i;
+      done[b] = true;
+
+      // 逐个试种子，直到桶里的键都落到空槽里且互不冲突
+      for (std::uint32_t seed = 1; count[b] != 0; ++seed) {
+        std::size_t n = 0;
+        while (n < count[b]) {
+          auto& x = mSlots[slot(hash(kInfos[members[b][n]].*key), seed)];
+          if (x != 0)
+            break;
+          x = members[b][n++];
+        }
+        if (n == count[b]) {
+          mSeeds[b] = seed;
+          break;
+        }
+        while (n != 0)
+          mSlots[slot(hash(kInfos[members[b][--n]].*key), seed)] = 0;
+      }
+    }
+  }
+
+  /// 查找 \p s ，不存在时返回 Kind::kINVALID
+  constexpr Kind operator()(std::string_view s) const
+  {
+    auto h = hash(s);
+    auto kind = Kind(mSlots[slot(h, mSeeds[h % kBuckets])]);
+    return kInfos[std::size_t(kind)].*mKey == s ? kind : Kind::kINVALID;
+  }
+
+private:
+  std::string_view Info::*mKey;
+  std::uint32_t mSeeds[kBuckets]{};
+  std::uint8_t mSlots[kSlots]{}; ///< 空槽为 0，即 Kind::kINVALID
+
+  static constexpr std::size_t slot(std::uint32_t h, std::uint32_t seed)
+  {
+    return std::uint32_t((h ^ seed) * 2654435761u) >> (32 - kSlotBits);
+  }
+};
+
+inline constexpr PerfectHash<256, 32> kByName(&Info::name);
+inline constexpr PerfectHash<256, 32> kBySpelling(&Info::spelling);
+
+} // namespace detail
+
+/// 按转储里的名字查找，如 "l_paren"，不认识时返回 Kind::kINVALID
+constexpr Kind
+from_name(std::string_view name)
+{
+  return detail::kByName(name);
+}
+
+/// 按源代码里的写法查找关键字或标点，如 "(" 或 "int"，不是时返回 Kind::kINVALID
+constexpr Kind
+from_spelling(std::string_view spelling)
+{
+  return detail::kBySpelling(spelling);
+}
+
+} // namespace tok
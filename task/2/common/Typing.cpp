@@ -1,4 +1,5 @@
 #include "Typing.hpp"
+#include "Pool.hpp"
 #include <cassert>
 
 #define self (*this)
@@ -9,46 +10,49 @@ TranslationUnit*
 Typing::operator()(TranslationUnit* tu)
 {
   for (auto&& i : tu->decls)
-    self(i);
+    walk(i);
   return tu;
 }
 
-//==============================================================================
-// 表达式
-//==============================================================================
-
-Expr*
-Typing::operator()(Expr* obj)
+TranslationUnit*
+Typing::operator()(TranslationUnit* tu, unsigned jobs)
 {
-  if (auto p = obj->dcst<IntegerLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<StringLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<DeclRefExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<ParenExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<UnaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<BinaryExpr>())
-    return self(p);
+  if (jobs <= 1)
+    return self(tu);
+
+  std::vector<FunctionDecl*> funcs;
+  for (auto&& i : tu->decls) {
+    auto func = i->dcst<FunctionDecl>();
+    if (func && func->body) {
+      pre(func); // 只处理签名，函数体留给工作线程
+      funcs.push_back(func);
+    } else
+      walk(i);
+  }
 
-  if (auto p = obj->dcst<CallExpr>())
-    return self(p);
+  jobs = std::min<std::size_t>(jobs, funcs.size());
+  std::vector<std::unique_ptr<Obj::Mgr>> mgrs;
+  std::vector<std::unique_ptr<Typing>> workers;
+  for (unsigned w = 0; w < jobs; ++w) {
+    mgrs.push_back(std::make_unique<Obj::Mgr>(mMgr.arena()));
+    workers.push_back(std::make_unique<Typing>(*mgrs.back(), mTypeCache));
+  }
 
-  if (auto p = obj->dcst<ImplicitCastExpr>())
-    return self(p->sub);
+  pool::run(funcs.size(), jobs, [&](std::size_t i, unsigned w) {
+    workers[w]->walk(funcs[i]->body);
+  });
 
-  ABORT();
+  for (auto&& mgr : mgrs)
+    mMgr.adopt(*mgr);
+  return tu;
 }
 
+//==============================================================================
+// 表达式
+//==============================================================================
+
 Expr*
-Typing::operator()(IntegerLiteral* obj)
+Typing::post(IntegerLiteral* obj)
 {
   Type::Spec spec;
   if (obj->val <= INT32_MAX)
@@ -57,29 +61,30 @@ Typing::operator()(IntegerLiteral* obj)
     spec = Type::Spec::kLongLong;
 
   obj->type = mTypeCache(spec, Type::Qual{ .const_ = true }, nullptr);
+  written(obj, obj->type);
 
   obj->cate = Expr::Cate::kRValue;
   return obj;
 }
 
 Expr*
-Typing::operator()(StringLiteral* obj)
+Typing::post(StringLiteral* obj)
 {
   ArrayType arrTy;
   arrTy.len = obj->val.size() + 1;
 
   obj->type =
     mTypeCache(Type::Spec::kChar, Type::Qual{ .const_ = true }, &arrTy);
+  written(obj, obj->type);
 
   obj->cate = Expr::Cate::kRValue;
   return obj;
 }
 
 Expr*
-Typing::operator()(DeclRefExpr* obj)
+Typing::post(DeclRefExpr* obj)
 {
   ASSERT(obj->decl);
-  Obj::Walked walked(obj);
 
   // C语言要求符号先声明后使用，所以此处无需再进入类型检查。
   // 另外，如果真的进入了，可能会导致无限递归。
@@ -87,30 +92,31 @@ Typing::operator()(DeclRefExpr* obj)
 
   obj->type = obj->decl->type;
   obj->cate = Expr::Cate::kLValue;
+  written(obj, obj->type);
   return obj;
 }
 
 Expr*
-Typing::operator()(ParenExpr* obj)
+Typing::post(ParenExpr* obj)
 {
   ASSERT(obj->sub);
-  obj->sub = self(obj->sub);
   obj->type = obj->sub->type;
   obj->cate = obj->sub->cate;
+  written(obj, obj->type);
   return obj;
 }
 
 Expr*
-Typing::operator()(UnaryExpr* obj)
+Typing::post(UnaryExpr* obj)
 {
   ASSERT(obj->sub);
-  Obj::Walked walked(obj);
 
-  auto sub = self(obj->sub);
+  auto sub = obj->sub;
   // 左值要先转成右值，然后进行整数提升
   sub = ensure_rvalue(sub);
   sub = promote_integer(sub);
   obj->sub = sub;
+  written(obj, sub);
 
   Type::Spec spec;
   switch (obj->op) {
@@ -127,19 +133,19 @@ Typing::operator()(UnaryExpr* obj)
       ABORT();
   }
   obj->type = mTypeCache(spec, Type::Qual(), nullptr);
+  written(obj, obj->type);
 
   obj->cate = Expr::Cate::kRValue;
   return obj;
 }
 
 Expr*
-Typing::operator()(BinaryExpr* obj)
+Typing::post(BinaryExpr* obj)
 {
   ASSERT(obj->lft && obj->rht);
-  Obj::Walked walked(obj);
 
-  auto lft = self(obj->lft);
-  auto rht = self(obj->rht);
+  auto lft = obj->lft;
+  auto rht = obj->rht;
 
   switch (obj->op) {
     case BinaryExpr::kMul:
@@ -242,32 +248,30 @@ Typing::operator()(BinaryExpr* obj)
 
   obj->lft = lft;
   obj->rht = rht;
+  written(obj, obj->type), written(obj, lft), written(obj, rht);
   return obj;
 }
 
 Expr*
-Typing::operator()(CallExpr* obj)
+Typing::post(CallExpr* obj)
 {
   ASSERT(obj->head);
 
-  obj->head = self(obj->head);
   auto fexp = dynamic_cast<FunctionType*>(obj->head->type->texp);
   if (fexp == nullptr)
     ABORT();
 
   auto f2p = make<ImplicitCastExpr>();
   f2p->kind = ImplicitCastExpr::kFunctionToPointerDecay;
-  // 加上指针类型
-  auto type = make<Type>();
-  auto pointerType = make<PointerType>();
-  type->spec = obj->head->type->spec;
-  type->qual = obj->head->type->qual;
-  pointerType->sub = obj->head->type->texp;
-  type->texp = pointerType;
-
-  f2p->type = type;
+  // 加上指针类型，缓存会复制栈上的临时结点
+  PointerType pointerType;
+  pointerType.sub = obj->head->type->texp;
+  f2p->type =
+    mTypeCache(obj->head->type->spec, obj->head->type->qual, &pointerType);
   f2p->sub = obj->head;
+  f2p->loc = obj->head->loc;
   obj->head = f2p;
+  written(obj, f2p);
 
   if (fexp->params.size() != obj->args.size())
     ABORT();
@@ -276,110 +280,57 @@ Typing::operator()(CallExpr* obj)
     Expr lft;
     lft.type = fexp->params[i];
     lft.cate = Expr::Cate::kLValue;
-    obj->args[i] = assignment_cast(&lft, self(obj->args[i]));
+    obj->args[i] = assignment_cast(&lft, obj->args[i]);
+    written(obj, obj->args[i]);
   }
 
   obj->type = mTypeCache(obj->head->type->spec, Type::Qual(), fexp->sub);
   obj->cate = Expr::Cate::kRValue;
+  written(obj, obj->type);
 
   return obj;
 }
 
-//==============================================================================
-// 语句
-//==============================================================================
-
-void
-Typing::operator()(Stmt* obj)
-{
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<NullStmt>())
-    return;
-
-  ABORT();
-}
-
-void
-Typing::operator()(DeclStmt* obj)
-{
-  for (auto&& i : obj->decls)
-    self(i);
-}
-
-void
-Typing::operator()(ExprStmt* obj)
-{
-  obj->expr = ensure_rvalue(self(obj->expr));
-}
-
-void
-Typing::operator()(CompoundStmt* obj)
+Expr*
+Typing::post(ImplicitCastExpr* obj)
 {
-  for (auto&& i : obj->subs)
-    self(i);
+  return obj->sub;
 }
 
-void
-Typing::operator()(IfStmt* obj)
-{
-  obj->cond = ensure_rvalue(self(obj->cond));
-  self(obj->then);
-  if (obj->else_)
-    self(obj->else_);
-}
+//==============================================================================
+// 语句
+//==============================================================================
 
 void
-Typing::operator()(WhileStmt* obj)
+Typing::post(ExprStmt* obj)
 {
-  obj->cond = ensure_rvalue(self(obj->cond));
-  self(obj->body);
+  obj->expr = ensure_rvalue(obj->expr);
+  written(obj, obj->expr);
 }
 
 void
-Typing::operator()(DoStmt* obj)
+Typing::post(IfStmt* obj)
 {
-  obj->cond = ensure_rvalue(self(obj->cond));
-  self(obj->body);
+  obj->cond = ensure_rvalue(obj->cond);
+  written(obj, obj->cond);
 }
 
 void
-Typing::operator()(BreakStmt* obj)
+Typing::post(WhileStmt* obj)
 {
+  obj->cond = ensure_rvalue(obj->cond);
+  written(obj, obj->cond);
 }
 
 void
-Typing::operator()(ContinueStmt* obj)
+Typing::post(DoStmt* obj)
 {
+  obj->cond = ensure_rvalue(obj->cond);
+  written(obj, obj->cond);
 }
 
 void
-Typing::operator()(ReturnStmt* obj)
+Typing::post(ReturnStmt* obj)
 {
   auto& ftype = obj->func->type;
   auto ftexp = dynamic_cast<FunctionType*>(ftype->texp);
@@ -402,7 +353,8 @@ Typing::operator()(ReturnStmt* obj)
       Expr lft;
       lft.type = mTypeCache(ftype->spec, ftype->qual, nullptr);
       lft.cate = Expr::Cate::kLValue;
-      obj->expr = assignment_cast(&lft, ensure_rvalue(self(obj->expr)));
+      obj->expr = assignment_cast(&lft, ensure_rvalue(obj->expr));
+      written(obj, obj->expr);
     } break;
 
     default:
@@ -415,19 +367,7 @@ Typing::operator()(ReturnStmt* obj)
 //==============================================================================
 
 void
-Typing::operator()(Decl* obj)
-{
-  if (auto p = obj->dcst<VarDecl>())
-    return self(p);
-
-  if (auto p = obj->dcst<FunctionDecl>())
-    return self(p);
-
-  ABORT();
-}
-
-void
-Typing::operator()(VarDecl* obj)
+Typing::post(VarDecl* obj)
 {
   switch (obj->type->spec) {
     case Type::Spec::kChar:
@@ -440,17 +380,27 @@ Typing::operator()(VarDecl* obj)
       ABORT();
   }
 
+  // 数组长度要先求出来，由初始化推导类型时会用到
+  for (auto texp = obj->type->texp; texp != nullptr; texp = texp->sub)
+    if (auto arrTy = texp->dcst<ArrayType>(); arrTy && arrTy->lenExpr)
+      eval_array_len(arrTy);
+
   // 最多只能声明数值类型
   if (obj->init) {
     Expr ty;
     ty.type = obj->type;
     ty.cate = Expr::Cate::kLValue;
     obj->init = infer_init(obj->init, obj->type);
+    written(obj, obj->init);
   }
+
+  // 数组长度可能由初始化推导得出，因此在最后才换成规范类型
+  obj->type = mTypeCache(obj->type->spec, obj->type->qual, obj->type->texp);
+  written(obj, obj->type);
 }
 
-void
-Typing::operator()(FunctionDecl* obj)
+bool
+Typing::pre(FunctionDecl* obj)
 {
   switch (obj->type->spec) {
     case Type::Spec::kVoid:
@@ -473,26 +423,26 @@ Typing::operator()(FunctionDecl* obj)
 
   funcType->params.resize(obj->params.size());
   for (int i = obj->params.size(); --i != -1;) {
-    self(obj->params[i]);
+    walk(obj->params[i]);
     funcType->params[i] = obj->params[i]->type;
+    written(funcType, funcType->params[i]);
     // 将此处Arraytype变为PointerType
     if (obj->params[i]->type->texp->dcst<ArrayType>()) {
-      auto type = make<Type>();
-      type->spec = obj->params[i]->type->spec;
-      type->qual = obj->params[i]->type->qual;
-      auto pointerType = make<PointerType>();
-      pointerType->sub = obj->params[i]->type->texp;
-      type->texp = pointerType;
+      PointerType pointerType;
+      pointerType.sub = obj->params[i]->type->texp;
+      auto type = mTypeCache(
+        obj->params[i]->type->spec, obj->params[i]->type->qual, &pointerType);
       // 两个都要改
       funcType->params[i] = type;
       obj->params[i]->type = type;
+      written(funcType, type), written(obj->params[i], type);
     }
   }
 
-  if (obj->body) {
-    for (auto&& i : obj->body->subs)
-      self(i);
-  }
+  // 参数类型已经确定，换成规范类型，函数体内的引用和调用都用它
+  obj->type = mTypeCache(obj->type->spec, obj->type->qual, obj->type->texp);
+  written(obj, obj->type);
+  return true;
 }
 
 //==============================================================================
@@ -507,17 +457,13 @@ Typing::ensure_rvalue(Expr* exp)
     cst->kind = ImplicitCastExpr::kArrayToPointerDecay;
 
     // 加上指针类型
-    auto type = make<Type>();
-    auto pointerType = make<PointerType>();
-    type->spec = exp->type->spec;
-    type->qual = exp->type->qual;
-    pointerType->sub = exp->type->texp;
-    type->texp = pointerType;
-
-    cst->type = mTypeCache(type->spec, type->qual, type->texp);
+    PointerType pointerType;
+    pointerType.sub = exp->type->texp;
+    cst->type = mTypeCache(exp->type->spec, exp->type->qual, &pointerType);
     cst->cate = Expr::Cate::kRValue;
 
     cst->sub = exp;
+    cst->loc = exp->loc;
     return cst;
   }
 
@@ -530,11 +476,13 @@ Typing::ensure_rvalue(Expr* exp)
       cst->cate = Expr::Cate::kRValue;
 
       cst->sub = exp;
+      cst->loc = exp->loc;
       return cst;
     }
 
     case Expr::Cate::kRValue: {
       exp->type = mTypeCache(exp->type->spec, Type::Qual(), exp->type->texp);
+      written(exp, exp->type);
       return exp;
     }
 
@@ -543,6 +491,17 @@ Typing::ensure_rvalue(Expr* exp)
   }
 }
 
+void
+Typing::eval_array_len(ArrayType* arrTy)
+{
+  auto len = mConstEval(ensure_rvalue(walk(arrTy->lenExpr)));
+  if (!len || *len < 0 || *len >= ArrayType::kUnLen)
+    ABORT(); // 数组长度必须是编译期常量
+
+  arrTy->len = *len;
+  arrTy->lenExpr = nullptr;
+}
+
 Expr*
 Typing::promote_integer(Expr* exp, Type::Spec to)
 {
@@ -561,6 +520,7 @@ Typing::promote_integer(Expr* exp, Type::Spec to)
       cst->kind = cst->kIntegralCast;
       cst->type = mTypeCache(to, Type::Qual(), exp->type->texp);
       cst->sub = exp;
+      cst->loc = exp->loc;
       return cst;
     }
 
@@ -629,6 +589,7 @@ Typing::assignment_cast(Expr* lft, Expr* rht)
       ccst->type = mTypeCache(
         rht->type->spec, Type::Qual{ .const_ = true }, rht->type->texp);
       ccst->sub = rht;
+      ccst->loc = rht->loc;
       rht = ccst;
     }
 
@@ -637,7 +598,7 @@ Typing::assignment_cast(Expr* lft, Expr* rht)
       ABORT();
 
     // 子类型必须相同
-    if (*arrTy->sub != *arrTy2->sub)
+    if (!TypeExpr::equal(arrTy->sub, arrTy2->sub))
       ABORT();
   }
 
@@ -649,6 +610,7 @@ Typing::assignment_cast(Expr* lft, Expr* rht)
     cst->kind = cst->kIntegralCast;
     cst->type = lft->type;
     cst->sub = rht;
+    cst->loc = rht->loc;
     rht = cst;
   }
 
@@ -662,6 +624,7 @@ Typing::infer_init(Expr* init, const Type* to)
   if (to->texp == nullptr) {
     if (auto p = init->dcst<ImplicitInitExpr>()) {
       p->type = to;
+      written(p, to);
       return p;
     }
 
@@ -673,19 +636,21 @@ Typing::infer_init(Expr* init, const Type* to)
       // 空初始化列表即为 ImplicitInitExpr。
       auto ret = make<ImplicitInitExpr>();
       ret->type = to;
+      ret->loc = p->loc;
       return ret;
     }
 
     Expr lft;
     lft.type = to;
     lft.cate = Expr::Cate::kLValue;
-    return assignment_cast(&lft, self(init));
+    return assignment_cast(&lft, walk(init));
   }
 
   // https://zh.cppreference.com/w/c/language/array_initialization
   if (auto arrTy = to->texp->dcst<ArrayType>()) {
     if (auto p = init->dcst<ImplicitInitExpr>()) {
       p->type = to;
+      written(p, to);
       return p;
     }
 
@@ -697,15 +662,20 @@ Typing::infer_init(Expr* init, const Type* to)
 
     // 从字符串初始化
     if (to->spec == Type::Spec::kChar) {
-      init = self(init);
+      init = walk(init);
 
       auto p = init->type->texp->dcst<ArrayType>();
       if (!p || p->sub != nullptr || init->type->spec != Type::Spec::kChar)
         ABORT();
       if (arrTy->len == -1)
         arrTy->len = p->len;
-      else
-        p->len = arrTy->len;
+      else if (p->len != arrTy->len) {
+        // 字面量的类型是规范结点，不能原地修改长度
+        ArrayType strTy;
+        strTy.len = arrTy->len;
+        init->type = mTypeCache(init->type->spec, init->type->qual, &strTy);
+        written(init, init->type);
+      }
 
       return init;
     }
@@ -731,8 +701,9 @@ Typing::infer_initlist(const std::vector<Expr*>& list,
 
   if (auto arrTy = to->texp->dcst<ArrayType>()) {
     auto ret = make<InitListExpr>();
-    ret->type = mTypeCache(to->spec, to->qual, to->texp);
     ret->cate = Expr::Cate::kRValue;
+    if (begin < list.size())
+      ret->loc = list[begin]->loc;
 
     Type elemTy;
     elemTy.spec = to->spec;
@@ -759,6 +730,8 @@ Typing::infer_initlist(const std::vector<Expr*>& list,
       }
     }
 
+    // 未知长度的数组到这里才确定长度
+    ret->type = mTypeCache(to->spec, to->qual, to->texp);
     return { ret, begin };
   }
 
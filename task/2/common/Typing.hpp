@@ -1,15 +1,23 @@
-#include "asg.hpp"
+#include "ConstEval.hpp"
+#include "Walker.hpp"
+#include <memory>
 
 namespace asg {
 
 /**
  * @brief 在抽象语法图上推导并补全类型
+ *
+ * 由 Walker 后序遍历，子表达式的类型都推导完了再处理父结点，递归深度与源代码
+ * 的嵌套深度无关。
  */
-class Typing
+class Typing : public Walker<Typing>
 {
+  friend Walker;
+
 public:
   Obj::Mgr& mMgr;
   Type::Cache mTypeCache;
+  ConstEval mConstEval; ///< 求数组长度等整型常量表达式
 
   Typing(Obj::Mgr& mgr)
     : mMgr(mgr)
@@ -17,8 +25,25 @@ public:
   {
   }
 
+  /// 工作线程用：结点分配在 \p mgr 上，类型缓存是 \p shared 的前端
+  Typing(Obj::Mgr& mgr, Type::Cache& shared)
+    : mMgr(mgr)
+    , mTypeCache(shared)
+  {
+  }
+
   TranslationUnit* operator()(TranslationUnit* tu);
 
+  /**
+   * @brief 按函数并行地类型检查
+   *
+   * 先在本线程依次处理全局变量和各个函数的签名。函数体只会引用在它之前声明的
+   * 全局变量和函数，这时都已定型，于是函数体可以分给 \p jobs 个线程，见
+   * Pool.hpp。每个线程有自己的 Obj::Mgr（模式与 mMgr 相同）和以 mTypeCache
+   * 为后端的前端缓存，全部做完后新建的结点并回 mMgr。结果与串行时相同。
+   */
+  TranslationUnit* operator()(TranslationUnit* tu, unsigned jobs);
+
 private:
   template<typename T, typename... Args>
   T* make(Args... args)
@@ -26,59 +51,63 @@ private:
     return mMgr.make<T>(args...);
   }
 
+  /// 把 \p value 写进了 \p owner 的字段，之后要做新生代回收，所以过一遍写屏障
+  void written(Obj* owner, const Obj* value)
+  {
+    mMgr.write_barrier(owner, value);
+  }
+
+  using Walker::post;
+  using Walker::pre;
+
   //============================================================================
   // 表达式
   //============================================================================
 
-  Expr* operator()(Expr* obj);
+  /// 初始化列表由 infer_init 按类型处理，不应出现在别处
+  Expr* post(Expr* obj) { ABORT(); }
+
+  Expr* post(IntegerLiteral* obj);
 
-  Expr* operator()(IntegerLiteral* obj);
+  Expr* post(StringLiteral* obj);
 
-  Expr* operator()(StringLiteral* obj);
+  Expr* post(DeclRefExpr* obj);
 
-  Expr* operator()(DeclRefExpr* obj);
+  Expr* post(ParenExpr* obj);
 
-  Expr* operator()(ParenExpr* obj);
+  Expr* post(UnaryExpr* obj);
 
-  Expr* operator()(UnaryExpr* obj);
+  Expr* post(BinaryExpr* obj);
 
-  Expr* operator()(BinaryExpr* obj);
+  Expr* post(CallExpr* obj);
 
-  Expr* operator()(CallExpr* obj);
+  Expr* post(ImplicitCastExpr* obj);
 
   //============================================================================
   // 语句
   //============================================================================
 
-  void operator()(Stmt* obj);
-
-  void operator()(DeclStmt* obj);
-
-  void operator()(ExprStmt* obj);
+  void post(ExprStmt* obj);
 
-  void operator()(CompoundStmt* obj);
+  void post(IfStmt* obj);
 
-  void operator()(IfStmt* obj);
+  void post(WhileStmt* obj);
 
-  void operator()(WhileStmt* obj);
+  void post(DoStmt* obj);
 
-  void operator()(DoStmt* obj);
-
-  void operator()(BreakStmt* obj);
-
-  void operator()(ContinueStmt* obj);
-
-  void operator()(ReturnStmt* obj);
+  void post(ReturnStmt* obj);
 
   //============================================================================
   // 声明
   //============================================================================
 
-  void operator()(Decl* obj);
+  /// 初始化要由变量的类型倒推，不走默认的遍历
+  bool pre(VarDecl* obj) { return false; }
 
-  void operator()(VarDecl* obj);
+  void post(VarDecl* obj);
 
-  void operator()(FunctionDecl* obj);
+  /// 先处理参数，函数类型确定之后再遍历函数体
+  bool pre(FunctionDecl* obj);
 
   //============================================================================
   // 其它
@@ -86,6 +115,9 @@ private:
 
   Expr* ensure_rvalue(Expr* exp);
 
+  /// 推导写成表达式的数组长度的类型并求值，结果必须是非负的整型常量
+  void eval_array_len(ArrayType* arrTy);
+
   /// 整数提升：https://zh.cppreference.com/w/c/language/conversion#%E6%95%B4%E6%95%B0%E6%8F%90%E5%8D%87
   Expr* promote_integer(Expr* exp, Type::Spec to = Type::Spec::kInt);
 
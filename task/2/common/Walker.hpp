@@ -0,0 +1,389 @@
+#pragma once
+
+#include "asg.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace asg {
+
+/**
+ * @brief 用显式栈遍历语义图的遍历器
+ *
+ * 按 Visitor 的方式递归，每深一层就多占一个原生栈帧，很长的 `a + b + ...`、
+ * `a = b = ...` 或者层层嵌套的代码块都可能把栈撑爆。这里把待访问的结点放在
+ * 堆上的栈里，先序、后序各调用一次钩子，原生栈的深度与源代码的嵌套深度无关。
+ *
+ * 各阶段以 CRTP 方式继承本模板，为关心的结点重载 pre 和 post：
+ *
+ * - `bool pre(X* obj)`：进入结点、访问子结点之前调用，返回假则跳过它的全部
+ *   子结点，默认返回真；
+ * - `post(X* obj)`：访问完全部子结点之后调用。表达式的 post 返回 Expr*，
+ *   遍历器把它写回父结点中原来的位置，用来把结点换成新建的结点（比如套上一层
+ *   隐式类型转换），默认原样返回；语句和声明的 post 不返回值；
+ * - `written(Obj* owner, Expr* value)`：post 换了结点、遍历器把 \p value 写回
+ *   父结点 \p owner 之后调用，默认什么也不做。会做新生代回收的阶段在这里调用
+ *   写屏障 Obj::Mgr::write_barrier。
+ *
+ * 没有为具体结点重载的钩子会落到 Expr*、Stmt*、Decl* 的重载上，所以子类也可以
+ * 只重载这三个，自己按种类标签分情况处理。子类需要 `using Walker::pre;` 和
+ * `using Walker::post;` 引入默认的重载，并将本模板声明为友元。
+ *
+ * 子结点按源代码中的顺序访问。函数的参数不算子结点，各阶段在进入函数时自行
+ * 处理；它们结构固定，不会嵌套。钩子里可以再调用 walk 遍历别的子树，比如
+ * 按类型推导初始化列表时逐个遍历其中的元素，但在访问某个结点的子结点期间不得
+ * 增删它的子结点列表，否则栈里记着的位置会失效。
+ */
+template<typename Impl>
+class Walker
+{
+protected:
+  /// 遍历以 \p root 为根的表达式，返回 post 换过之后的根
+  Expr* walk(Expr* root)
+  {
+    auto base = mStack.size();
+    enter(&root, nullptr);
+    run(base);
+    return root;
+  }
+
+  void walk(Stmt* root)
+  {
+    auto base = mStack.size();
+    enter(root);
+    run(base);
+  }
+
+  void walk(Decl* root)
+  {
+    auto base = mStack.size();
+    enter(root);
+    run(base);
+  }
+
+  //============================================================================
+  // 默认实现
+  //============================================================================
+
+  bool pre(Expr* obj) { return true; }
+  bool pre(Stmt* obj) { return true; }
+  bool pre(Decl* obj) { return true; }
+
+  Expr* post(Expr* obj) { return obj; }
+  void post(Stmt* obj) {}
+  void post(Decl* obj) {}
+
+  void written(Obj* owner, Expr* value) {}
+
+private:
+  struct Frame
+  {
+    Obj* mObj;
+    Obj* mOwner;         ///< 表达式的父结点，根和其它结点为空
+    Expr** mSlot;        ///< 表达式在父结点中的位置，其它结点为空
+    Kind mTag;           ///< 结点的种类标签
+    bool mDescend;       ///< pre 是否允许访问子结点
+    std::uint32_t mNext; ///< 下一个要访问的子结点的序号
+  };
+
+  std::vector<Frame> mStack;
+
+  Impl& impl() { return static_cast<Impl&>(*this); }
+
+  /// 从栈顶一直处理到栈里只剩 \p base 个结点
+  void run(std::size_t base)
+  {
+    while (mStack.size() > base) {
+      // descend 压栈时 vector 可能扩容，之后不能再用这个引用
+      auto& top = mStack.back();
+      if (!top.mDescend || !descend(top))
+        leave();
+    }
+  }
+
+  //============================================================================
+  // 进入结点
+  //============================================================================
+
+  bool enter(Expr** slot, Obj* owner)
+  {
+    auto obj = *slot;
+    Obj::Walked::enter(obj);
+    mStack.push_back({ obj, owner, slot, obj->tag, pre_expr(obj), 0 });
+    return true;
+  }
+
+  bool enter(Stmt* obj)
+  {
+    Obj::Walked::enter(obj);
+    mStack.push_back({ obj, nullptr, nullptr, obj->tag, pre_stmt(obj), 0 });
+    return true;
+  }
+
+  bool enter(Decl* obj)
+  {
+    Obj::Walked::enter(obj);
+    mStack.push_back({ obj, nullptr, nullptr, obj->tag, pre_decl(obj), 0 });
+    return true;
+  }
+
+  bool pre_expr(Expr* obj)
+  {
+    switch (obj->tag) {
+      case Kind::kIntegerLiteral:
+        return impl().pre(obj->scst<IntegerLiteral>());
+      case Kind::kStringLiteral:
+        return impl().pre(obj->scst<StringLiteral>());
+      case Kind::kDeclRefExpr:
+        return impl().pre(obj->scst<DeclRefExpr>());
+      case Kind::kParenExpr:
+        return impl().pre(obj->scst<ParenExpr>());
+      case Kind::kUnaryExpr:
+        return impl().pre(obj->scst<UnaryExpr>());
+      case Kind::kBinaryExpr:
+        return impl().pre(obj->scst<BinaryExpr>());
+      case Kind::kCallExpr:
+        return impl().pre(obj->scst<CallExpr>());
+      case Kind::kInitListExpr:
+        return impl().pre(obj->scst<InitListExpr>());
+      case Kind::kImplicitInitExpr:
+        return impl().pre(obj->scst<ImplicitInitExpr>());
+      case Kind::kImplicitCastExpr:
+        return impl().pre(obj->scst<ImplicitCastExpr>());
+      default:
+        ABORT();
+    }
+  }
+
+  bool pre_stmt(Stmt* obj)
+  {
+    switch (obj->tag) {
+      case Kind::kNullStmt:
+        return impl().pre(obj->scst<NullStmt>());
+      case Kind::kDeclStmt:
+        return impl().pre(obj->scst<DeclStmt>());
+      case Kind::kExprStmt:
+        return impl().pre(obj->scst<ExprStmt>());
+      case Kind::kCompoundStmt:
+        return impl().pre(obj->scst<CompoundStmt>());
+      case Kind::kIfStmt:
+        return impl().pre(obj->scst<IfStmt>());
+      case Kind::kWhileStmt:
+        return impl().pre(obj->scst<WhileStmt>());
+      case Kind::kDoStmt:
+        return impl().pre(obj->scst<DoStmt>());
+      case Kind::kBreakStmt:
+        return impl().pre(obj->scst<BreakStmt>());
+      case Kind::kContinueStmt:
+        return impl().pre(obj->scst<ContinueStmt>());
+      case Kind::kReturnStmt:
+        return impl().pre(obj->scst<ReturnStmt>());
+      default:
+        ABORT();
+    }
+  }
+
+  bool pre_decl(Decl* obj)
+  {
+    switch (obj->tag) {
+      case Kind::kVarDecl:
+        return impl().pre(obj->scst<VarDecl>());
+      case Kind::kFunctionDecl:
+        return impl().pre(obj->scst<FunctionDecl>());
+      default:
+        ABORT();
+    }
+  }
+
+  //============================================================================
+  // 访问子结点
+  //============================================================================
+
+  /// 把 \p f 的下一个子结点压栈，已经没有子结点时返回假
+  bool descend(Frame& f)
+  {
+    Obj* obj = f.mObj;
+    auto i = f.mNext++;
+    switch (f.mTag) {
+      case Kind::kIntegerLiteral:
+      case Kind::kStringLiteral:
+      case Kind::kDeclRefExpr:
+      case Kind::kImplicitInitExpr:
+      case Kind::kNullStmt:
+      case Kind::kBreakStmt:
+      case Kind::kContinueStmt:
+        return false;
+
+      case Kind::kParenExpr:
+        return i == 0 && enter(&obj->scst<ParenExpr>()->sub, obj);
+
+      case Kind::kUnaryExpr:
+        return i == 0 && enter(&obj->scst<UnaryExpr>()->sub, obj);
+
+      case Kind::kBinaryExpr: {
+        auto p = obj->scst<BinaryExpr>();
+        return i < 2 && enter(i == 0 ? &p->lft : &p->rht, obj);
+      }
+
+      case Kind::kCallExpr: {
+        auto p = obj->scst<CallExpr>();
+        if (i == 0)
+          return enter(&p->head, obj);
+        return i <= p->args.size() && enter(&p->args[i - 1], obj);
+      }
+
+      case Kind::kInitListExpr: {
+        auto p = obj->scst<InitListExpr>();
+        return i < p->list.size() && enter(&p->list[i], obj);
+      }
+
+      case Kind::kImplicitCastExpr:
+        return i == 0 && enter(&obj->scst<ImplicitCastExpr>()->sub, obj);
+
+      case Kind::kDeclStmt: {
+        auto p = obj->scst<DeclStmt>();
+        return i < p->decls.size() && enter(p->decls[i]);
+      }
+
+      case Kind::kExprStmt:
+        return i == 0 && enter(&obj->scst<ExprStmt>()->expr, obj);
+
+      case Kind::kCompoundStmt: {
+        auto p = obj->scst<CompoundStmt>();
+        return i < p->subs.size() && enter(p->subs[i]);
+      }
+
+      case Kind::kIfStmt: {
+        auto p = obj->scst<IfStmt>();
+        switch (i) {
+          case 0:
+            return enter(&p->cond, obj);
+          case 1:
+            return enter(p->then);
+          case 2:
+            return p->else_ != nullptr && enter(p->else_);
+          default:
+            return false;
+        }
+      }
+
+      case Kind::kWhileStmt: {
+        auto p = obj->scst<WhileStmt>();
+        return i < 2 && (i == 0 ? enter(&p->cond, obj) : enter(p->body));
+      }
+
+      case Kind::kDoStmt: {
+        auto p = obj->scst<DoStmt>();
+        return i < 2 && (i == 0 ? enter(p->body) : enter(&p->cond, obj));
+      }
+
+      case Kind::kReturnStmt: {
+        auto p = obj->scst<ReturnStmt>();
+        return i == 0 && p->expr != nullptr && enter(&p->expr, obj);
+      }
+
+      case Kind::kVarDecl: {
+        auto p = obj->scst<VarDecl>();
+        return i == 0 && p->init != nullptr && enter(&p->init, obj);
+      }
+
+      case Kind::kFunctionDecl: {
+        auto p = obj->scst<FunctionDecl>();
+        return i == 0 && p->body != nullptr && enter(p->body);
+      }
+
+      default:
+        ABORT();
+    }
+  }
+
+  //============================================================================
+  // 离开结点
+  //============================================================================
+
+  void leave()
+  {
+    auto f = mStack.back();
+    mStack.pop_back();
+    Obj* obj = f.mObj;
+    Obj::Walked::leave(obj);
+
+    switch (f.mTag) {
+      case Kind::kIntegerLiteral:
+        *f.mSlot = impl().post(obj->scst<IntegerLiteral>());
+        break;
+      case Kind::kStringLiteral:
+        *f.mSlot = impl().post(obj->scst<StringLiteral>());
+        break;
+      case Kind::kDeclRefExpr:
+        *f.mSlot = impl().post(obj->scst<DeclRefExpr>());
+        break;
+      case Kind::kParenExpr:
+        *f.mSlot = impl().post(obj->scst<ParenExpr>());
+        break;
+      case Kind::kUnaryExpr:
+        *f.mSlot = impl().post(obj->scst<UnaryExpr>());
+        break;
+      case Kind::kBinaryExpr:
+        *f.mSlot = impl().post(obj->scst<BinaryExpr>());
+        break;
+      case Kind::kCallExpr:
+        *f.mSlot = impl().post(obj->scst<CallExpr>());
+        break;
+      case Kind::kInitListExpr:
+        *f.mSlot = impl().post(obj->scst<InitListExpr>());
+        break;
+      case Kind::kImplicitInitExpr:
+        *f.mSlot = impl().post(obj->scst<ImplicitInitExpr>());
+        break;
+      case Kind::kImplicitCastExpr:
+        *f.mSlot = impl().post(obj->scst<ImplicitCastExpr>());
+        break;
+
+      case Kind::kNullStmt:
+        impl().post(obj->scst<NullStmt>());
+        break;
+      case Kind::kDeclStmt:
+        impl().post(obj->scst<DeclStmt>());
+        break;
+      case Kind::kExprStmt:
+        impl().post(obj->scst<ExprStmt>());
+        break;
+      case Kind::kCompoundStmt:
+        impl().post(obj->scst<CompoundStmt>());
+        break;
+      case Kind::kIfStmt:
+        impl().post(obj->scst<IfStmt>());
+        break;
+      case Kind::kWhileStmt:
+        impl().post(obj->scst<WhileStmt>());
+        break;
+      case Kind::kDoStmt:
+        impl().post(obj->scst<DoStmt>());
+        break;
+      case Kind::kBreakStmt:
+        impl().post(obj->scst<BreakStmt>());
+        break;
+      case Kind::kContinueStmt:
+        impl().post(obj->scst<ContinueStmt>());
+        break;
+      case Kind::kReturnStmt:
+        impl().post(obj->scst<ReturnStmt>());
+        break;
+
+      case Kind::kVarDecl:
+        impl().post(obj->scst<VarDecl>());
+        break;
+      case Kind::kFunctionDecl:
+        impl().post(obj->scst<FunctionDecl>());
+        break;
+
+      default:
+        ABORT();
+    }
+
+    if (f.mOwner != nullptr && *f.mSlot != obj)
+      impl().written(f.mOwner, *f.mSlot);
+  }
+};
+
+} // namespace asg
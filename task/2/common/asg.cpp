@@ -1,4 +1,7 @@
 #include "asg.hpp"
+#include <atomic>
+
+#define self (*this)
 
 namespace asg {
 
@@ -11,9 +14,11 @@ Type::operator==(const Type& other) const
 {
   if (this == &other)
     return true;
+  if (canon != 0 && canon == other.canon)
+    return false;
   if (spec != other.spec || qual != other.qual)
     return false;
-  return *texp == *other.texp;
+  return TypeExpr::equal(texp, other.texp);
 }
 
 void
@@ -22,29 +27,190 @@ Type::__mark__(Mark mark)
   mark(texp);
 }
 
+namespace {
+
+/// 分配缓存编号，从 1 开始，0 留给非规范结点
+std::atomic<std::uint32_t> sCacheEpoch{ 0 };
+
+inline void
+hash_combine(std::size_t& seed, std::size_t value)
+{
+  seed ^= value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+}
+
+inline std::size_t
+hash_ptr(const void* ptr)
+{
+  return std::hash<const void*>()(ptr);
+}
+
+} // namespace
+
+Type::Cache::Cache(Obj::Mgr& mgr)
+  : mMgr(mgr)
+  , mEpoch(++sCacheEpoch)
+{
+}
+
+Type::Cache::Cache(Cache& shared)
+  : mMgr(shared.mMgr)
+  , mEpoch(shared.mEpoch)
+  , mShared(&shared)
+{
+}
+
 const Type*
 Type::Cache::operator()(Spec spec, Qual qual, TypeExpr* texp)
 {
-  for (auto&& i : *this) {
-    if (i->spec == spec && i->qual == qual) {
-      if (texp == i->texp)
-        return i;
-      if (texp == nullptr || i->texp == nullptr)
-        continue;
-      if (*texp == *i->texp)
-        return i;
+  texp = self(texp);
+
+  if (texp == nullptr) {
+    auto& slot = mScalars[std::size_t(spec)][qual.const_];
+    if (slot == nullptr) {
+      if (mShared) {
+        std::lock_guard<std::mutex> lock(mShared->mMtx);
+        slot = (*mShared)(spec, qual, texp);
+        return slot;
+      }
+      auto ty = mMgr.make<Type>();
+      ty->spec = spec, ty->qual = qual, ty->canon = mEpoch;
+      slot = ty;
     }
+    return slot;
   }
-  auto ty = mMgr.make<Type>();
-  ty->spec = spec, ty->qual = qual, ty->texp = texp;
-  push_back(ty);
+
+  std::size_t hash = std::size_t(spec);
+  hash_combine(hash, qual.const_);
+  hash_combine(hash, hash_ptr(texp));
+
+  auto [begin, end] = mTypes.equal_range(hash);
+  for (auto i = begin; i != end; ++i) {
+    auto ty = i->second;
+    if (ty->spec == spec && ty->qual == qual && ty->texp == texp)
+      return ty;
+  }
+
+  Type* ty;
+  if (mShared) {
+    std::lock_guard<std::mutex> lock(mShared->mMtx);
+    ty = const_cast<Type*>((*mShared)(spec, qual, texp));
+  } else {
+    ty = mMgr.make<Type>();
+    ty->spec = spec, ty->qual = qual, ty->texp = texp, ty->canon = mEpoch;
+  }
+  mTypes.emplace(hash, ty);
   return ty;
 }
 
+TypeExpr*
+Type::Cache::operator()(TypeExpr* texp)
+{
+  if (texp == nullptr || texp->canon == mEpoch)
+    return texp;
+
+  // 先规范化子结点，之后只需浅层地哈希和比较
+  auto sub = self(texp->sub);
+  std::size_t hash = std::size_t(texp->tag);
+  hash_combine(hash, hash_ptr(sub));
+
+  switch (texp->tag) {
+    case Kind::kPointerType: {
+      auto p = texp->scst<PointerType>();
+      hash_combine(hash, p->qual.const_);
+
+      auto [begin, end] = mTexps.equal_range(hash);
+      for (auto i = begin; i != end; ++i) {
+        auto q = i->second;
+        if (q->tag == texp->tag && q->sub == sub &&
+            q->scst<PointerType>()->qual == p->qual)
+          return q;
+      }
+
+      if (mShared)
+        return from_shared(texp, hash);
+      auto q = mMgr.make<PointerType>();
+      q->sub = sub, q->qual = p->qual, q->canon = mEpoch;
+      mTexps.emplace(hash, q);
+      return q;
+    }
+
+    case Kind::kArrayType: {
+      auto p = texp->scst<ArrayType>();
+      hash_combine(hash, p->len);
+
+      auto [begin, end] = mTexps.equal_range(hash);
+      for (auto i = begin; i != end; ++i) {
+        auto q = i->second;
+        if (q->tag == texp->tag && q->sub == sub &&
+            q->scst<ArrayType>()->len == p->len)
+          return q;
+      }
+
+      if (mShared)
+        return from_shared(texp, hash);
+      auto q = mMgr.make<ArrayType>();
+      q->sub = sub, q->len = p->len, q->canon = mEpoch;
+      mTexps.emplace(hash, q);
+      return q;
+    }
+
+    case Kind::kFunctionType: {
+      auto p = texp->scst<FunctionType>();
+      std::vector<const Type*> params;
+      params.reserve(p->params.size());
+      for (auto&& i : p->params) {
+        params.push_back(self(i->spec, i->qual, i->texp));
+        hash_combine(hash, hash_ptr(params.back()));
+      }
+
+      auto [begin, end] = mTexps.equal_range(hash);
+      for (auto i = begin; i != end; ++i) {
+        auto q = i->second;
+        if (q->tag == texp->tag && q->sub == sub &&
+            q->scst<FunctionType>()->params == params)
+          return q;
+      }
+
+      if (mShared)
+        return from_shared(texp, hash);
+      auto q = mMgr.make<FunctionType>();
+      q->sub = sub, q->params = std::move(params), q->canon = mEpoch;
+      mTexps.emplace(hash, q);
+      return q;
+    }
+
+    default:
+      ABORT();
+  }
+}
+
+TypeExpr*
+Type::Cache::from_shared(TypeExpr* texp, std::size_t hash)
+{
+  TypeExpr* q;
+  {
+    std::lock_guard<std::mutex> lock(mShared->mMtx);
+    q = (*mShared)(texp);
+  }
+  mTexps.emplace(hash, q);
+  return q;
+}
+
+void
+Type::Cache::clear()
+{
+  // 前端跟随后端的编号，后端清空之后前端也要清空
+  mEpoch = mShared ? mShared->mEpoch : ++sCacheEpoch;
+  for (auto&& i : mScalars)
+    i[0] = i[1] = nullptr;
+  mTypes.clear();
+  mTexps.clear();
+}
+
 bool
 TypeExpr::__equal__(const TypeExpr& other) const
 {
-  return *sub == *other.sub;
+  return equal(sub, other.sub);
 }
 
 void
@@ -58,13 +224,13 @@ PointerType::__equal__(const TypeExpr& other) const
 {
   if (this == &other)
     return true;
-  auto p = dynamic_cast<const PointerType*>(&other);
-  if (p == nullptr)
+  if (other.tag != Kind::kPointerType)
     return false;
+  auto p = other.scst<const PointerType>();
 
   if (qual != p->qual)
     return false;
-  return *sub == *p->sub;
+  return equal(sub, p->sub);
 }
 
 bool
@@ -72,13 +238,20 @@ ArrayType::__equal__(const TypeExpr& other) const
 {
   if (this == &other)
     return true;
-  auto p = dynamic_cast<const ArrayType*>(&other);
-  if (p == nullptr)
+  if (other.tag != Kind::kArrayType)
     return false;
+  auto p = other.scst<const ArrayType>();
 
   if (len != p->len)
     return false;
-  return *sub == *p->sub;
+  return equal(sub, p->sub);
+}
+
+void
+ArrayType::__mark__(Mark mark)
+{
+  mark(lenExpr);
+  TypeExpr::__mark__(mark);
 }
 
 void
@@ -94,9 +267,9 @@ FunctionType::__equal__(const TypeExpr& other) const
 {
   if (this == &other)
     return true;
-  auto p = dynamic_cast<const FunctionType*>(&other);
-  if (p == nullptr)
+  if (other.tag != Kind::kFunctionType)
     return false;
+  auto p = other.scst<const FunctionType>();
 
   if (params.size() != p->params.size())
     return false;
@@ -1,11 +1,63 @@
 #pragma once
 
 #include "Obj.hpp"
+#include "SourceLoc.hpp"
+#include "Symbol.hpp"
 #include <string>
 #include <cstdint>
+#include <mutex>
+#include <unordered_map>
 
 namespace asg {
 
+//==============================================================================
+// 种类
+//==============================================================================
+
+/**
+ * @brief 表达式、语句、声明和类型表达式结点的种类标签
+ *
+ * 每个具体结点在构造时写入自己的种类，遍历时按标签 switch 跳转即可，不必
+ * 逐个 dcst 试探。
+ */
+enum struct Kind : std::uint8_t
+{
+  kINVALID,
+
+  // 表达式
+  kIntegerLiteral,
+  kStringLiteral,
+  kDeclRefExpr,
+  kParenExpr,
+  kUnaryExpr,
+  kBinaryExpr,
+  kCallExpr,
+  kInitListExpr,
+  kImplicitInitExpr,
+  kImplicitCastExpr,
+
+  // 语句
+  kNullStmt,
+  kDeclStmt,
+  kExprStmt,
+  kCompoundStmt,
+  kIfStmt,
+  kWhileStmt,
+  kDoStmt,
+  kBreakStmt,
+  kContinueStmt,
+  kReturnStmt,
+
+  // 声明
+  kVarDecl,
+  kFunctionDecl,
+
+  // 类型表达式
+  kPointerType,
+  kArrayType,
+  kFunctionType,
+};
+
 //==============================================================================
 // 类型
 //==============================================================================
@@ -39,12 +91,13 @@ struct Type : Obj
 
   Spec spec{ Spec::kINVALID };
   Qual qual;
+  std::uint32_t canon{ 0 }; /// 所属类型缓存的编号，0 表示不是规范结点
 
   TypeExpr* texp{ nullptr };
 
   /**
    * @brief 类型等价性判断，等价性是类型系统最重要的性质，我们在这里而不是
-   * 在 Typing 中实现。
+   * 在 Typing 中实现。同一个缓存产生的规范类型之间直接比较指针。
    */
   bool operator==(const Type& other) const;
   bool operator!=(const Type& other) const { return !operator==(other); }
@@ -58,39 +111,91 @@ public:
    *
    * 编译过程中，尤其是语法分析和类型推导阶段，会有大量的语义节点包含相同的
    * 类型或子类型，重复创建这些类型节点会导致无谓的内存占用，因此使用这个类
-   * 型缓存器。考虑到我们测例中不会包含太多的类型种类，这里的实现采用了简单
-   * 的线性查找算法，更高级的做法是设计有唯一性的类型编码方法，然后使用哈希
-   * 表来映射和查找。
+   * 型缓存器。
+   *
+   * 缓存采用哈希合并（hash-consing）：自底向上地为每个结点找到唯一的规范
+   * 结点，由于子结点已经规范化，结点的哈希和比较都只需要看它自己的字段和子
+   * 结点的指针。因此同一个缓存返回的类型结构相同当且仅当指针相同。参数中的
+   * 结点只会被读取，缓存总是另建副本，调用者可以放心地传入栈上的临时结点。
+   *
+   * 多个线程共用一个缓存时，每个线程各建一个以它为后端的前端缓存。前端查不到
+   * 时加锁向后端要，再把结果记在自己这里，规范结点都由后端创建，所以各线程
+   * 得到的规范结点仍然是同一批，指针相等的性质不变。
+   *
+   * @warning 规范结点被多处共享，不能修改！
    */
-  struct Cache : std::vector<const Type*>
+  struct Cache
   {
     Obj::Mgr& mMgr;
 
-    Cache(Obj::Mgr& mgr)
-      : mMgr(mgr)
-    {
-    }
+    Cache(Obj::Mgr& mgr);
+
+    /// 以 \p shared 为后端的前端缓存，不自己创建规范结点
+    explicit Cache(Cache& shared);
 
+    /// 返回与参数结构相同的规范类型
     const Type* operator()(Spec spec, Qual qual, TypeExpr* texp);
+
+    /// 返回与 \p texp 结构相同的规范类型表达式
+    TypeExpr* operator()(TypeExpr* texp);
+
+    /**
+     * @brief 清空缓存，通常在垃圾回收之前调用，以免缓存中留下悬空指针
+     *
+     * 之后产生的规范结点换用新的编号，不会与之前的规范结点误判为不等。
+     */
+    void clear();
+
+  private:
+    std::uint32_t mEpoch; /// 本缓存的编号，写入规范结点的 canon 字段
+    Cache* mShared{ nullptr }; /// 前端缓存的后端，为空则是后端
+    std::mutex mMtx;           /// 作为后端时，前端经由此锁访问
+
+    /// 前端查不到 \p texp 时向后端要规范结点，记在自己这里
+    TypeExpr* from_shared(TypeExpr* texp, std::size_t hash);
+
+    /// 没有类型表达式的类型最常用，按说明和限定直接索引
+    const Type* mScalars[6][2]{};
+
+    /// 键为结点的浅层哈希，同一个键下可能有多个结点
+    std::unordered_multimap<std::size_t, Type*> mTypes;
+    std::unordered_multimap<std::size_t, TypeExpr*> mTexps;
   };
 };
 
 struct TypeExpr : Obj
 {
   TypeExpr* sub{ nullptr };
+  const Kind tag;
+  std::uint32_t canon{ 0 }; /// 所属类型缓存的编号，0 表示不是规范结点
 
-  bool operator==(const TypeExpr& other) const
+  /**
+   * @brief 比较两个可能为空的类型表达式，空表示没有更多的类型表达式
+   *
+   * 不能在 operator== 中判断 this 是否为空，那是未定义行为，开启优化后
+   * 判断会被编译器删掉。
+   */
+  static bool equal(const TypeExpr* a, const TypeExpr* b)
   {
-    if (this == &other)
+    if (a == b)
       return true;
-    if (this == nullptr || &other == nullptr)
+    if (a == nullptr || b == nullptr)
+      return false;
+    if (a->canon != 0 && a->canon == b->canon)
       return false;
-    return __equal__(other);
+    return a->__equal__(*b);
   }
 
+  bool operator==(const TypeExpr& other) const { return equal(this, &other); }
+
   bool operator!=(const TypeExpr& other) const { return !operator==(other); }
 
 protected:
+  explicit TypeExpr(Kind tag)
+    : tag(tag)
+  {
+  }
+
   void __mark__(Mark mark) override;
 
 private:
@@ -99,6 +204,11 @@ private:
 
 struct PointerType : TypeExpr
 {
+  PointerType()
+    : TypeExpr(Kind::kPointerType)
+  {
+  }
+
   Type::Qual qual;
 
 private:
@@ -107,15 +217,29 @@ private:
 
 struct ArrayType : TypeExpr
 {
+  ArrayType()
+    : TypeExpr(Kind::kArrayType)
+  {
+  }
+
   std::uint32_t len{ 0 }; /// 数组长度，kUnLen 表示未知
   static constexpr std::uint32_t kUnLen = UINT32_MAX;
 
+  /// 写成表达式的数组长度，由 Typing 求值后填入 len 并置空，规范结点总为空
+  Expr* lenExpr{ nullptr };
+
 private:
+  void __mark__(Mark mark) override;
   bool __equal__(const TypeExpr& other) const override;
 };
 
 struct FunctionType : TypeExpr
 {
+  FunctionType()
+    : TypeExpr(Kind::kFunctionType)
+  {
+  }
+
   std::vector<const Type*> params;
 
 private:
@@ -131,6 +255,8 @@ struct Decl;
 
 struct Expr : Obj
 {
+  Expr() = default;
+
   enum struct Cate : std::uint8_t
   {
     kINVALID,
@@ -138,25 +264,47 @@ struct Expr : Obj
     kLValue,
   };
 
-  const Type* type;
+  const Type* type{ nullptr };
+  SourceLoc loc;
   Cate cate{ Cate::kINVALID };
+  const Kind tag{ Kind::kINVALID };
 
 protected:
+  explicit Expr(Kind tag)
+    : tag(tag)
+  {
+  }
+
   void __mark__(Mark mark) override;
 };
 
 struct IntegerLiteral : Expr
 {
+  IntegerLiteral()
+    : Expr(Kind::kIntegerLiteral)
+  {
+  }
+
   std::uint64_t val{ 0 };
 };
 
 struct StringLiteral : Expr
 {
+  StringLiteral()
+    : Expr(Kind::kStringLiteral)
+  {
+  }
+
   std::string val;
 };
 
 struct DeclRefExpr : Expr
 {
+  DeclRefExpr()
+    : Expr(Kind::kDeclRefExpr)
+  {
+  }
+
   Decl* decl{ nullptr };
 
 private:
@@ -165,6 +313,11 @@ private:
 
 struct ParenExpr : Expr
 {
+  ParenExpr()
+    : Expr(Kind::kParenExpr)
+  {
+  }
+
   Expr* sub{ nullptr };
 
 private:
@@ -173,6 +326,11 @@ private:
 
 struct UnaryExpr : Expr
 {
+  UnaryExpr()
+    : Expr(Kind::kUnaryExpr)
+  {
+  }
+
   enum Op
   {
     kINVALID,
@@ -190,6 +348,11 @@ private:
 
 struct BinaryExpr : Expr
 {
+  BinaryExpr()
+    : Expr(Kind::kBinaryExpr)
+  {
+  }
+
   enum Op
   {
     kINVALID,
@@ -220,6 +383,11 @@ private:
 
 struct CallExpr : Expr
 {
+  CallExpr()
+    : Expr(Kind::kCallExpr)
+  {
+  }
+
   Expr* head{ nullptr };
   std::vector<Expr*> args;
 
@@ -229,6 +397,11 @@ private:
 
 struct InitListExpr : Expr
 {
+  InitListExpr()
+    : Expr(Kind::kInitListExpr)
+  {
+  }
+
   std::vector<Expr*> list;
 
 private:
@@ -236,10 +409,20 @@ private:
 };
 
 struct ImplicitInitExpr : Expr
-{};
+{
+  ImplicitInitExpr()
+    : Expr(Kind::kImplicitInitExpr)
+  {
+  }
+};
 
 struct ImplicitCastExpr : Expr
 {
+  ImplicitCastExpr()
+    : Expr(Kind::kImplicitCastExpr)
+  {
+  }
+
   enum
   {
     kINVALID,
@@ -262,16 +445,37 @@ private:
 struct FunctionDecl;
 
 struct Stmt : Obj
-{};
+{
+  Stmt() = default;
+
+  SourceLoc loc;
+  const Kind tag{ Kind::kINVALID };
+
+protected:
+  explicit Stmt(Kind tag)
+    : tag(tag)
+  {
+  }
+};
 
 struct NullStmt : Stmt
 {
+  NullStmt()
+    : Stmt(Kind::kNullStmt)
+  {
+  }
+
 protected:
   void __mark__(Mark mark) override;
 };
 
 struct DeclStmt : Stmt
 {
+  DeclStmt()
+    : Stmt(Kind::kDeclStmt)
+  {
+  }
+
   std::vector<Decl*> decls;
 
 private:
@@ -280,6 +484,11 @@ private:
 
 struct ExprStmt : Stmt
 {
+  ExprStmt()
+    : Stmt(Kind::kExprStmt)
+  {
+  }
+
   Expr* expr{ nullptr };
 
 private:
@@ -288,6 +497,11 @@ private:
 
 struct CompoundStmt : Stmt
 {
+  CompoundStmt()
+    : Stmt(Kind::kCompoundStmt)
+  {
+  }
+
   std::vector<Stmt*> subs;
 
 private:
@@ -296,6 +510,11 @@ private:
 
 struct IfStmt : Stmt
 {
+  IfStmt()
+    : Stmt(Kind::kIfStmt)
+  {
+  }
+
   Expr* cond{ nullptr };
   Stmt *then{ nullptr }, *else_{ nullptr };
 
@@ -305,6 +524,11 @@ private:
 
 struct WhileStmt : Stmt
 {
+  WhileStmt()
+    : Stmt(Kind::kWhileStmt)
+  {
+  }
+
   Expr* cond{ nullptr };
   Stmt* body{ nullptr };
 
@@ -314,6 +538,11 @@ private:
 
 struct DoStmt : Stmt
 {
+  DoStmt()
+    : Stmt(Kind::kDoStmt)
+  {
+  }
+
   Stmt* body{ nullptr };
   Expr* cond{ nullptr };
 
@@ -323,6 +552,11 @@ private:
 
 struct BreakStmt : Stmt
 {
+  BreakStmt()
+    : Stmt(Kind::kBreakStmt)
+  {
+  }
+
   Stmt* loop{ nullptr };
 
 private:
@@ -331,6 +565,11 @@ private:
 
 struct ContinueStmt : Stmt
 {
+  ContinueStmt()
+    : Stmt(Kind::kContinueStmt)
+  {
+  }
+
   Stmt* loop{ nullptr };
 
 private:
@@ -339,6 +578,11 @@ private:
 
 struct ReturnStmt : Stmt
 {
+  ReturnStmt()
+    : Stmt(Kind::kReturnStmt)
+  {
+  }
+
   FunctionDecl* func{ nullptr };
   Expr* expr{ nullptr };
 
@@ -352,15 +596,29 @@ private:
 
 struct Decl : Obj
 {
-  const Type* type;
-  std::string name;
+  Decl() = default;
+
+  const Type* type{ nullptr };
+  Symbol name{};
+  SourceLoc loc;
+  const Kind tag{ Kind::kINVALID };
 
 protected:
+  explicit Decl(Kind tag)
+    : tag(tag)
+  {
+  }
+
   void __mark__(Mark mark) override;
 };
 
 struct VarDecl : Decl
 {
+  VarDecl()
+    : Decl(Kind::kVarDecl)
+  {
+  }
+
   Expr* init{ nullptr };
 
 private:
@@ -369,6 +627,11 @@ private:
 
 struct FunctionDecl : Decl
 {
+  FunctionDecl()
+    : Decl(Kind::kFunctionDecl)
+  {
+  }
+
   std::vector<Decl*> params;
   CompoundStmt* body{ nullptr };
 
@@ -388,4 +651,125 @@ private:
   void __mark__(Mark mark) override;
 };
 
+//==============================================================================
+// 访问器
+//==============================================================================
+
+/**
+ * @brief 按种类标签分派的访问器
+ *
+ * 各阶段以 CRTP 方式继承本模板，为关心的具体结点重载 operator()，然后在
+ * 处理 Expr*、Stmt*、Decl* 时调用 visit，由 switch 一次跳转到对应的重载。
+ * 子类需要 `using Visitor::operator();` 引入下面默认中断的重载，以免未处理
+ * 的结点被隐式转换回基类指针而无限递归；同时需要将本模板声明为友元，以便
+ * 调用子类私有的重载。
+ */
+template<typename Impl,
+         typename ExprRet,
+         typename StmtRet = void,
+         typename DeclRet = void>
+class Visitor
+{
+protected:
+  ExprRet visit(Expr* obj)
+  {
+    switch (obj->tag) {
+      case Kind::kIntegerLiteral:
+        return impl()(obj->scst<IntegerLiteral>());
+      case Kind::kStringLiteral:
+        return impl()(obj->scst<StringLiteral>());
+      case Kind::kDeclRefExpr:
+        return impl()(obj->scst<DeclRefExpr>());
+      case Kind::kParenExpr:
+        return impl()(obj->scst<ParenExpr>());
+      case Kind::kUnaryExpr:
+        return impl()(obj->scst<UnaryExpr>());
+      case Kind::kBinaryExpr:
+        return impl()(obj->scst<BinaryExpr>());
+      case Kind::kCallExpr:
+        return impl()(obj->scst<CallExpr>());
+      case Kind::kInitListExpr:
+        return impl()(obj->scst<InitListExpr>());
+      case Kind::kImplicitInitExpr:
+        return impl()(obj->scst<ImplicitInitExpr>());
+      case Kind::kImplicitCastExpr:
+        return impl()(obj->scst<ImplicitCastExpr>());
+      default:
+        ABORT();
+    }
+  }
+
+  StmtRet visit(Stmt* obj)
+  {
+    switch (obj->tag) {
+      case Kind::kNullStmt:
+        return impl()(obj->scst<NullStmt>());
+      case Kind::kDeclStmt:
+        return impl()(obj->scst<DeclStmt>());
+      case Kind::kExprStmt:
+        return impl()(obj->scst<ExprStmt>());
+      case Kind::kCompoundStmt:
+        return impl()(obj->scst<CompoundStmt>());
+      case Kind::kIfStmt:
+        return impl()(obj->scst<IfStmt>());
+      case Kind::kWhileStmt:
+        return impl()(obj->scst<WhileStmt>());
+      case Kind::kDoStmt:
+        return impl()(obj->scst<DoStmt>());
+      case Kind::kBreakStmt:
+        return impl()(obj->scst<BreakStmt>());
+      case Kind::kContinueStmt:
+        return impl()(obj->scst<ContinueStmt>());
+      case Kind::kReturnStmt:
+        return impl()(obj->scst<ReturnStmt>());
+      default:
+        ABORT();
+    }
+  }
+
+  DeclRet visit(Decl* obj)
+  {
+    switch (obj->tag) {
+      case Kind::kVarDecl:
+        return impl()(obj->scst<VarDecl>());
+      case Kind::kFunctionDecl:
+        return impl()(obj->scst<FunctionDecl>());
+      default:
+        ABORT();
+    }
+  }
+
+  //============================================================================
+  // 默认实现
+  //============================================================================
+
+  ExprRet operator()(IntegerLiteral* obj) { ABORT(); }
+  ExprRet operator()(StringLiteral* obj) { ABORT(); }
+  ExprRet operator()(DeclRefExpr* obj) { ABORT(); }
+  ExprRet operator()(ParenExpr* obj) { ABORT(); }
+  ExprRet operator()(UnaryExpr* obj) { ABORT(); }
+  ExprRet operator()(BinaryExpr* obj) { ABORT(); }
+  ExprRet operator()(CallExpr* obj) { ABORT(); }
+  ExprRet operator()(InitListExpr* obj) { ABORT(); }
+  ExprRet operator()(ImplicitInitExpr* obj) { ABORT(); }
+  ExprRet operator()(ImplicitCastExpr* obj) { ABORT(); }
+
+  StmtRet operator()(NullStmt* obj) { ABORT(); }
+  StmtRet operator()(DeclStmt* obj) { ABORT(); }
+  StmtRet operator()(ExprStmt* obj) { ABORT(); }
+  StmtRet operator()(CompoundStmt* obj) { ABORT(); }
+  StmtRet operator()(IfStmt* obj) { ABORT(); }
+  StmtRet operator()(WhileStmt* obj) { ABORT(); }
+  StmtRet operator()(DoStmt* obj) { ABORT(); }
+  StmtRet operator()(BreakStmt* obj) { ABORT(); }
+  StmtRet operator()(ContinueStmt* obj) { ABORT(); }
+  StmtRet operator()(ReturnStmt* obj) { ABORT(); }
+
+  DeclRet operator()(VarDecl* obj) { ABORT(); }
+  DeclRet operator()(FunctionDecl* obj) { ABORT(); }
+
+private:
+  Impl& impl() { return static_cast<Impl&>(*this); }
+};
+
 } // namespace asg
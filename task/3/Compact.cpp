@@ -0,0 +1,664 @@
+#include "Compact.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <type_traits>
+
+namespace asg::compact {
+
+//==============================================================================
+// 建立
+//==============================================================================
+
+/**
+ * 用显式栈先序建立：处理一个结点时先为它的全部子结点分配记录、填好父结点里的
+ * Ref，再把子结点逆序压栈，于是兄弟结点在各自的数组里相邻，而且按源代码的顺序
+ * 填写。声明和循环在分配时记下 Ref，供之后引用它们的结点查找。
+ */
+struct Graph::Builder : Visitor<Builder, Ref, Ref, Ref>
+{
+  friend Visitor;
+
+  Graph& g;
+
+  explicit Builder(Graph& graph)
+    : g(graph)
+  {
+    g.mTypes.push_back(nullptr);
+    mTypeIds.emplace(nullptr, 0);
+  }
+
+  void operator()(TranslationUnit* tu)
+  {
+    g.mDecls = list(tu->decls);
+    g.mSourceBytes += sizeof(TranslationUnit);
+    reverse_from(0);
+
+    while (!mWork.empty()) {
+      auto item = mWork.back();
+      mWork.pop_back();
+      auto base = mWork.size();
+      (this->*item.mFill)(item.mObj, item.mRef);
+      reverse_from(base);
+    }
+
+    std::apply([](auto&... vec) { (vec.shrink_to_fit(), ...); }, g.mNodes);
+    g.mRefs.shrink_to_fit();
+    g.mTypes.shrink_to_fit();
+  }
+
+private:
+  struct Item
+  {
+    Obj* mObj;
+    Ref mRef;
+    void (Builder::*mFill)(Obj* obj, Ref ref);
+  };
+
+  std::vector<Item> mWork;
+  std::unordered_map<const Obj*, Ref> mRefOf;
+  std::unordered_map<const Type*, std::uint32_t> mTypeIds;
+
+  /// 刚压栈的子结点是正序的，倒过来才能按正序弹出
+  void reverse_from(std::size_t base)
+  {
+    std::reverse(mWork.begin() + base, mWork.end());
+  }
+
+  template<typename T>
+  Rec<T>& at(Ref ref)
+  {
+    return std::get<std::vector<Rec<T>>>(g.mNodes)[ref.index()];
+  }
+
+  /// 为 \p obj 分配记录并压栈，记录等弹出时再填
+  template<typename T>
+  Ref operator()(T* obj)
+  {
+    auto& vec = std::get<std::vector<Rec<T>>>(g.mNodes);
+    ASSERT(vec.size() < (1u << Ref::kIndexBits));
+    Ref ref(Rec<T>::kKind, vec.size());
+    vec.emplace_back();
+    mWork.push_back({ obj, ref, &Builder::fill_obj<T> });
+    g.mSourceBytes += sizeof(T);
+
+    if constexpr (std::is_base_of_v<Decl, T> ||
+                  std::is_same_v<T, WhileStmt> || std::is_same_v<T, DoStmt>)
+      mRefOf.emplace(obj, ref);
+    return ref;
+  }
+
+  template<typename T>
+  Ref child(T* obj)
+  {
+    return obj ? visit(obj) : Ref();
+  }
+
+  template<typename T>
+  Slice list(const std::vector<T*>& vec)
+  {
+    Slice slice{ std::uint32_t(g.mRefs.size()), std::uint32_t(vec.size()) };
+    g.mRefs.resize(g.mRefs.size() + vec.size());
+    for (std::size_t i = 0; i < vec.size(); ++i)
+      g.mRefs[slice.begin + i] = visit(vec[i]);
+    g.mSourceBytes += vec.capacity() * sizeof(T*);
+    return slice;
+  }
+
+  /// 引用的不是子结点，而是之前分配过的声明或循环
+  Ref ref_of(const Obj* obj)
+  {
+    if (obj == nullptr)
+      return {};
+    auto iter = mRefOf.find(obj);
+    ASSERT(iter != mRefOf.end());
+    return iter->second;
+  }
+
+  std::uint32_t type_id(const Type* type)
+  {
+    auto [iter, inserted] = mTypeIds.try_emplace(type, g.mTypes.size());
+    if (inserted)
+      g.mTypes.push_back(type);
+    return iter->second;
+  }
+
+  template<typename R>
+  void head(R& r, Expr* obj)
+  {
+    r.type = type_id(obj->type);
+    r.loc = obj->loc;
+    r.cate = obj->cate;
+  }
+
+  template<typename T>
+  void fill_obj(Obj* obj, Ref ref)
+  {
+    fill(obj->scst<T>(), ref);
+  }
+
+  // 先分配子结点再取记录：分配可能让同一种类的数组搬家，之前取的引用会失效
+
+  void fill(IntegerLiteral* obj, Ref ref)
+  {
+    auto& r = at<IntegerLiteral>(ref);
+    head(r, obj);
+    r.val = obj->val;
+  }
+
+  void fill(StringLiteral* obj, Ref ref)
+  {
+    auto& r = at<StringLiteral>(ref);
+    head(r, obj);
+    r.val = Symbol(obj->val);
+
+    // 短字符串存在对象内部，不另占堆
+    auto data = reinterpret_cast<const char*>(obj->val.data());
+    if (data < reinterpret_cast<const char*>(obj) ||
+        data >= reinterpret_cast<const char*>(obj + 1))
+      g.mSourceBytes += obj->val.capacity() + 1;
+  }
+
+  void fill(DeclRefExpr* obj, Ref ref)
+  {
+    auto decl = ref_of(obj->decl);
+    auto& r = at<DeclRefExpr>(ref);
+    head(r, obj);
+    r.decl = decl;
+  }
+
+  void fill(ParenExpr* obj, Ref ref)
+  {
+    auto sub = child(obj->sub);
+    auto& r = at<ParenExpr>(ref);
+    head(r, obj);
+    r.sub = sub;
+  }
+
+  void fill(UnaryExpr* obj, Ref ref)
+  {
+    auto sub = child(obj->sub);
+    auto& r = at<UnaryExpr>(ref);
+    head(r, obj);
+    r.op = obj->op;
+    r.sub = sub;
+  }
+
+  void fill(BinaryExpr* obj, Ref ref)
+  {
+    auto lft = child(obj->lft);
+    auto rht = child(obj->rht);
+    auto& r = at<BinaryExpr>(ref);
+    head(r, obj);
+    r.op = obj->op;
+    r.lft = lft, r.rht = rht;
+  }
+
+  void fill(CallExpr* obj, Ref ref)
+  {
+    auto callee = child(obj->head);
+    auto args = list(obj->args);
+    auto& r = at<CallExpr>(ref);
+    head(r, obj);
+    r.head = callee;
+    r.args = args;
+  }
+
+  void fill(InitListExpr* obj, Ref ref)
+  {
+    auto elems = list(obj->list);
+    auto& r = at<InitListExpr>(ref);
+    head(r, obj);
+    r.list = elems;
+  }
+
+  void fill(ImplicitInitExpr* obj, Ref ref)
+  {
+    head(at<ImplicitInitExpr>(ref), obj);
+  }
+
+  void fill(ImplicitCastExpr* obj, Ref ref)
+  {
+    auto sub = child(obj->sub);
+    auto& r = at<ImplicitCastExpr>(ref);
+    head(r, obj);
+    r.kind = obj->kind;
+    r.sub = sub;
+  }
+
+  void fill(NullStmt* obj, Ref ref) { at<NullStmt>(ref).loc = obj->loc; }
+
+  void fill(DeclStmt* obj, Ref ref)
+  {
+    auto decls = list(obj->decls);
+    auto& r = at<DeclStmt>(ref);
+    r.loc = obj->loc;
+    r.decls = decls;
+  }
+
+  void fill(ExprStmt* obj, Ref ref)
+  {
+    auto expr = child(obj->expr);
+    auto& r = at<ExprStmt>(ref);
+    r.loc = obj->loc;
+    r.expr = expr;
+  }
+
+  void fill(CompoundStmt* obj, Ref ref)
+  {
+    auto subs = list(obj->subs);
+    auto& r = at<CompoundStmt>(ref);
+    r.loc = obj->loc;
+    r.subs = subs;
+  }
+
+  void fill(IfStmt* obj, Ref ref)
+  {
+    auto cond = child(obj->cond);
+    auto then = child(obj->then);
+    auto else_ = child(obj->else_);
+    auto& r = at<IfStmt>(ref);
+    r.loc = obj->loc;
+    r.cond = cond, r.then = then, r.else_ = else_;
+  }
+
+  void fill(WhileStmt* obj, Ref ref)
+  {
+    auto cond = child(obj->cond);
+    auto body = child(obj->body);
+    auto& r = at<WhileStmt>(ref);
+    r.loc = obj->loc;
+    r.cond = cond, r.body = body;
+  }
+
+  void fill(DoStmt* obj, Ref ref)
+  {
+    auto body = child(obj->body);
+    auto cond = child(obj->cond);
+    auto& r = at<DoStmt>(ref);
+    r.loc = obj->loc;
+    r.body = body, r.cond = cond;
+  }
+
+  void fill(BreakStmt* obj, Ref ref)
+  {
+    auto& r = at<BreakStmt>(ref);
+    r.loc = obj->loc;
+    r.loop = ref_of(obj->loop);
+  }
+
+  void fill(ContinueStmt* obj, Ref ref)
+  {
+    auto& r = at<ContinueStmt>(ref);
+    r.loc = obj->loc;
+    r.loop = ref_of(obj->loop);
+  }
+
+  void fill(ReturnStmt* obj, Ref ref)
+  {
+    auto expr = child(obj->expr);
+    auto& r = at<ReturnStmt>(ref);
+    r.loc = obj->loc;
+    r.func = ref_of(obj->func);
+    r.expr = expr;
+  }
+
+  void fill(VarDecl* obj, Ref ref)
+  {
+    auto init = child(obj->init);
+    auto& r = at<VarDecl>(ref);
+    r.type = type_id(obj->type);
+    r.name = obj->name;
+    r.loc = obj->loc;
+    r.init = init;
+  }
+
+  void fill(FunctionDecl* obj, Ref ref)
+  {
+    auto params = list(obj->params);
+    auto body = child<Stmt>(obj->body);
+    auto& r = at<FunctionDecl>(ref);
+    r.type = type_id(obj->type);
+    r.name = obj->name;
+    r.loc = obj->loc;
+    r.params = params;
+    r.body = body;
+  }
+};
+
+Graph::Graph(TranslationUnit* tu)
+{
+  Builder builder(*this);
+  builder(tu);
+}
+
+std::size_t
+Graph::nodes() const
+{
+  return std::apply([](auto&... vec) { return (vec.size() + ...); }, mNodes);
+}
+
+std::size_t
+Graph::bytes() const
+{
+  auto nodes = std::apply(
+    [](auto&... vec) {
+      return ((vec.capacity() * sizeof(vec.front())) + ...);
+    },
+    mNodes);
+  return nodes + mRefs.capacity() * sizeof(Ref) +
+         mTypes.capacity() * sizeof(const Type*);
+}
+
+//==============================================================================
+// 遍历
+//==============================================================================
+
+namespace {
+
+/// FNV-1a 风格的混合，顺序不同结果就不同
+struct Mixer
+{
+  std::uint64_t mHash{ 0xcbf29ce484222325 };
+
+  void operator()(std::uint64_t x) { mHash = (mHash ^ x) * 0x100000001b3; }
+};
+
+} // namespace
+
+std::uint64_t
+Graph::checksum() const
+{
+  Mixer mix;
+  std::vector<Ref> stack;
+  auto push = [&](Ref ref) {
+    if (ref)
+      stack.push_back(ref);
+  };
+  auto push_all = [&](Slice slice) {
+    auto refs = list(slice);
+    for (auto i = refs.end(); i != refs.begin();)
+      push(*--i);
+  };
+
+  push_all(mDecls);
+  while (!stack.empty()) {
+    auto ref = stack.back();
+    stack.pop_back();
+    mix(std::uint64_t(ref.kind()));
+
+    switch (ref.kind()) {
+      case Kind::kIntegerLiteral: {
+        auto& r = get<IntegerLiteral>(ref);
+        mix(r.loc.bits()), mix(r.val);
+      } break;
+
+      case Kind::kStringLiteral:
+        mix(get<StringLiteral>(ref).loc.bits());
+        break;
+
+      case Kind::kDeclRefExpr:
+        mix(get<DeclRefExpr>(ref).loc.bits());
+        break;
+
+      case Kind::kParenExpr: {
+        auto& r = get<ParenExpr>(ref);
+        mix(r.loc.bits()), push(r.sub);
+      } break;
+
+      case Kind::kUnaryExpr: {
+        auto& r = get<UnaryExpr>(ref);
+        mix(r.loc.bits()), push(r.sub);
+      } break;
+
+      case Kind::kBinaryExpr: {
+        auto& r = get<BinaryExpr>(ref);
+        mix(r.loc.bits()), push(r.rht), push(r.lft);
+      } break;
+
+      case Kind::kCallExpr: {
+        auto& r = get<CallExpr>(ref);
+        mix(r.loc.bits()), push_all(r.args), push(r.head);
+      } break;
+
+      case Kind::kInitListExpr: {
+        auto& r = get<InitListExpr>(ref);
+        mix(r.loc.bits()), push_all(r.list);
+      } break;
+
+      case Kind::kImplicitInitExpr:
+        mix(get<ImplicitInitExpr>(ref).loc.bits());
+        break;
+
+      case Kind::kImplicitCastExpr: {
+        auto& r = get<ImplicitCastExpr>(ref);
+        mix(r.loc.bits()), push(r.sub);
+      } break;
+
+      case Kind::kNullStmt:
+        mix(get<NullStmt>(ref).loc.bits());
+        break;
+
+      case Kind::kDeclStmt: {
+        auto& r = get<DeclStmt>(ref);
+        mix(r.loc.bits()), push_all(r.decls);
+      } break;
+
+      case Kind::kExprStmt: {
+        auto& r = get<ExprStmt>(ref);
+        mix(r.loc.bits()), push(r.expr);
+      } break;
+
+      case Kind::kCompoundStmt: {
+        auto& r = get<CompoundStmt>(ref);
+        mix(r.loc.bits()), push_all(r.subs);
+      } break;
+
+      case Kind::kIfStmt: {
+        auto& r = get<IfStmt>(ref);
+        mix(r.loc.bits()), push(r.else_), push(r.then), push(r.cond);
+      } break;
+
+      case Kind::kWhileStmt: {
+        auto& r = get<WhileStmt>(ref);
+        mix(r.loc.bits()), push(r.body), push(r.cond);
+      } break;
+
+      case Kind::kDoStmt: {
+        auto& r = get<DoStmt>(ref);
+        mix(r.loc.bits()), push(r.cond), push(r.body);
+      } break;
+
+      case Kind::kBreakStmt:
+        mix(get<BreakStmt>(ref).loc.bits());
+        break;
+
+      case Kind::kContinueStmt:
+        mix(get<ContinueStmt>(ref).loc.bits());
+        break;
+
+      case Kind::kReturnStmt: {
+        auto& r = get<ReturnStmt>(ref);
+        mix(r.loc.bits()), push(r.expr);
+      } break;
+
+      case Kind::kVarDecl: {
+        auto& r = get<VarDecl>(ref);
+        mix(r.loc.bits()), mix(r.name.id()), push(r.init);
+      } break;
+
+      case Kind::kFunctionDecl: {
+        auto& r = get<FunctionDecl>(ref);
+        mix(r.loc.bits()), mix(r.name.id()), push(r.body), push_all(r.params);
+      } break;
+
+      default:
+        ABORT();
+    }
+  }
+  return mix.mHash;
+}
+
+std::uint64_t
+checksum(TranslationUnit* tu)
+{
+  Mixer mix;
+  std::vector<std::pair<Obj*, Kind>> stack;
+  auto push = [&](auto* obj) {
+    if (obj)
+      stack.emplace_back(obj, obj->tag);
+  };
+  auto push_all = [&](auto& vec) {
+    for (auto i = vec.rbegin(); i != vec.rend(); ++i)
+      push(*i);
+  };
+
+  push_all(tu->decls);
+  while (!stack.empty()) {
+    auto [obj, tag] = stack.back();
+    stack.pop_back();
+    mix(std::uint64_t(tag));
+
+    switch (tag) {
+      case Kind::kIntegerLiteral: {
+        auto p = obj->scst<IntegerLiteral>();
+        mix(p->loc.bits()), mix(p->val);
+      } break;
+
+      case Kind::kStringLiteral:
+      case Kind::kDeclRefExpr:
+      case Kind::kImplicitInitExpr:
+        mix(obj->scst<Expr>()->loc.bits());
+        break;
+
+      case Kind::kParenExpr: {
+        auto p = obj->scst<ParenExpr>();
+        mix(p->loc.bits()), push(p->sub);
+      } break;
+
+      case Kind::kUnaryExpr: {
+        auto p = obj->scst<UnaryExpr>();
+        mix(p->loc.bits()), push(p->sub);
+      } break;
+
+      case Kind::kBinaryExpr: {
+        auto p = obj->scst<BinaryExpr>();
+        mix(p->loc.bits()), push(p->rht), push(p->lft);
+      } break;
+
+      case Kind::kCallExpr: {
+        auto p = obj->scst<CallExpr>();
+        mix(p->loc.bits()), push_all(p->args), push(p->head);
+      } break;
+
+      case Kind::kInitListExpr: {
+        auto p = obj->scst<InitListExpr>();
+        mix(p->loc.bits()), push_all(p->list);
+      } break;
+
+      case Kind::kImplicitCastExpr: {
+        auto p = obj->scst<ImplicitCastExpr>();
+        mix(p->loc.bits()), push(p->sub);
+      } break;
+
+      case Kind::kNullStmt:
+      case Kind::kBreakStmt:
+      case Kind::kContinueStmt:
+        mix(obj->scst<Stmt>()->loc.bits());
+        break;
+
+      case Kind::kDeclStmt: {
+        auto p = obj->scst<DeclStmt>();
+        mix(p->loc.bits()), push_all(p->decls);
+      } break;
+
+      case Kind::kExprStmt: {
+        auto p = obj->scst<ExprStmt>();
+        mix(p->loc.bits()), push(p->expr);
+      } break;
+
+      case Kind::kCompoundStmt: {
+        auto p = obj->scst<CompoundStmt>();
+        mix(p->loc.bits()), push_all(p->subs);
+      } break;
+
+      case Kind::kIfStmt: {
+        auto p = obj->scst<IfStmt>();
+        mix(p->loc.bits()), push(p->else_), push(p->then), push(p->cond);
+      } break;
+
+      case Kind::kWhileStmt: {
+        auto p = obj->scst<WhileStmt>();
+        mix(p->loc.bits()), push(p->body), push(p->cond);
+      } break;
+
+      case Kind::kDoStmt: {
+        auto p = obj->scst<DoStmt>();
+        mix(p->loc.bits()), push(p->cond), push(p->body);
+      } break;
+
+      case Kind::kReturnStmt: {
+        auto p = obj->scst<ReturnStmt>();
+        mix(p->loc.bits()), push(p->expr);
+      } break;
+
+      case Kind::kVarDecl: {
+        auto p = obj->scst<VarDecl>();
+        mix(p->loc.bits()), mix(p->name.id()), push(p->init);
+      } break;
+
+      case Kind::kFunctionDecl: {
+        auto p = obj->scst<FunctionDecl>();
+        mix(p->loc.bits()), mix(p->name.id()), push(p->body);
+        push_all(p->params);
+      } break;
+
+      default:
+        ABORT();
+    }
+  }
+  return mix.mHash;
+}
+
+//==============================================================================
+// 比较
+//==============================================================================
+
+void
+report(TranslationUnit* tu, std::ostream& os)
+{
+  using Clock = std::chrono::steady_clock;
+  using Ms = std::chrono::duration<double, std::milli>;
+
+  auto since = Clock::now();
+  Graph graph(tu);
+  Ms build = Clock::now() - since;
+
+  // 各遍历若干遍取最快的一次，排除冷缓存和调度的干扰
+  auto best = [](auto&& walk, std::uint64_t& sum) {
+    double ret = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 5; ++i) {
+      auto since = Clock::now();
+      sum = walk();
+      ret = std::min(ret, Ms(Clock::now() - since).count());
+    }
+    return ret;
+  };
+  std::uint64_t ptrSum, compactSum;
+  auto ptrMs = best([&] { return checksum(tu); }, ptrSum);
+  auto compactMs = best([&] { return graph.checksum(); }, compactSum);
+  ASSERT(ptrSum == compactSum);
+
+  auto nodes = graph.nodes();
+  auto print = [&](const char* layout, std::size_t bytes, double ms) {
+    os << "布局[" << layout << "]：" << nodes << " 个结点，" << bytes
+       << " 字节，平均 " << double(bytes) / std::max<std::size_t>(nodes, 1)
+       << " 字节/结点，遍历 " << ms << " ms";
+  };
+  print("指针", graph.source_bytes(), ptrMs);
+  os << '\n';
+  print("紧凑", graph.bytes(), compactMs);
+  os << "，建立 " << build.count() << " ms" << std::endl;
+}
+
+} // namespace asg::compact
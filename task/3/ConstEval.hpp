@@ -0,0 +1,69 @@
+#pragma once
+
+#include "asg.hpp"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+namespace asg {
+
+/**
+ * @brief 整型常量表达式求值
+ *
+ * 在推导过类型的语义图上求整型表达式的值。每步运算的结果都截断到该表达式类型
+ * 的位宽：有符号整数溢出在 C 中是未定义行为，这里按补码回绕，与不带 nsw 标志
+ * 的 LLVM 指令一致；除数为零、最小值除以 -1 这类运行时出错的运算则不是常量。
+ *
+ * 除字面量和运算之外，带初始化的 const 整型变量（全局、局部均可）也当作常量，
+ * 其值取自初始化表达式。函数调用、赋值和数组下标不是常量，但 `0 && f()` 这样
+ * 不会被求值的部分不影响整个表达式是常量。
+ *
+ * 每个表达式的结果都会记住，反复求值或者沿变量引用求值都只算一次。记住的结果
+ * 以结点指针为键，求值之后不应再修改语义图。
+ */
+class ConstEval : public Visitor<ConstEval, std::optional<std::int64_t>>
+{
+  friend Visitor;
+
+public:
+  using Value = std::optional<std::int64_t>;
+
+  /// 求 \p obj 的值，不是整型常量表达式时返回空
+  Value operator()(Expr* obj);
+
+  /// 初始化表达式 \p init 是否全由常量组成，初始化列表逐个元素检查
+  bool constant_init(Expr* init);
+
+  /// 整数类型 \p spec 的位宽，非整数类型返回 0。EmitIR 也按它降低整数类型
+  static unsigned bits(Type::Spec spec);
+
+  /// 把 \p v 截断到 \p spec 的位宽，再符号扩展回 64 位
+  static std::int64_t wrap(std::uint64_t v, Type::Spec spec);
+
+private:
+  std::unordered_map<const Expr*, Value> mMemo;
+
+  using Visitor::operator();
+
+  Value operator()(IntegerLiteral* obj);
+
+  Value operator()(StringLiteral* obj);
+
+  Value operator()(DeclRefExpr* obj);
+
+  Value operator()(ParenExpr* obj);
+
+  Value operator()(UnaryExpr* obj);
+
+  Value operator()(BinaryExpr* obj);
+
+  Value operator()(CallExpr* obj);
+
+  Value operator()(InitListExpr* obj);
+
+  Value operator()(ImplicitInitExpr* obj);
+
+  Value operator()(ImplicitCastExpr* obj);
+};
+
+} // namespace asg
@@ -1,5 +1,8 @@
 #include "EmitIR.hpp"
+#include "Pool.hpp"
 #include <functional>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/ValueSymbolTable.h>
 #include <llvm/Transforms/Utils/ModuleUtils.h>
 
@@ -21,31 +24,248 @@ EmitIR::EmitIR(Obj::Mgr& mgr, llvm::LLVMContext& ctx, llvm::StringRef mid)
 llvm::Module&
 EmitIR::operator()(asg::TranslationUnit* tu)
 {
-  for (auto&& i : tu->decls)
-    self(i);
+  for (auto&& i : tu->decls) {
+    auto func = i->dcst<FunctionDecl>();
+    if (!mDeferBody || !func || !func->body) {
+      self(i);
+      continue;
+    }
+
+    declare(func), mark(func);
+    if (mDeferBody(func))
+      continue;
+    auto last = &mMod.getFunctionList().back();
+    emit_body(func, func->any_as<llvm::Function>());
+    for (auto it = std::next(last->getIterator()); it != mMod.end(); ++it)
+      mIntrinsics.emplace(&*it, mMarks.size() - 1);
+  }
+  settle();
+  return mMod;
+}
+
+namespace {
+
+/// 按函数并行时一个工作线程的状态
+struct Worker
+{
+  llvm::LLVMContext mCtx; // 须比 mEmit 后析构
+  std::unique_ptr<EmitIR> mEmit;
+  llvm::SmallVector<char, 0> mBitcode;
+  std::unique_ptr<llvm::Module> mMod; ///< 读回主线程 LLVMContext 中的模块
+
+  /// 依次生成的函数体的序号，以及各自新建的私有常量个数
+  std::vector<std::pair<std::size_t, std::size_t>> mDone;
+};
+
+} // namespace
+
+llvm::Module&
+EmitIR::operator()(TranslationUnit* tu, unsigned jobs)
+{
+  if (jobs <= 1)
+    return self(tu);
+
+  // 全局变量和函数声明，并记下每个函数体在串行时生成的位置
+  std::vector<FunctionDecl*> funcs;
+  for (auto&& i : tu->decls) {
+    auto func = i->dcst<FunctionDecl>();
+    if (func && func->body) {
+      declare(func), mark(func);
+      if (!mDeferBody || !mDeferBody(func))
+        funcs.push_back(func);
+    } else
+      self(i);
+  }
+  // 工作线程不碰 mMod，此后到移入函数体之前 mMod 都不会再变
+  settle();
+  if (funcs.empty())
+    return mMod;
+
+  jobs = std::min<std::size_t>(jobs, funcs.size());
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (unsigned w = 0; w < jobs; ++w) {
+    auto& worker = *workers.emplace_back(std::make_unique<Worker>());
+    worker.mEmit = std::make_unique<EmitIR>(
+      mMgr, worker.mCtx, mMod.getModuleIdentifier());
+  }
+
+  std::vector<unsigned> owners(funcs.size());
+  pool::run(funcs.size(), jobs, [&](std::size_t i, unsigned w) {
+    auto& mod = workers[w]->mEmit->mMod;
+    auto last = mod.global_empty() ? nullptr : &*std::prev(mod.global_end());
+
+    auto func = funcs[i];
+    auto& emit = *workers[w]->mEmit;
+    emit.emit_body(func, llvm::cast<llvm::Function>(emit.decl_value(func)));
+    // 参数和局部变量绑定的是工作线程 LLVMContext 中的值，它比语义图先析构
+    for (auto decl : emit.mLocals)
+      decl->any = nullptr;
+
+    std::size_t consts = 0;
+    auto it = last ? std::next(last->getIterator()) : mod.global_begin();
+    for (; it != mod.global_end(); ++it)
+      consts += !it->isDeclaration();
+    workers[w]->mDone.emplace_back(i, consts);
+    owners[i] = w;
+  });
+
+  // 各线程写出自己的模块，互不相干，仍然并行
+  pool::run(workers.size(), jobs, [&](std::size_t i, unsigned) {
+    auto& worker = *workers[i];
+    // 保留使用列表的顺序，否则读回之后基本块前驱的注释顺序会变
+    llvm::raw_svector_ostream os(worker.mBitcode);
+    llvm::WriteBitcodeToFile(worker.mEmit->mMod, os, true);
+    worker.mEmit.reset();
+  });
+
+  // 读回 mCtx，把每个函数新建的私有常量按生成的顺序对应上
+  std::vector<std::vector<llvm::GlobalVariable*>> consts(funcs.size());
+  for (auto&& worker : workers) {
+    llvm::MemoryBufferRef buf(
+      llvm::StringRef(worker->mBitcode.data(), worker->mBitcode.size()),
+      mMod.getModuleIdentifier());
+    worker->mMod = llvm::cantFail(llvm::parseBitcodeFile(buf, mCtx));
+    worker->mBitcode = {};
+
+    auto it = worker->mMod->global_begin();
+    for (auto [i, n] : worker->mDone)
+      while (consts[i].size() < n) {
+        if (!it->isDeclaration())
+          consts[i].push_back(&*it);
+        ++it;
+      }
+  }
+
+  // 按源代码的顺序移入函数体
+  for (std::size_t i = 0; i < funcs.size(); ++i) {
+    auto& mod = *workers[owners[i]]->mMod;
+    splice_body(funcs[i], mod.getFunction(funcs[i]->name.str()), consts[i]);
+  }
+
+  for (auto&& worker : workers)
+    resolve(*worker->mMod);
+
   return mMod;
 }
 
+void
+EmitIR::splice_body(FunctionDecl* func,
+                    llvm::Function* src,
+                    llvm::ArrayRef<llvm::GlobalVariable*> consts)
+{
+  auto dst = func->any_as<llvm::Function>();
+  for (auto d = dst->arg_begin(), s = src->arg_begin(); d != dst->arg_end();
+       ++d, ++s)
+    d->takeName(&*s), s->replaceAllUsesWith(&*d);
+  dst->splice(dst->end(), src);
+
+  auto place = mPlaces.at(func);
+  auto gpos = place.mGlobal ? place.mGlobal->getIterator() : mMod.global_end();
+  for (auto g : consts) {
+    g->removeFromParent();
+    mMod.insertGlobalVariable(gpos, g);
+  }
+
+  // 串行时内建函数在第一次用到时才声明，紧跟在当时正在生成的函数之后
+  auto fpos = place.mFunc ? place.mFunc->getIterator() : mMod.end();
+  for (auto&& bb : *dst)
+    for (auto&& inst : bb) {
+      auto call = llvm::dyn_cast<llvm::CallBase>(&inst);
+      auto callee = call ? call->getCalledFunction() : nullptr;
+      if (callee == nullptr || callee->getParent() == &mMod)
+        continue;
+      auto own = mMod.getFunction(callee->getName());
+      if (own == nullptr) {
+        callee->removeFromParent();
+        mMod.getFunctionList().insert(fpos, callee);
+        mIntrinsics.emplace(callee, place.mIndex);
+      } else if (auto it = mIntrinsics.find(own);
+                 it != mIntrinsics.end() && it->second > place.mIndex &&
+                 own != place.mFunc) {
+        own->removeFromParent();
+        mMod.getFunctionList().insert(fpos, own);
+        it->second = place.mIndex;
+      }
+    }
+}
+
+void
+EmitIR::resolve(llvm::Module& src)
+{
+  // 没有用到的声明在 mMod 中不一定有同名实体，直接删除
+  for (auto&& f : llvm::make_early_inc_range(src)) {
+    ASSERT(f.isDeclaration());
+    if (!f.use_empty())
+      f.replaceAllUsesWith(mMod.getFunction(f.getName()));
+    f.eraseFromParent();
+  }
+  for (auto&& g : llvm::make_early_inc_range(src.globals())) {
+    ASSERT(g.isDeclaration());
+    if (!g.use_empty())
+      g.replaceAllUsesWith(mMod.getNamedGlobal(g.getName()));
+    g.eraseFromParent();
+  }
+}
+
+void
+EmitIR::mark(FunctionDecl* func)
+{
+  mMarks.emplace_back(func, mMod.global_size(), mMod.size());
+}
+
+void
+EmitIR::settle()
+{
+  if (mMarks.empty())
+    return;
+
+  std::vector<llvm::GlobalVariable*> globals;
+  for (auto&& g : mMod.globals())
+    globals.push_back(&g);
+  std::vector<llvm::Function*> funcs;
+  for (auto&& f : mMod)
+    funcs.push_back(&f);
+
+  for (std::size_t i = 0; i < mMarks.size(); ++i) {
+    auto [func, nGlobals, nFuncs] = mMarks[i];
+    auto& place = mPlaces[func];
+    place.mGlobal = nGlobals < globals.size() ? globals[nGlobals] : nullptr;
+    place.mFunc = nFuncs < funcs.size() ? funcs[nFuncs] : nullptr;
+    place.mIndex = i;
+  }
+  mMarks.clear();
+}
+
 //==============================================================================
 // 类型
 //==============================================================================
 
 llvm::Type*
 EmitIR::operator()(const Type* type)
+{
+  if (type->canon == 0)
+    return emit_type(type);
+
+  auto& ret = mTypeMap[type];
+  if (ret == nullptr)
+    ret = emit_type(type);
+  return ret;
+}
+
+llvm::Type*
+EmitIR::emit_type(const Type* type)
 {
   if (type->texp == nullptr) {
     switch (type->spec) {
+      // 整数的位宽与常量求值共用一张表，折叠出的常量与运行时算的结果一致
+      case Type::Spec::kChar:
       case Type::Spec::kInt:
-        return llvm::Type::getInt32Ty(mCtx);
+      case Type::Spec::kLong:
+      case Type::Spec::kLongLong:
+        return llvm::IntegerType::get(mCtx, ConstEval::bits(type->spec));
       // TODO: 在此添加对更多基础类型的处理
       case Type::Spec::kVoid:
         return llvm::Type::getVoidTy(mCtx);
-      case Type::Spec::kChar:
-        return llvm::IntegerType::get(mCtx, 8);
-      case Type::Spec::kLong:
-        return llvm::IntegerType::get(mCtx, 32);
-      case Type::Spec::kLongLong:
-        return llvm::IntegerType::get(mCtx, 64);
 
       default:
         ABORT();
@@ -82,29 +302,57 @@ EmitIR::operator()(const Type* type)
 llvm::Value*
 EmitIR::operator()(Expr* obj)
 {
-  // TODO: 在此添加对更多表达式处理的跳转
-  if (auto p = obj->dcst<IntegerLiteral>())
-    return self(p);
-  else if (auto p = obj->dcst<StringLiteral>())
-    return self(p);
-  else if (auto p = obj->dcst<DeclRefExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<ParenExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<UnaryExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<BinaryExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<CallExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<InitListExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<ImplicitInitExpr>())
-    return self(p);
-  else if (auto p = obj->dcst<ImplicitCastExpr>())
-    return self(p);
+  if (obj->cate == Expr::Cate::kRValue)
+    if (auto val = mConstEval(obj))
+      return llvm::ConstantInt::get(self(obj->type), *val, true);
+  return visit(obj);
+}
 
-  ABORT();
+namespace {
+
+/// 用整数元素直接构造 ConstantDataArray，不必为每个元素建一个 ConstantInt
+template<typename T>
+llvm::Constant*
+data_array(llvm::LLVMContext& ctx,
+           ConstEval& eval,
+           InitListExpr* init,
+           std::uint64_t len)
+{
+  std::vector<T> vals(len);
+  for (std::size_t i = 0; i < len && i < init->list.size(); ++i)
+    vals[i] = T(*eval(init->list[i]));
+  return llvm::ConstantDataArray::get(ctx, llvm::ArrayRef<T>(vals));
+}
+
+} // namespace
+
+llvm::Constant*
+EmitIR::const_init(Expr* init, llvm::Type* ty)
+{
+  if (init == nullptr || init->tag == Kind::kImplicitInitExpr)
+    return llvm::Constant::getNullValue(ty);
+
+  auto arrTy = llvm::dyn_cast<llvm::ArrayType>(ty);
+  if (arrTy == nullptr)
+    return llvm::ConstantInt::get(ty, *mConstEval(init), true);
+
+  // 列表比数组短时，其余元素为零
+  auto list = init->scst<InitListExpr>();
+  auto elemTy = arrTy->getElementType();
+  auto len = arrTy->getNumElements();
+  if (elemTy->isIntegerTy(8))
+    return data_array<std::uint8_t>(mCtx, mConstEval, list, len);
+  if (elemTy->isIntegerTy(32))
+    return data_array<std::uint32_t>(mCtx, mConstEval, list, len);
+  if (elemTy->isIntegerTy(64))
+    return data_array<std::uint64_t>(mCtx, mConstEval, list, len);
+
+  std::vector<llvm::Constant*> elems;
+  elems.reserve(len);
+  for (std::size_t i = 0; i < len; ++i)
+    elems.push_back(
+      const_init(i < list->list.size() ? list->list[i] : nullptr, elemTy));
+  return llvm::ConstantArray::get(arrTy, elems);
 }
 
 llvm::Constant*
@@ -123,25 +371,9 @@ EmitIR::operator()(StringLiteral* obj)
 llvm::Value*
 EmitIR::operator()(DeclRefExpr* obj)
 {
-  auto& irb = *mCurIrb;
-  if (mCurFunc != nullptr) {
-    if (mCurFunc->getValueSymbolTable()->lookup(obj->decl->name + ".addr") !=
-        nullptr) {
-      llvm::Value* a =
-        mCurFunc->getValueSymbolTable()->lookup(obj->decl->name + ".addr");
-      // 这里不要load，后面有ImplicitCast帮你load，这里主要还是找到变量的地址
-      return a;
-    } else if (mCurFunc->getValueSymbolTable()->lookup(obj->decl->name) !=
-               nullptr) {
-      llvm::Value* a = mCurFunc->getValueSymbolTable()->lookup(obj->decl->name);
-      return a;
-    } else
-      return mMod.getGlobalVariable(obj->decl->name);
-  }
-  return mMod.getGlobalVariable(obj->decl->name);
-
-  // 也可以在处理变量声明的时候将CreateAlloca返回值存在obj的any字段中
-  // return reinterpret_cast<llvm::Value*>(obj->decl->any);
+  // 声明时已把变量地址（alloca、全局变量）或函数绑定在 decl->any 上。
+  // 这里不要load，后面有ImplicitCast帮你load，这里主要还是找到变量的地址
+  return decl_value(obj->decl);
 }
 
 llvm::Value*
@@ -158,7 +390,7 @@ EmitIR::operator()(UnaryExpr* obj)
       llvm::Value* boolValue = self(obj->sub);
       if (!boolValue->getType()->isIntegerTy(1))
         boolValue = mCurIrb->CreateICmpNE(
-          boolValue, llvm::ConstantInt::get(mCurIrb->getInt32Ty(), 0));
+          boolValue, llvm::ConstantInt::get(boolValue->getType(), 0));
       return mCurIrb->CreateNot(boolValue);
     }
     case UnaryExpr::Op::kNeg: {
@@ -220,7 +452,7 @@ EmitIR::operator()(BinaryExpr* obj)
     llvm::Value* lft = self(obj->lft);
     if (!lft->getType()->isIntegerTy(1))
       lft = mCurIrb->CreateICmpNE(
-        lft, llvm::ConstantInt::get(mCurIrb->getInt32Ty(), 0));
+        lft, llvm::ConstantInt::get(lft->getType(), 0));
 
     auto continueJudgeBlock =
       llvm::BasicBlock::Create(mCtx, "land.lhs.true", mCurFunc);
@@ -240,7 +472,7 @@ EmitIR::operator()(BinaryExpr* obj)
     llvm::Value* lft = self(obj->lft);
     if (!lft->getType()->isIntegerTy(1))
       lft = mCurIrb->CreateICmpNE(
-        lft, llvm::ConstantInt::get(mCurIrb->getInt32Ty(), 0));
+        lft, llvm::ConstantInt::get(lft->getType(), 0));
     lft = mCurIrb->CreateICmpNE(
       lft, llvm::ConstantInt::get(mCurIrb->getInt1Ty(), 1));
 
@@ -346,9 +578,9 @@ EmitIR::operator()(BinaryExpr* obj)
 llvm::Value*
 EmitIR::operator()(CallExpr* obj)
 {
-  std::string funcName =
-    obj->head->dcst<ImplicitCastExpr>()->sub->dcst<DeclRefExpr>()->decl->name;
-  llvm::Function* func = mMod.getFunction(funcName);
+  auto funcDecl =
+    obj->head->dcst<ImplicitCastExpr>()->sub->dcst<DeclRefExpr>()->decl;
+  auto func = llvm::cast<llvm::Function>(decl_value(funcDecl));
   unsigned int argsNum = (obj->args).size();
   std::vector<llvm::Value*> args(argsNum, nullptr);
   for (int i = 0; i < argsNum; i++) {
@@ -425,27 +657,7 @@ EmitIR::operator()(ImplicitCastExpr* obj)
 void
 EmitIR::operator()(Stmt* obj)
 {
-  // TODO: 在此添加对更多Stmt类型的处理的跳转
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-  if (auto p = obj->dcst<NullStmt>())
-    return self(p);
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-  ABORT();
+  return visit(obj);
 }
 
 // TODO: 在此添加对更多Stmt类型的处理
@@ -680,14 +892,26 @@ EmitIR::operator()(ContinueStmt* obj)
 void
 EmitIR::operator()(Decl* obj)
 {
-  // TODO: 添加变量声明处理的跳转
-
-  if (auto p = obj->dcst<FunctionDecl>())
-    return self(p);
+  return visit(obj);
+}
 
-  else if (auto p = obj->dcst<VarDecl>())
-    return self(p);
-  ABORT();
+llvm::Value*
+EmitIR::decl_value(Decl* decl)
+{
+  auto val = decl->any_as<llvm::Value>();
+  ASSERT(val != nullptr); // 引用出现在声明被翻译之前
+  if (&val->getContext() == &mCtx)
+    return val;
+
+  auto name = decl->name.str();
+  if (auto gv = mMod.getNamedValue(name))
+    return gv;
+  auto ty = self(decl->type);
+  if (auto fty = llvm::dyn_cast<llvm::FunctionType>(ty))
+    return llvm::Function::Create(
+      fty, llvm::GlobalValue::ExternalLinkage, name, mMod);
+  return new llvm::GlobalVariable(
+    mMod, ty, false, llvm::GlobalValue::ExternalLinkage, nullptr, name);
 }
 
 // TODO: 添加变量声明的处理
@@ -699,19 +923,36 @@ EmitIR::operator()(VarDecl* obj)
 
   // 局部变量声明
   if (mCurFunc != nullptr) {
-    // 如果局部变量已经存在，则重新进行初始化
-    llvm::Value* var = mCurFunc->getValueSymbolTable()->lookup(obj->name);
-    if(var != nullptr){
-      llvm::Value* initVal = self(obj->init);
-      mCurIrb->CreateStore(initVal, var);
-      return;
-    }
-
-    llvm::AllocaInst* alloc = mCurIrb->CreateAlloca(ty, nullptr, obj->name);
+    // 每个声明各自分配，内层同名变量遮蔽外层时也不会互相覆盖
+    llvm::AllocaInst* alloc =
+      mCurIrb->CreateAlloca(ty, nullptr, obj->name.str());
     obj->any = alloc;
+    mLocals.push_back(obj);
     // 声明并初始化
     if (obj->init != nullptr) {
-      if (dynamic_cast<InitListExpr*>(obj->init) != nullptr) {
+      if (ty->isArrayTy() && mConstEval.constant_init(obj->init)) {
+        // 初始化全是常量的数组，像 clang 一样整块置零，或者从私有的常量全局
+        // 变量整块复制，不再逐个元素 store
+        auto init = const_init(obj->init, ty);
+        auto& dl = mMod.getDataLayout();
+        auto size = dl.getTypeAllocSize(ty);
+        if (init->isNullValue())
+          mCurIrb->CreateMemSet(
+            alloc, mCurIrb->getInt8(0), size, alloc->getAlign());
+        else {
+          auto gloVar = new llvm::GlobalVariable(
+            mMod,
+            ty,
+            true,
+            llvm::GlobalValue::PrivateLinkage,
+            init,
+            "__const." + mCurFunc->getName() + "." + obj->name.str());
+          gloVar->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+          gloVar->setAlignment(dl.getPrefTypeAlign(ty));
+          mCurIrb->CreateMemCpy(
+            alloc, alloc->getAlign(), gloVar, gloVar->getAlign(), size);
+        }
+      } else if (dynamic_cast<InitListExpr*>(obj->init) != nullptr) {
         // 递归处理初始化列表的函数
         std::vector<llvm::Value*> initVals;
         bool zeroFill = false; // 是否用0填充，如果出现ImplicitInitExpr则用0填充
@@ -785,14 +1026,20 @@ EmitIR::operator()(VarDecl* obj)
     bool isConstant = obj->type->qual.const_;
     /* 请注意如果是常量，通过函数的方式初始化显然不行，因为常量创建之后就不能通过store赋值了。。。*/
     llvm::GlobalVariable* gloVar = new llvm::GlobalVariable(
-      mMod, ty, false, llvm::GlobalValue::ExternalLinkage, nullptr, obj->name);
+      mMod, ty, false, llvm::GlobalValue::ExternalLinkage, nullptr, obj->name.str());
+    obj->any = gloVar;
     gloVar->setInitializer(llvm::Constant::getNullValue(ty));
-    if (obj->init != nullptr) {
+    if (obj->init != nullptr && mConstEval.constant_init(obj->init)) {
+      // 初始化全是常量时直接作为初值，不必生成构造函数；const 变量的值之后
+      // 不会再变，可以标为常量
+      gloVar->setInitializer(const_init(obj->init, ty));
+      gloVar->setConstant(isConstant);
+    } else if (obj->init != nullptr) {
       // 2. 创建函数为全局变量进行初始化逻辑
       llvm::Function* ctorFunc = llvm::Function::Create(
         llvm::FunctionType::get(llvm::Type::getVoidTy(mCtx), false),
         llvm::GlobalValue::PrivateLinkage,
-        obj->name + "_ctor",
+        obj->name.str() + "_ctor",
         mMod);
       // 创建基本块
       llvm::BasicBlock* entryBlock =
@@ -868,37 +1115,55 @@ EmitIR::operator()(VarDecl* obj)
       llvm::appendToGlobalCtors(mMod, ctorFunc, 0);
       mCurIrb->CreateRetVoid();
     }
-    obj->any = gloVar;
   }
 }
 
 void
 EmitIR::operator()(FunctionDecl* obj)
+{
+  auto func = declare(obj);
+  if (obj->body != nullptr)
+    emit_body(obj, func);
+}
+
+llvm::Function*
+EmitIR::declare(FunctionDecl* obj)
 {
   // 创建函数
   auto fty = llvm::dyn_cast<llvm::FunctionType>(self(obj->type));
-  auto func = llvm::Function::Create(
-    fty, llvm::GlobalVariable::ExternalLinkage, obj->name, mMod);
+  // 先声明后定义的函数共用同一个 llvm::Function
+  auto func = mMod.getFunction(obj->name.str());
+  if (func == nullptr)
+    func = llvm::Function::Create(
+      fty, llvm::GlobalVariable::ExternalLinkage, obj->name.str(), mMod);
 
   obj->any = func;
+  return func;
+}
 
-  if (obj->body == nullptr)
-    return;
+void
+EmitIR::emit_body(FunctionDecl* obj, llvm::Function* func)
+{
+  auto fty = func->getFunctionType();
   // 为函数创建基本块
   auto entryBb = llvm::BasicBlock::Create(mCtx, "entry", func);
   // 并将IR插入点改为entry基本块
   mCurIrb = std::make_unique<llvm::IRBuilder<>>(entryBb);
   auto& entryIrb = *mCurIrb;
+  mLocals.clear();
 
   // TODO: 添加对函数参数的处理
   auto argBegin = func->arg_begin();
   int k = 0;
   while (argBegin != func->arg_end()) {
-    argBegin->setName(obj->params[k]->name);
+    auto name = obj->params[k]->name;
+    argBegin->setName(name.str());
     llvm::Argument* arg = &(*argBegin);
-    llvm::AllocaInst* allocaInst = entryIrb.CreateAlloca(
-      arg->getType(), nullptr, obj->params[k]->name + ".addr");
+    llvm::AllocaInst* allocaInst =
+      entryIrb.CreateAlloca(arg->getType(), nullptr, name.str() + ".addr");
     entryIrb.CreateStore(arg, allocaInst);
+    obj->params[k]->any = allocaInst;
+    mLocals.push_back(obj->params[k]);
     ++argBegin;
     ++k;
   }
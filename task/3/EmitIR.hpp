@@ -1,12 +1,17 @@
+#include "ConstEval.hpp"
 #include "asg.hpp"
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
+#include <functional>
 #include<stack>
+#include<unordered_map>
 #include<unordered_set>
 
-class EmitIR
+class EmitIR : public asg::Visitor<EmitIR, llvm::Value*>
 {
+  friend Visitor;
+
 public:
   Obj::Mgr& mMgr;
   llvm::Module mMod;
@@ -15,6 +20,36 @@ public:
 
   llvm::Module& operator()(asg::TranslationUnit* tu);
 
+  /**
+   * @brief 按函数并行地生成 IR
+   *
+   * 先在本线程依次生成全局变量和全部函数的声明，再把函数体分给 \p jobs 个
+   * 线程，见 Pool.hpp。LLVMContext 不能被多个线程同时使用，因此每个线程有
+   * 自己的 LLVMContext 和模块，函数体引用的全局变量和函数在那里另建同名声明。
+   * 线程做完后把模块写成 bitcode，本线程再读回 mCtx，按源代码的顺序把函数体
+   * 连同它用到的私有常量、内建函数声明移进 mMod，其余声明换成 mMod 中的同名
+   * 实体。全局实体在 mMod 中的先后与串行生成时相同，输出与线程的调度无关。
+   */
+  llvm::Module& operator()(asg::TranslationUnit* tu, unsigned jobs);
+
+  /// 非空时，对其返回真的函数只生成声明，函数体由调用者稍后用 splice_body
+  /// 从别处移入，比如增量编译时从缓存读回的模块
+  std::function<bool(asg::FunctionDecl*)> mDeferBody;
+
+  /**
+   * @brief 把 mCtx 中另一个模块里生成好的函数体移到 \p func 的声明里
+   *
+   * \p consts 是 \p src 用到的私有常量，它们和 \p src 用到的内建函数声明一起
+   * 移到串行生成 \p func 时所在的位置；\p src 引用的其余全局实体仍是它所在
+   * 模块中的声明，等该模块的函数体都移完后调用 resolve 换掉。
+   */
+  void splice_body(asg::FunctionDecl* func,
+                   llvm::Function* src,
+                   llvm::ArrayRef<llvm::GlobalVariable*> consts);
+
+  /// \p src 的函数体都移走之后，把剩下的声明换成 mMod 中的同名实体并删除
+  void resolve(llvm::Module& src);
+
 private:
   llvm::LLVMContext& mCtx;
 
@@ -24,6 +59,27 @@ private:
   llvm::Function* mCurFunc;
   std::unique_ptr<llvm::IRBuilder<>> mCurIrb;
 
+  /// 串行生成时紧跟在函数体新建的私有常量、内建函数声明之后的全局变量和
+  /// 函数，空表示在末尾。声明函数时还只能记下此前各有几个，见 mark 和 settle
+  struct Place
+  {
+    llvm::GlobalVariable* mGlobal{ nullptr };
+    llvm::Function* mFunc{ nullptr };
+    std::size_t mIndex{ 0 }; ///< 是源代码中的第几个函数体
+  };
+  std::unordered_map<asg::FunctionDecl*, Place> mPlaces;
+  std::vector<std::tuple<asg::FunctionDecl*, std::size_t, std::size_t>> mMarks;
+
+  /// 内建函数的声明紧跟在第几个函数体之后。直接生成的函数体先于移入的，声明
+  /// 可能落在源代码中靠后的函数体之后，移入靠前的函数体时要挪过来
+  std::unordered_map<llvm::Function*, std::size_t> mIntrinsics;
+
+  /// 在 \p func 声明之后、函数体生成之前调用，记下它的位置
+  void mark(asg::FunctionDecl* func);
+
+  /// 模块中的全局实体都生成完后调用，把记下的个数换成 mPlaces
+  void settle();
+
   std::stack<llvm::BasicBlock*> mBlockStack;  // 用于IfStmt的解析，主要是结束块的层层跳转
   std::stack<llvm::BasicBlock*> mBreakStack;   // 用于break语句，主要保存它们所在的基本块，在endBlock生成的时候取出并生成br语句
   std::stack<llvm::BasicBlock*> mContinueStack; // 用于continue语句
@@ -37,12 +93,19 @@ private:
   std::stack<llvm::Value*> mLandLhsValues;
   std::stack<llvm::BasicBlock*> mLandLhsBlocks;  // 这两个数据结构是为了解决短路求值中land.lhs.*基本块没有结束语句的问题
 
+  using Visitor::operator();
+
   //============================================================================
   // 类型
   //============================================================================
 
+  /// 规范类型到 LLVM 类型的映射，规范类型结构相同当且仅当指针相同
+  std::unordered_map<const asg::Type*, llvm::Type*> mTypeMap;
+
   llvm::Type* operator()(const asg::Type* type);
 
+  llvm::Type* emit_type(const asg::Type* type);
+
   //============================================================================
   // 表达式
   //============================================================================
@@ -51,6 +114,12 @@ private:
 
   llvm::Constant* operator()(asg::IntegerLiteral* obj);
 
+  /// 整型常量表达式在这里直接折叠成常量，不生成指令
+  asg::ConstEval mConstEval;
+
+  /// 由全是常量的初始化表达式 \p init 构造类型为 \p ty 的常量，空表示零初始化
+  llvm::Constant* const_init(asg::Expr* init, llvm::Type* ty);
+
   // TODO: 添加表达式处理相关声明
   llvm::Value* operator()(asg::StringLiteral* obj);
   llvm::Value* operator()(asg::DeclRefExpr* obj);
@@ -90,6 +159,19 @@ private:
 
   void operator()(asg::FunctionDecl* obj);
 
+  /// 创建或找到 \p obj 对应的 llvm::Function，绑定在 obj->any 上
+  llvm::Function* declare(asg::FunctionDecl* obj);
+
+  /// 把 \p obj 的函数体生成到 \p func 里
+  void emit_body(asg::FunctionDecl* obj, llvm::Function* func);
+
+  /// 最近一次 emit_body 中把 any 绑定到 alloca 上的参数和局部变量
+  std::vector<asg::Decl*> mLocals;
+
+  /// 声明 \p decl 绑定的值。并行生成时全局实体绑定的是主线程 mCtx 中的值，
+  /// 工作线程在自己的模块里另建同名声明
+  llvm::Value* decl_value(asg::Decl* decl);
+
   // TODO: 添加声明处理相关声明
   void operator()(asg::VarDecl* obj);
 };
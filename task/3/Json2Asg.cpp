@@ -1,573 +1,713 @@
 #include "Json2Asg.hpp"
+#include <llvm/ADT/StringSwitch.h>
 
 using namespace asg;
 
 TranslationUnit*
-Json2Asg::operator()(const llvm::json::Value& jval)
+Json2Asg::operator()(llvm::StringRef text)
 {
-  auto jobj = jval.getAsObject();
-  ASSERT(jobj);
-  ASSERT(jobj->getString("kind") == "TranslationUnitDecl");
-
-  auto inner = jobj->getArray("inner");
-  ASSERT(inner);
+  mCur = text.data();
+  ASSERT(mCur[text.size()] == '\0');
 
   auto ret = make<TranslationUnit>();
-  for (auto& jval : *inner) {
-    auto jobj = jval.getAsObject();
-    ASSERT(jobj);
-    if (auto p = decl(*jobj))
-      ret->decls.push_back(p);
+  llvm::StringRef kind;
+  each_key([&](llvm::StringRef key) {
+    if (key == "kind")
+      kind = string();
+    else if (key == "inner")
+      each_elem([&] {
+        auto c = node();
+        if (c.obj != nullptr)
+          ret->decls.push_back(decl(c));
+      });
+    else
+      skip_value();
+  });
+  ASSERT(kind == "TranslationUnitDecl");
+
+  // 回填前向引用
+  for (auto&& [id, slot] : mPatches) {
+    auto iter = mIdMap.find(id);
+    ASSERT(iter != mIdMap.end());
+    *slot = iter->second;
   }
+  mPatches.clear();
 
   return ret;
 }
 
-namespace {
-
-std::size_t
-jobj_id(const llvm::json::Object& jobj)
-{
-  auto id = jobj.getString("id");
-  ASSERT(id);
-  ASSERT(id->starts_with("0x"));
-  auto hexStr = id->substr(2).str();
-  return std::stoull(hexStr, nullptr, 16);
-}
-
-} // namespace
-
 //==============================================================================
-// 类型
+// JSON 扫描
 //==============================================================================
 
-const Type*
-Json2Asg::getty(const llvm::json::Object& jobj)
-{
-  auto a = jobj.getObject("type");
-  ASSERT(a);
-  auto b = a->getString("qualType");
-  ASSERT(b);
-  auto texpStr = b->str();
-
-  auto iter = mTyMap.find(texpStr);
-  if (iter != mTyMap.end())
-    return iter->second;
-
-  const Type* ty;
-  auto s = parse_type(texpStr.c_str(), ty);
-  ASSERT(s && *s == '\0');
-  mTyMap.emplace(texpStr, ty);
-  return ty;
-}
-
-//==============================================================================
-// 表达式
-//==============================================================================
+namespace {
 
-Expr*
-Json2Asg::expr(const llvm::json::Object& jobj)
+/// \p s 指向字符串开头的引号，返回闭合引号之后的位置
+const char*
+skip_string(const char* s)
 {
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
-
-  Expr* ret;
-
-  if (kind == "IntegerLiteral")
-    ret = integer_literal(jobj);
-
-  else if (kind == "BinaryOperator")
-    ret = binary_expr(jobj);
-
-  else if (kind == "UnaryOperator")
-    ret = unary_expr(jobj);
-
-  else if (kind == "DeclRefExpr")
-    ret = decl_ref_expr(jobj);
-
-  else if (kind == "ImplicitCastExpr")
-    ret = implicit_cast_expr(jobj);
-
-  else if (kind == "ParenExpr")
-    ret = paren_expr(jobj);
-
-  else if (kind == "InitListExpr")
-    ret = init_list_expr(jobj);
-
-  else if (kind == "ImplicitValueInitExpr")
-    ret = implicit_init_expr(jobj);
-
-  else if (kind == "ArraySubscriptExpr")
-    ret = binary_expr(jobj);
-
-  else if (kind == "CallExpr")
-    ret = call_expr(jobj);
-
-  else
-    ABORT();
-
-  auto cateVal = jobj.get("valueCategory");
-  ASSERT(cateVal);
-  auto cate = cateVal->getAsString();
-  ASSERT(cate);
-  if (cate == "lvalue")
-    ret->cate = Expr::Cate::kLValue;
-  else if (cate == "prvalue")
-    ret->cate = Expr::Cate::kRValue;
-  else
-    ABORT();
-
-  return ret;
+  for (++s; *s != '"'; ++s) {
+    ASSERT(*s != '\0');
+    if (*s == '\\')
+      ++s;
+  }
+  return s + 1;
+}
+
+unsigned
+parse_hex4(const char* s)
+{
+  unsigned v = 0;
+  for (int i = 0; i < 4; ++i) {
+    char c = s[i];
+    v <<= 4;
+    if ('0' <= c && c <= '9')
+      v |= c - '0';
+    else if ('a' <= c && c <= 'f')
+      v |= c - 'a' + 10;
+    else if ('A' <= c && c <= 'F')
+      v |= c - 'A' + 10;
+    else
+      ABORT();
+  }
+  return v;
 }
 
-IntegerLiteral*
-Json2Asg::integer_literal(const llvm::json::Object& jobj)
+void
+append_utf8(std::string& str, unsigned cp)
 {
-  auto integerLiteral = make<IntegerLiteral>();
-
-  integerLiteral->type = getty(jobj);
-
-  auto value = jobj.getString("value");
-  ASSERT(value);
-
-  integerLiteral->val = std::stoull(value->str());
-
-  return integerLiteral;
+  if (cp < 0x80)
+    str.push_back(cp);
+  else if (cp < 0x800) {
+    str.push_back(0xC0 | (cp >> 6));
+    str.push_back(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    str.push_back(0xE0 | (cp >> 12));
+    str.push_back(0x80 | ((cp >> 6) & 0x3F));
+    str.push_back(0x80 | (cp & 0x3F));
+  } else {
+    str.push_back(0xF0 | (cp >> 18));
+    str.push_back(0x80 | ((cp >> 12) & 0x3F));
+    str.push_back(0x80 | ((cp >> 6) & 0x3F));
+    str.push_back(0x80 | (cp & 0x3F));
+  }
 }
 
-DeclRefExpr*
-Json2Asg::decl_ref_expr(const llvm::json::Object& jobj)
+/// 解析形如 "0x55d0a0000000" 的结点编号
+std::size_t
+parse_id(llvm::StringRef str)
 {
-  auto declRefExpr = make<DeclRefExpr>();
-
-  declRefExpr->type = getty(jobj);
+  std::size_t id;
+  bool bad = !str.consume_front("0x") || str.getAsInteger(16, id);
+  ASSERT(!bad);
+  return id;
+}
 
-  auto ref = jobj.getObject("referencedDecl");
-  ASSERT(ref);
-  std::size_t id = jobj_id(*ref);
-  auto refObj = mIdMap[id]->dcst<Decl>();
-  ASSERT(refObj);
-  declRefExpr->decl = refObj;
+} // namespace
 
-  return declRefExpr;
+void
+Json2Asg::skip_blank()
+{
+  while (*mCur == ' ' || *mCur == '\n' || *mCur == '\t' || *mCur == '\r')
+    ++mCur;
 }
 
-ParenExpr*
-Json2Asg::paren_expr(const llvm::json::Object& jobj)
+void
+Json2Asg::expect(char c)
 {
-  auto parenExpr = make<ParenExpr>();
-
-  parenExpr->type = getty(jobj);
-
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  parenExpr->sub = expr(*inner->front().getAsObject());
-  return parenExpr;
+  skip_blank();
+  ASSERT(*mCur == c);
+  ++mCur;
 }
 
-UnaryExpr*
-Json2Asg::unary_expr(const llvm::json::Object& jobj)
+llvm::StringRef
+Json2Asg::string()
 {
-  auto unaryExpr = make<UnaryExpr>();
-
-  unaryExpr->type = getty(jobj);
-
-  auto opCode = jobj.getString("opcode");
-  ASSERT(opCode);
-  if (opCode == "-") {
-    unaryExpr->op = UnaryExpr::Op::kNeg;
-  } else if (opCode == "!") {
-    unaryExpr->op = UnaryExpr::Op::kNot;
-  } else if (opCode == "+") {
-    unaryExpr->op = UnaryExpr::Op::kPos;
-  } else {
-    ABORT();
+  expect('"');
+  auto begin = mCur;
+  while (*mCur != '"' && *mCur != '\\') {
+    ASSERT(*mCur != '\0');
+    ++mCur;
   }
+  if (*mCur == '"')
+    return { begin, std::size_t(mCur++ - begin) };
+
+  // 含转义，只有这时才复制
+  auto& str = mUnescaped.emplace_back(begin, mCur);
+  while (*mCur != '"') {
+    ASSERT(*mCur != '\0');
+    if (*mCur != '\\') {
+      str.push_back(*mCur++);
+      continue;
+    }
 
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  unaryExpr->sub = expr(*(inner->front().getAsObject()));
-
-  return unaryExpr;
-}
-
-BinaryExpr*
-Json2Asg::binary_expr(const llvm::json::Object& jobj)
-{
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
-
-  auto binaryExpr = make<BinaryExpr>();
-  binaryExpr->type = getty(jobj);
-
-  if (kind == "ArraySubscriptExpr")
-    binaryExpr->op = BinaryExpr::Op::kIndex;
-  else {
-    auto opCode = jobj.getString("opcode");
-    ASSERT(opCode);
-
-    if (opCode == "*")
-      binaryExpr->op = BinaryExpr::Op::kMul;
-    else if (opCode == "/")
-      binaryExpr->op = BinaryExpr::Op::kDiv;
-    else if (opCode == "%")
-      binaryExpr->op = BinaryExpr::Op::kMod;
-    else if (opCode == "+")
-      binaryExpr->op = BinaryExpr::Op::kAdd;
-    else if (opCode == "-")
-      binaryExpr->op = BinaryExpr::Op::kSub;
-    else if (opCode == ">")
-      binaryExpr->op = BinaryExpr::Op::kGt;
-    else if (opCode == "<")
-      binaryExpr->op = BinaryExpr::Op::kLt;
-    else if (opCode == ">=")
-      binaryExpr->op = BinaryExpr::Op::kGe;
-    else if (opCode == "<=")
-      binaryExpr->op = BinaryExpr::Op::kLe;
-    else if (opCode == "==")
-      binaryExpr->op = BinaryExpr::Op::kEq;
-    else if (opCode == "!=")
-      binaryExpr->op = BinaryExpr::Op::kNe;
-    else if (opCode == "&&")
-      binaryExpr->op = BinaryExpr::Op::kAnd;
-    else if (opCode == "||")
-      binaryExpr->op = BinaryExpr::Op::kOr;
-    else if (opCode == "=")
-      binaryExpr->op = BinaryExpr::Op::kAssign;
-    else {
-      ABORT();
+    ++mCur;
+    switch (*mCur++) {
+      case '"':
+        str.push_back('"');
+        break;
+      case '\\':
+        str.push_back('\\');
+        break;
+      case '/':
+        str.push_back('/');
+        break;
+      case 'b':
+        str.push_back('\b');
+        break;
+      case 'f':
+        str.push_back('\f');
+        break;
+      case 'n':
+        str.push_back('\n');
+        break;
+      case 'r':
+        str.push_back('\r');
+        break;
+      case 't':
+        str.push_back('\t');
+        break;
+      case 'u': {
+        auto cp = parse_hex4(mCur);
+        mCur += 4;
+        // 代理对
+        if (0xD800 <= cp && cp < 0xDC00 && mCur[0] == '\\' && mCur[1] == 'u') {
+          auto lo = parse_hex4(mCur + 2);
+          ASSERT(0xDC00 <= lo && lo < 0xE000);
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+          mCur += 6;
+        }
+        append_utf8(str, cp);
+      } break;
+      default:
+        ABORT();
     }
   }
+  ++mCur;
 
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  binaryExpr->lft = expr(*inner->front().getAsObject());
-  binaryExpr->rht = expr(*(*inner)[1].getAsObject());
-
-  return binaryExpr;
+  return str;
 }
 
-CallExpr*
-Json2Asg::call_expr(const llvm::json::Object& jobj)
+bool
+Json2Asg::boolean()
 {
-  auto callExpr = make<CallExpr>();
-  callExpr->type = getty(jobj);
-
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  callExpr->head = expr(*inner->front().getAsObject());
-
-  for (std::uint32_t i = 1; i < inner->size(); ++i) {
-    callExpr->args.push_back(expr(*(*inner)[i].getAsObject()));
+  skip_blank();
+  if (llvm::StringRef(mCur, 4) == "true") {
+    mCur += 4;
+    return true;
   }
+  ASSERT(llvm::StringRef(mCur, 5) == "false");
+  mCur += 5;
+  return false;
+}
+
+void
+Json2Asg::skip_value()
+{
+  skip_blank();
+  switch (*mCur) {
+    case '"':
+      mCur = skip_string(mCur);
+      return;
+
+    case '{':
+    case '[': {
+      // 不关心内容，只数括号
+      int depth = 0;
+      do {
+        switch (*mCur) {
+          case '{':
+          case '[':
+            ++depth;
+            break;
+          case '}':
+          case ']':
+            --depth;
+            break;
+          case '"':
+            mCur = skip_string(mCur);
+            continue;
+          case '\0':
+            ABORT();
+        }
+        ++mCur;
+      } while (depth > 0);
+      return;
+    }
 
-  return callExpr;
+    default:
+      // 数字、true、false、null
+      while (*mCur != ',' && *mCur != '}' && *mCur != ']' && *mCur != ' ' &&
+             *mCur != '\n' && *mCur != '\t' && *mCur != '\r') {
+        ASSERT(*mCur != '\0');
+        ++mCur;
+      }
+  }
 }
 
-InitListExpr*
-Json2Asg::init_list_expr(const llvm::json::Object& jobj)
+template<typename F>
+void
+Json2Asg::each_key(F&& f)
 {
-  auto initListExpr = make<InitListExpr>();
-
-  initListExpr->type = getty(jobj);
-
-  auto initList = jobj.getArray("inner");
-  if (!initList) {
-    initList = jobj.getArray("array_filler");
+  expect('{');
+  skip_blank();
+  if (*mCur == '}') {
+    ++mCur;
+    return;
   }
-  ASSERT(initList);
-
-  for (auto& value : *initList) {
-    auto object = value.getAsObject();
-    ASSERT(object);
 
-    if (auto pExpr = expr(*object))
-      initListExpr->list.push_back(pExpr);
+  while (true) {
+    auto key = string();
+    expect(':');
+    f(key);
+    skip_blank();
+    if (*mCur != ',')
+      break;
+    ++mCur;
   }
-
-  return initListExpr;
+  expect('}');
 }
 
-ImplicitInitExpr*
-Json2Asg::implicit_init_expr(const llvm::json::Object& jobj)
+template<typename F>
+void
+Json2Asg::each_elem(F&& f)
 {
-  auto implicitInitExpr = make<ImplicitInitExpr>();
-  implicitInitExpr->type = getty(jobj);
-  return implicitInitExpr;
-}
-
-ImplicitCastExpr*
-Json2Asg::implicit_cast_expr(const llvm::json::Object& jobj)
-{
-  auto implicitCastExpr = make<ImplicitCastExpr>();
-  implicitCastExpr->type = getty(jobj);
-
-  auto castKind = jobj.getString("castKind");
-  ASSERT(castKind);
-
-  if (castKind == "LValueToRValue")
-    implicitCastExpr->kind = ImplicitCastExpr::kLValueToRValue;
-  else if (castKind == "ArrayToPointerDecay")
-    implicitCastExpr->kind = ImplicitCastExpr::kArrayToPointerDecay;
-  else if (castKind == "FunctionToPointerDecay")
-    implicitCastExpr->kind = ImplicitCastExpr::kFunctionToPointerDecay;
-  else
-    ABORT();
-
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  implicitCastExpr->sub = expr(*inner->front().getAsObject());
+  expect('[');
+  skip_blank();
+  if (*mCur == ']') {
+    ++mCur;
+    return;
+  }
 
-  return implicitCastExpr;
+  while (true) {
+    f();
+    skip_blank();
+    if (*mCur != ',')
+      break;
+    ++mCur;
+  }
+  expect(']');
 }
 
 //==============================================================================
-// 声明
+// 结点
 //==============================================================================
 
-Decl*
-Json2Asg::decl(const llvm::json::Object& jobj)
-{
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
-
-  if (kind == "VarDecl")
-    return var_decl(jobj);
-
-  if (kind == "FunctionDecl")
-    return function_decl(jobj);
-
-  if (kind == "ParmVarDecl")
-    return var_decl(jobj);
-
-  if (kind == "TypedefDecl")
-    return nullptr;
-
-  ABORT();
-}
-
-VarDecl*
-Json2Asg::var_decl(const llvm::json::Object& jobj)
-{
-  auto varDecl = make<VarDecl>(jobj_id(jobj));
+Json2Asg::Child
+Json2Asg::node()
+{
+  // 子树读完后恢复，嵌套的循环和函数不会影响外层
+  auto curFunc = mCurFunc;
+  auto curLoop = mCurLoop;
+
+  Attrs a;
+  Obj* obj = nullptr;
+  bool created = false, hasInner = false;
+  Children inner, filler;
+
+  each_key([&](llvm::StringRef key) {
+    if (key == "kind") {
+      a.kind = string();
+      a.tag = llvm::StringSwitch<Kind>(a.kind)
+                .Case("IntegerLiteral", Kind::kIntegerLiteral)
+                .Case("DeclRefExpr", Kind::kDeclRefExpr)
+                .Case("ParenExpr", Kind::kParenExpr)
+                .Case("UnaryOperator", Kind::kUnaryExpr)
+                .Case("BinaryOperator", Kind::kBinaryExpr)
+                .Case("ArraySubscriptExpr", Kind::kBinaryExpr)
+                .Case("CallExpr", Kind::kCallExpr)
+                .Case("InitListExpr", Kind::kInitListExpr)
+                .Case("ImplicitValueInitExpr", Kind::kImplicitInitExpr)
+                .Case("ImplicitCastExpr", Kind::kImplicitCastExpr)
+                .Case("NullStmt", Kind::kNullStmt)
+                .Case("DeclStmt", Kind::kDeclStmt)
+                .Case("CompoundStmt", Kind::kCompoundStmt)
+                .Case("IfStmt", Kind::kIfStmt)
+                .Case("WhileStmt", Kind::kWhileStmt)
+                .Case("BreakStmt", Kind::kBreakStmt)
+                .Case("ContinueStmt", Kind::kContinueStmt)
+                .Case("ReturnStmt", Kind::kReturnStmt)
+                .Case("VarDecl", Kind::kVarDecl)
+                .Case("ParmVarDecl", Kind::kVarDecl)
+                .Case("FunctionDecl", Kind::kFunctionDecl)
+                .Default(Kind::kINVALID);
+      ASSERT(a.tag != Kind::kINVALID || a.kind == "TypedefDecl");
+    }
 
-  auto name = jobj.getString("name");
-  ASSERT(name);
-  varDecl->name = name->str();
+    else if (key == "id")
+      a.id = parse_id(string());
+
+    else if (key == "name")
+      a.name = string();
+
+    else if (key == "type")
+      each_key([&](llvm::StringRef key) {
+        if (key == "qualType")
+          a.qualType = string();
+        else
+          skip_value();
+      });
+
+    else if (key == "valueCategory")
+      a.valueCategory = string();
+
+    else if (key == "opcode")
+      a.opcode = string();
+
+    else if (key == "castKind")
+      a.castKind = string();
+
+    else if (key == "value")
+      a.value = string();
+
+    else if (key == "isImplicit")
+      a.isImplicit = boolean();
+
+    else if (key == "referencedDecl")
+      each_key([&](llvm::StringRef key) {
+        if (key == "id")
+          a.refId = parse_id(string());
+        else
+          skip_value();
+      });
+
+    else if (key == "inner" || key == "array_filler") {
+      if (!created) {
+        obj = create(a);
+        created = true;
+      }
+      // 不需要的结点，整棵子树直接跳过
+      if (obj == nullptr) {
+        skip_value();
+        return;
+      }
+
+      auto& list = key == "inner" ? inner : filler;
+      hasInner |= key == "inner";
+      each_elem([&] {
+        auto c = node();
+        if (c.obj != nullptr)
+          list.push_back(c);
+      });
+    }
 
-  varDecl->type = getty(jobj);
+    else
+      skip_value();
+  });
 
-  auto inner = jobj.getArray("inner");
-  if (inner)
-    varDecl->init = expr(*inner->front().getAsObject());
-  else
-    varDecl->init = nullptr;
+  if (!created)
+    obj = create(a);
+  if (obj != nullptr)
+    finish(obj, a, hasInner ? inner : filler);
 
-  return varDecl;
+  mCurFunc = curFunc;
+  mCurLoop = curLoop;
+  return { obj, a.tag };
 }
 
-FunctionDecl*
-Json2Asg::function_decl(const llvm::json::Object& jobj)
+Obj*
+Json2Asg::create(const Attrs& a)
 {
-  if (jobj.getBoolean("isImplicit") && jobj.getBoolean("isImplicit") == true)
-    return nullptr;
-
-  auto funcDecl = make<FunctionDecl>(jobj_id(jobj));
-
-  auto name = jobj.getString("name");
-  funcDecl->name = name->str();
-
-  funcDecl->type = getty(jobj);
+  // clang 总是先输出 kind、id 等键，再输出 inner
+  ASSERT(!a.kind.empty());
 
-  auto inner = jobj.getArray("inner");
-  if (!inner) {
-    funcDecl->body = nullptr;
-    return funcDecl;
-  }
-
-  mCurFunc = funcDecl;
-  for (auto& value : *inner) {
-    auto object = value.getAsObject();
-    ASSERT(object);
-
-    auto kind = object->getString("kind");
-    ASSERT(kind);
-
-    if (kind == "ParmVarDecl") {
-      funcDecl->params.push_back(decl(*object));
-      continue;
-    }
+  switch (a.tag) {
+    case Kind::kINVALID:
+      return nullptr;
 
-    if (kind == "CompoundStmt") {
-      ASSERT(funcDecl->body == nullptr);
-      funcDecl->body = compound_stmt(*object);
-      continue;
-    }
-    ABORT();
-  }
+    case Kind::kIntegerLiteral:
+      return make<IntegerLiteral>();
 
-  return funcDecl;
-}
+    case Kind::kDeclRefExpr:
+      return make<DeclRefExpr>();
 
-//==============================================================================
-// 语句
-//==============================================================================
+    case Kind::kParenExpr:
+      return make<ParenExpr>();
 
-Stmt*
-Json2Asg::stmt(const llvm::json::Object& jobj)
-{
-  auto kind = jobj.getString("kind");
-  ASSERT(kind);
+    case Kind::kUnaryExpr:
+      return make<UnaryExpr>();
 
-  if (kind == "DeclStmt")
-    return decl_stmt(jobj);
+    case Kind::kBinaryExpr:
+      return make<BinaryExpr>();
 
-  if (kind == "ReturnStmt")
-    return return_stmt(jobj);
+    case Kind::kCallExpr:
+      return make<CallExpr>();
 
-  if (kind == "BinaryOperator")
-    return expr_stmt(jobj);
+    case Kind::kInitListExpr:
+      return make<InitListExpr>();
 
-  if (kind == "UnaryOperator")
-    return expr_stmt(jobj);
+    case Kind::kImplicitInitExpr:
+      return make<ImplicitInitExpr>();
 
-  if (kind == "CallExpr")
-    return expr_stmt(jobj);
+    case Kind::kImplicitCastExpr:
+      return make<ImplicitCastExpr>();
 
-  if (kind == "IfStmt")
-    return if_stmt(jobj);
+    case Kind::kNullStmt:
+      return make<NullStmt>();
 
-  if (kind == "WhileStmt")
-    return while_stmt(jobj);
+    case Kind::kDeclStmt:
+      return make<DeclStmt>();
 
-  if (kind == "NullStmt")
-    return null_stmt(jobj);
+    case Kind::kCompoundStmt:
+      return make<CompoundStmt>();
 
-  if (kind == "CompoundStmt")
-    return compound_stmt(jobj);
+    case Kind::kIfStmt:
+      return make<IfStmt>();
 
-  if (kind == "ContinueStmt")
-    return continue_stmt(jobj);
+    case Kind::kWhileStmt: {
+      auto p = make<WhileStmt>();
+      mCurLoop = p;
+      return p;
+    }
 
-  if (kind == "BreakStmt")
-    return break_stmt(jobj);
+    case Kind::kBreakStmt: {
+      auto p = make<BreakStmt>();
+      p->loop = mCurLoop;
+      return p;
+    }
 
-  ABORT();
-}
+    case Kind::kContinueStmt: {
+      auto p = make<ContinueStmt>();
+      p->loop = mCurLoop;
+      return p;
+    }
 
-CompoundStmt*
-Json2Asg::compound_stmt(const llvm::json::Object& jobj)
-{
-  auto compoundStmt = make<CompoundStmt>();
+    case Kind::kReturnStmt: {
+      auto p = make<ReturnStmt>();
+      p->func = mCurFunc;
+      return p;
+    }
 
-  auto inner = jobj.getArray("inner");
-  if (!inner)
-    return compoundStmt;
+    case Kind::kVarDecl:
+      ASSERT(a.id != 0);
+      return make<VarDecl>(a.id);
 
-  for (auto& value : *inner) {
-    auto object = value.getAsObject();
-    ASSERT(object);
+    case Kind::kFunctionDecl: {
+      if (a.isImplicit)
+        return nullptr;
+      ASSERT(a.id != 0);
+      auto p = make<FunctionDecl>(a.id);
+      mCurFunc = p;
+      return p;
+    }
 
-    compoundStmt->subs.push_back(stmt(*object));
+    default:
+      ABORT();
   }
-  return compoundStmt;
 }
 
-DeclStmt*
-Json2Asg::decl_stmt(const llvm::json::Object& jobj)
+void
+Json2Asg::finish(Obj* obj, const Attrs& a, Children& inner)
 {
-  auto declStmt = make<DeclStmt>();
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  for (auto& value : *inner) {
-    auto object = value.getAsObject();
-    ASSERT(object);
-    if (auto pDecl = decl(*object))
-      declStmt->decls.push_back(pDecl);
+  if (Kind::kIntegerLiteral <= a.tag && a.tag <= Kind::kImplicitCastExpr) {
+    auto p = obj->scst<Expr>();
+    p->type = getty(a.qualType);
+    if (a.valueCategory == "lvalue")
+      p->cate = Expr::Cate::kLValue;
+    else if (a.valueCategory == "prvalue")
+      p->cate = Expr::Cate::kRValue;
+    else
+      ABORT();
   }
 
-  return declStmt;
-}
+  switch (a.tag) {
+    case Kind::kIntegerLiteral: {
+      auto p = obj->scst<IntegerLiteral>();
+      bool bad = a.value.getAsInteger(10, p->val);
+      ASSERT(!bad);
+    } break;
+
+    case Kind::kDeclRefExpr: {
+      auto p = obj->scst<DeclRefExpr>();
+      ASSERT(a.refId != 0);
+      auto iter = mIdMap.find(a.refId);
+      if (iter != mIdMap.end())
+        p->decl = iter->second;
+      else
+        mPatches.emplace_back(a.refId, &p->decl);
+    } break;
+
+    case Kind::kParenExpr:
+      obj->scst<ParenExpr>()->sub = expr(inner.at(0));
+      break;
 
-ReturnStmt*
-Json2Asg::return_stmt(const llvm::json::Object& jobj)
-{
-  auto returnStmt = make<ReturnStmt>();
+    case Kind::kUnaryExpr: {
+      auto p = obj->scst<UnaryExpr>();
+      if (a.opcode == "-")
+        p->op = UnaryExpr::Op::kNeg;
+      else if (a.opcode == "!")
+        p->op = UnaryExpr::Op::kNot;
+      else if (a.opcode == "+")
+        p->op = UnaryExpr::Op::kPos;
+      else
+        ABORT();
+      p->sub = expr(inner.at(0));
+    } break;
+
+    case Kind::kBinaryExpr: {
+      auto p = obj->scst<BinaryExpr>();
+      if (a.kind == "ArraySubscriptExpr")
+        p->op = BinaryExpr::Op::kIndex;
+      else
+        p->op = llvm::StringSwitch<BinaryExpr::Op>(a.opcode)
+                  .Case("*", BinaryExpr::Op::kMul)
+                  .Case("/", BinaryExpr::Op::kDiv)
+                  .Case("%", BinaryExpr::Op::kMod)
+                  .Case("+", BinaryExpr::Op::kAdd)
+                  .Case("-", BinaryExpr::Op::kSub)
+                  .Case(">", BinaryExpr::Op::kGt)
+                  .Case("<", BinaryExpr::Op::kLt)
+                  .Case(">=", BinaryExpr::Op::kGe)
+                  .Case("<=", BinaryExpr::Op::kLe)
+                  .Case("==", BinaryExpr::Op::kEq)
+                  .Case("!=", BinaryExpr::Op::kNe)
+                  .Case("&&", BinaryExpr::Op::kAnd)
+                  .Case("||", BinaryExpr::Op::kOr)
+                  .Case("=", BinaryExpr::Op::kAssign)
+                  .Default(BinaryExpr::Op::kINVALID);
+      ASSERT(p->op != BinaryExpr::Op::kINVALID);
+      p->lft = expr(inner.at(0));
+      p->rht = expr(inner.at(1));
+    } break;
+
+    case Kind::kCallExpr: {
+      auto p = obj->scst<CallExpr>();
+      p->head = expr(inner.at(0));
+      for (std::size_t i = 1; i < inner.size(); ++i)
+        p->args.push_back(expr(inner[i]));
+    } break;
+
+    case Kind::kInitListExpr: {
+      auto p = obj->scst<InitListExpr>();
+      for (auto&& c : inner)
+        p->list.push_back(expr(c));
+    } break;
+
+    case Kind::kImplicitInitExpr:
+      break;
 
-  returnStmt->func = mCurFunc;
+    case Kind::kImplicitCastExpr: {
+      auto p = obj->scst<ImplicitCastExpr>();
+      if (a.castKind == "LValueToRValue")
+        p->kind = ImplicitCastExpr::kLValueToRValue;
+      else if (a.castKind == "ArrayToPointerDecay")
+        p->kind = ImplicitCastExpr::kArrayToPointerDecay;
+      else if (a.castKind == "FunctionToPointerDecay")
+        p->kind = ImplicitCastExpr::kFunctionToPointerDecay;
+      else
+        ABORT();
+      p->sub = expr(inner.at(0));
+    } break;
+
+    case Kind::kNullStmt:
+    case Kind::kBreakStmt:
+    case Kind::kContinueStmt:
+      break;
 
-  auto inner = jobj.getArray("inner");
-  if (inner)
-    returnStmt->expr = expr(*inner->front().getAsObject());
+    case Kind::kDeclStmt: {
+      auto p = obj->scst<DeclStmt>();
+      for (auto&& c : inner)
+        p->decls.push_back(decl(c));
+    } break;
+
+    case Kind::kCompoundStmt: {
+      auto p = obj->scst<CompoundStmt>();
+      for (auto&& c : inner)
+        p->subs.push_back(stmt(c));
+    } break;
+
+    case Kind::kIfStmt: {
+      auto p = obj->scst<IfStmt>();
+      p->cond = expr(inner.at(0));
+      p->then = stmt(inner.at(1));
+      if (inner.size() == 3)
+        p->else_ = stmt(inner[2]);
+    } break;
+
+    case Kind::kWhileStmt: {
+      auto p = obj->scst<WhileStmt>();
+      p->cond = expr(inner.at(0));
+      p->body = stmt(inner.at(1));
+    } break;
+
+    case Kind::kReturnStmt:
+      if (!inner.empty())
+        obj->scst<ReturnStmt>()->expr = expr(inner[0]);
+      break;
 
-  return returnStmt;
+    case Kind::kVarDecl: {
+      auto p = obj->scst<VarDecl>();
+      p->name = Symbol({ a.name.data(), a.name.size() });
+      p->type = getty(a.qualType);
+      p->init = inner.empty() ? nullptr : expr(inner[0]);
+    } break;
+
+    case Kind::kFunctionDecl: {
+      auto p = obj->scst<FunctionDecl>();
+      p->name = Symbol({ a.name.data(), a.name.size() });
+      p->type = getty(a.qualType);
+      for (auto&& c : inner) {
+        if (c.tag == Kind::kVarDecl)
+          p->params.push_back(decl(c));
+        else if (c.tag == Kind::kCompoundStmt) {
+          ASSERT(p->body == nullptr);
+          p->body = c.obj->scst<CompoundStmt>();
+        } else
+          ABORT();
+      }
+    } break;
+
+    default:
+      ABORT();
+  }
 }
 
-IfStmt*
-Json2Asg::if_stmt(const llvm::json::Object& jobj)
+Expr*
+Json2Asg::expr(const Child& c)
 {
-  auto ifStmt = make<IfStmt>();
-
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  ifStmt->cond = expr(*(inner->front().getAsObject()));
-  ifStmt->then = stmt(*((*inner)[1].getAsObject()));
-  if (inner->size() == 3)
-    ifStmt->else_ = stmt(*((*inner)[2].getAsObject()));
-
-  return ifStmt;
+  ASSERT(Kind::kIntegerLiteral <= c.tag && c.tag <= Kind::kImplicitCastExpr);
+  return c.obj->scst<Expr>();
 }
 
-WhileStmt*
-Json2Asg::while_stmt(const llvm::json::Object& jobj)
+Stmt*
+Json2Asg::stmt(const Child& c)
 {
-  auto whileStmt = make<WhileStmt>();
-  mCurLoop = whileStmt;
-
-  auto inner = jobj.getArray("inner");
-  ASSERT(inner);
-
-  whileStmt->cond = expr(*(inner->front().getAsObject()));
-  whileStmt->body = stmt(*((*inner)[1].getAsObject()));
-
-  return whileStmt;
+  // 出现在语句位置的表达式包一层 ExprStmt
+  if (Kind::kIntegerLiteral <= c.tag && c.tag <= Kind::kImplicitCastExpr) {
+    auto p = make<ExprStmt>();
+    p->expr = c.obj->scst<Expr>();
+    return p;
+  }
+  ASSERT(Kind::kNullStmt <= c.tag && c.tag <= Kind::kReturnStmt);
+  return c.obj->scst<Stmt>();
 }
 
-NullStmt*
-Json2Asg::null_stmt(const llvm::json::Object& jobj)
+Decl*
+Json2Asg::decl(const Child& c)
 {
-  return make<NullStmt>();
+  ASSERT(c.tag == Kind::kVarDecl || c.tag == Kind::kFunctionDecl);
+  return c.obj->scst<Decl>();
 }
 
-BreakStmt*
-Json2Asg::break_stmt(const llvm::json::Object& jobj)
-{
-  auto ret = make<BreakStmt>();
-  ret->loop = mCurLoop;
-  return ret;
-}
+//==============================================================================
+// 类型
+//==============================================================================
 
-ContinueStmt*
-Json2Asg::continue_stmt(const llvm::json::Object& jobj)
+const Type*
+Json2Asg::getty(llvm::StringRef qualType)
 {
-  auto ret = make<ContinueStmt>();
-  ret->loop = mCurLoop;
-  return ret;
-}
+  auto iter = mTyMap.find(qualType);
+  if (iter != mTyMap.end())
+    return iter->second;
 
-ExprStmt*
-Json2Asg::expr_stmt(const llvm::json::Object& jobj)
-{
-  auto exprStmt = make<ExprStmt>();
-  exprStmt->expr = expr(jobj);
-  return exprStmt;
+  auto texpStr = qualType.str();
+  const Type* ty;
+  auto s = parse_type(texpStr.c_str(), ty);
+  ASSERT(s && *s == '\0');
+  // 不同的写法可能表示同一个类型，统一换成规范类型
+  ty = mTypeCache(ty->spec, ty->qual, ty->texp);
+  mTyMap.try_emplace(qualType, ty);
+  return ty;
 }
 
 // ========================================================================== //
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "asg.hpp"
-#include <any>
-#include <llvm/Support/JSON.h>
-#include <regex>
+#include <deque>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
 #include <unordered_map>
 
+/**
+ * @brief 从 clang 输出的 JSON 语法树构建抽象语义图
+ *
+ * 不先构造 json::Value 的 DOM，而是直接在输入文本上边扫描边建结点：每个 JSON
+ * 对象只取出用得到的键，loc、range 等其余的值原样跳过；字符串不含转义时直接
+ * 引用输入缓冲区，不复制。
+ */
 class Json2Asg
 {
 public:
@@ -13,14 +20,20 @@ public:
 
   Json2Asg(Obj::Mgr& mgr)
     : mMgr(mgr)
+    , mTypeCache(mgr)
   {
   }
 
-  asg::TranslationUnit* operator()(const llvm::json::Value& jval);
+  /// \p text 在构建期间须保持有效，且以 '\0' 结尾（MemoryBuffer 默认如此）
+  asg::TranslationUnit* operator()(llvm::StringRef text);
 
 private:
-  std::unordered_map<std::size_t, Obj*> mIdMap;
-  std::unordered_map<std::string, const asg::Type*> mTyMap;
+  std::unordered_map<std::size_t, asg::Decl*> mIdMap;
+  llvm::StringMap<const asg::Type*> mTyMap;
+  asg::Type::Cache mTypeCache;
+
+  /// 引用出现在被引用的声明之前时，先记下来，整个翻译单元读完后再回填
+  std::vector<std::pair<std::size_t, asg::Decl**>> mPatches;
 
   /**
    * 在遍历函数体时指向当前的函数声明，从而给函数体内返回语句的 ReturnStmt
@@ -50,68 +63,77 @@ private:
   }
 
   //============================================================================
-  // 类型
+  // JSON 扫描
   //============================================================================
 
-  const asg::Type* getty(const llvm::json::Object& jobj);
-
-  //============================================================================
-  // 表达式
-  //============================================================================
-
-  asg::Expr* expr(const llvm::json::Object& jobj);
-
-  asg::IntegerLiteral* integer_literal(const llvm::json::Object& jobj);
+  const char* mCur{ nullptr };
 
-  asg::DeclRefExpr* decl_ref_expr(const llvm::json::Object& jobj);
+  /// 含转义的字符串解码后存放在这里，保证返回的 StringRef 一直有效
+  std::deque<std::string> mUnescaped;
 
-  asg::ParenExpr* paren_expr(const llvm::json::Object& jobj);
+  void skip_blank();
 
-  asg::UnaryExpr* unary_expr(const llvm::json::Object& jobj);
+  void expect(char c);
 
-  asg::BinaryExpr* binary_expr(const llvm::json::Object& jobj);
+  /// 读一个字符串，返回的内容不含两侧引号
+  llvm::StringRef string();
 
-  asg::CallExpr* call_expr(const llvm::json::Object& jobj);
+  bool boolean();
 
-  asg::InitListExpr* init_list_expr(const llvm::json::Object& jobj);
+  /// 跳过任意一个值，不构造任何东西
+  void skip_value();
 
-  asg::ImplicitInitExpr* implicit_init_expr(const llvm::json::Object& jobj);
+  /// 逐个读取对象的键，对每个键调用 \p f(key)，由 \p f 负责读取或跳过值
+  template<typename F>
+  void each_key(F&& f);
 
-  asg::ImplicitCastExpr* implicit_cast_expr(const llvm::json::Object& jobj);
+  /// 逐个读取数组的元素，对每个元素调用 \p f()
+  template<typename F>
+  void each_elem(F&& f);
 
   //============================================================================
-  // 语句
+  // 结点
   //============================================================================
 
-  asg::Stmt* stmt(const llvm::json::Object& jobj);
-
-  asg::CompoundStmt* compound_stmt(const llvm::json::Object& jobj);
-
-  asg::NullStmt* null_stmt(const llvm::json::Object& jobj);
+  /// 一个结点对象里用得到的键，字符串都指向输入缓冲区
+  struct Attrs
+  {
+    asg::Kind tag{ asg::Kind::kINVALID }; ///< 由 kind 换算，不认识的种类为 kINVALID
+    llvm::StringRef kind, name, qualType, valueCategory, opcode, castKind,
+      value;
+    std::size_t id{ 0 }, refId{ 0 };
+    bool isImplicit{ false };
+  };
+
+  /// 读出的子结点，附带种类以便父结点区分表达式、语句和声明
+  struct Child
+  {
+    Obj* obj;
+    asg::Kind tag;
+  };
 
-  asg::DeclStmt* decl_stmt(const llvm::json::Object& jobj);
+  using Children = std::vector<Child>;
 
-  asg::ExprStmt* expr_stmt(const llvm::json::Object& jobj);
+  /// 读一个结点对象，不需要的结点（如隐式的 TypedefDecl）返回空
+  Child node();
 
-  asg::IfStmt* if_stmt(const llvm::json::Object& jobj);
+  /// 读完 inner 之前的键后创建结点，这样子结点能引用到它
+  Obj* create(const Attrs& a);
 
-  asg::WhileStmt* while_stmt(const llvm::json::Object& jobj);
+  /// 读完整个对象后填写结点的其余字段
+  void finish(Obj* obj, const Attrs& a, Children& inner);
 
-  asg::BreakStmt* break_stmt(const llvm::json::Object& jobj);
+  static asg::Expr* expr(const Child& c);
 
-  asg::ContinueStmt* continue_stmt(const llvm::json::Object& jobj);
+  asg::Stmt* stmt(const Child& c);
 
-  asg::ReturnStmt* return_stmt(const llvm::json::Object& jobj);
+  static asg::Decl* decl(const Child& c);
 
   //============================================================================
-  // 声明
+  // 类型
   //============================================================================
 
-  asg::Decl* decl(const llvm::json::Object& jobj);
-
-  asg::VarDecl* var_decl(const llvm::json::Object& jobj);
-
-  asg::FunctionDecl* function_decl(const llvm::json::Object& jobj);
+  const asg::Type* getty(llvm::StringRef qualType);
 
 private:
   /**
@@ -3,18 +3,33 @@
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+/// ASSERT 和 ABORT 抛出的致命错误，内容是出错的文件和行号。单个文件时没有人
+/// 捕获，进程照样中止；批量模式下只让当前文件失败，见 Manifest.hpp。
+struct Fatal : std::runtime_error
+{
+  Fatal(const char* file, int line)
+    : std::runtime_error(std::string(file) + ':' + std::to_string(line))
+  {
+  }
+};
+
 /// 错误断言，打印文件和行号，方便定位问题。
 #define ASSERT(expr)                                                           \
   ((expr) || (fprintf(stderr, "asserted at %s:%d\n", __FILE__, __LINE__),      \
-              abort(),                                                         \
+              (throw Fatal(__FILE__, __LINE__)),                               \
               false))
 
 /// 错误中断，打印文件和行号，方便定位问题。
 #define ABORT()                                                                \
-  (fprintf(stderr, "aborted at %s:%d\n", __FILE__, __LINE__), abort())
+  (fprintf(stderr, "aborted at %s:%d\n", __FILE__, __LINE__),                  \
+   (throw Fatal(__FILE__, __LINE__)))
 
 /// 对象系统基类
 struct alignas(ptrdiff_t) Obj
@@ -90,54 +105,284 @@ private:
 
   Obj* __next__{ nullptr }; /// 环形指针，低3位由于对齐要求必为0，用作标记
 
+  /// 读写环形指针的原始位。经由值转换而不是 uintptr_t& 引用，以免违反严格
+  /// 别名规则导致优化后的读写乱序。
+  uintptr_t __bits__() const { return reinterpret_cast<uintptr_t>(__next__); }
+  void __bits__(uintptr_t bits) { __next__ = reinterpret_cast<Obj*>(bits); }
+
   virtual void __mark__(Mark mark) = 0; /// 标记对象
 };
 
 /// 对象管理器
 struct Obj::Mgr : Obj
 {
-  Mgr()
-    : Obj(this)
-  {
-  }
+  /// 内存池模式下能够分配的最大对象尺寸
+  static constexpr std::size_t kArenaMaxSize = 256;
+
+  /**
+   * @param arena 是否启用内存池模式。启用后对象从按尺寸分级的大块内存中顺序
+   * 分配，被回收的对象进入同级的空闲链表以供复用，管理器析构时整块释放内存，
+   * 从而避免为每个语义结点单独调用一次 new 和 delete。
+   */
+  explicit Mgr(bool arena = false);
 
+  ~Mgr() override;
+
+  /// 新建对象并挂到环上。内存池模式下构造函数抛出异常时，槽位还回空闲链表
   template<typename T,
            typename... Args,
            typename = std::enable_if_t<std::is_convertible_v<T*, Obj*>>>
-  T* make(Args... args)
-  {
-    auto obj = new T(args...);
-    obj->__next__ = __next__, __next__ = obj;
-    return obj;
-  }
+  T* make(Args... args);
 
   Obj* mRoot{ nullptr }; /// 根对象
 
-  /// 垃圾回收，使用标记-清扫算法
-  /// @warning 垃圾回收时调用栈上不能有对象的引用！
-  void gc();
+  /// 是否启用了内存池模式
+  bool arena() const { return mArena != nullptr; }
+
+  /**
+   * @brief 接管 \p other 的全部对象，之后 \p other 为空
+   *
+   * 各线程在自己的管理器上分配，互不加锁，做完之后再并回主管理器。接管来的
+   * 对象插在环的开头，算作新对象，可以随后由 gc_young 回收，\p other 的记忆集
+   * 也一并并入。内存池模式下连同大块一起接管，\p other 空闲链表里的槽位和
+   * 大块里没用完的部分不再复用，到本管理器析构时一并释放。两个管理器的模式
+   * 必须相同。
+   */
+  void adopt(Mgr& other);
+
+  /// 一次垃圾回收的统计数据
+  struct Stats
+  {
+    std::size_t mAllocated{ 0 }; /// 上次回收以来新分配的对象数
+    std::size_t mTraced{ 0 };    /// 标记阶段遍历的对象数
+    std::size_t mFreed{ 0 };     /// 本次释放的对象数
+    std::size_t mLive{ 0 };      /// 回收后仍存活的对象总数
+
+    /// 以一行文本打印到标准输出，\p phase 为对应的阶段名
+    void print(const char* phase) const;
+  };
+
+  /**
+   * @brief 全量垃圾回收，使用标记-清扫算法
+   *
+   * 标记阶段使用显式的标记栈而非递归，因此调用栈深度与语义图的嵌套深度无关，
+   * 再深的表达式链也不会导致栈溢出。回收后存活的对象全部晋升为老对象。
+   *
+   * @warning 垃圾回收时调用栈上不能有对象的引用！
+   */
+  Stats gc();
+
+  /**
+   * @brief 新生代垃圾回收，只回收上次回收以来分配的对象
+   *
+   * 新对象总是插入在管理器之后，因此环上从管理器开始的一段前缀就是新生代。
+   * 除管理器本身外，只有记忆集里的老对象被视为根：只对它们做一层浅扫描以找出
+   * 指向新对象的引用，既不沿老对象递归，也不清扫。老对象中的垃圾留到下次全量
+   * 回收时处理。
+   *
+   * @warning 垃圾回收时调用栈上不能有对象的引用！
+   * @warning 两次回收之间把新对象写进老对象的字段时必须调用 write_barrier，
+   * 否则这个新对象会被当作垃圾回收。
+   */
+  Stats gc_young();
+
+  /**
+   * @brief 写屏障，把 \p value 写进 \p owner 的字段之后调用
+   *
+   * 老对象指向新对象时把老对象记入记忆集，新生代回收只需扫描记忆集而不是全部
+   * 老对象。记忆集里的老对象借用标记位表示已经记录过，每个只记一次。
+   */
+  void write_barrier(Obj* owner, const Obj* value)
+  {
+    if (value != nullptr && !gc_old(value) && gc_old(owner) &&
+        !gc_marked(owner))
+      gc_mark(owner), mRemembered.push_back(owner);
+  }
 
 private:
+  struct Arena;
+
+  std::unique_ptr<Arena> mArena; /// 内存池，为空时直接使用 new 和 delete
+
+  void* arena_alloc(std::size_t size);
+
+  std::size_t mCount{ 0 }; /// 环上的对象总数
+  std::size_t mYoung{ 0 }; /// 上次回收以来新分配的对象数
+
+  /// 记忆集，上次回收以来经由 write_barrier 写入过新对象的老对象
+  std::vector<Obj*> mRemembered;
+
+  /// 清空记忆集，去掉其中老对象借用的标记位
+  void forget();
+
+  /// 析构并释放对象，内存池模式下归还到空闲链表
+  void destroy(Obj* obj);
+
   void __mark__(Mark mark) override;
 
+  /// 取环上的下一个对象，去掉低位的标记
+  static Obj* ring_next(const Obj* obj)
+  {
+    return reinterpret_cast<Obj*>(obj->__bits__() & ~uintptr_t(0b111));
+  }
+
+  /// 将环上的下一个对象改为 \p next，保留低位的标记
+  static void ring_link(Obj* obj, Obj* next)
+  {
+    obj->__bits__(reinterpret_cast<uintptr_t>(next) |
+                  (obj->__bits__() & uintptr_t(0b111)));
+  }
+
   static bool gc_marked(const Obj* obj)
   {
-    return reinterpret_cast<uintptr_t>(obj->__next__) & uintptr_t(0b1);
+    return obj->__bits__() & uintptr_t(0b1);
   }
 
   static void gc_unmark(Obj* obj)
   {
-    reinterpret_cast<uintptr_t&>(obj->__next__) &= ~uintptr_t(0b1);
+    obj->__bits__(obj->__bits__() & ~uintptr_t(0b1));
   }
 
   static void gc_mark(Obj* obj)
   {
-    reinterpret_cast<uintptr_t&>(obj->__next__) |= uintptr_t(0b1);
+    obj->__bits__(obj->__bits__() | uintptr_t(0b1));
+  }
+
+  /// 第 2 位表示老对象，即至少经历过一次回收
+  static bool gc_old(const Obj* obj)
+  {
+    return obj->__bits__() & uintptr_t(0b100);
+  }
+
+  static void gc_promote(Obj* obj)
+  {
+    obj->__bits__(obj->__bits__() | uintptr_t(0b100));
+  }
+
+  /// 标记回调，只把对象压入标记栈，不访问对象本身
+  static void gc_mark_push(Obj* obj);
+
+  /// 标记回调，只把新对象压入标记栈，新生代回收时使用
+  static void gc_mark_push_young(Obj* obj);
+
+  /**
+   * @brief 从标记栈中的对象出发，标记所有可达对象
+   *
+   * @param push 遍历对象时使用的标记回调
+   * @return 被标记的对象数
+   */
+  std::size_t gc_mark_all(Mark push);
+
+  /**
+   * @brief 清扫未标记的对象，存活的对象晋升为老对象
+   *
+   * @param young 为真时遇到第一个老对象即停止
+   */
+  void gc_sweep(bool young, Stats& stats);
+};
+
+/**
+ * @brief 按尺寸分级的内存池
+ *
+ * 每个尺寸级别独占若干个大块（Chunk），大块按自身尺寸对齐，头部记录其中槽位
+ * 的尺寸，因此释放时只需将地址按大块尺寸取整即可找到所属级别。分配时优先复用
+ * 空闲链表中的槽位，否则在当前大块中顺序分配，大块用尽时再申请新的大块。
+ */
+struct Obj::Mgr::Arena
+{
+  static constexpr std::size_t kChunkSize = 64 * 1024; /// 大块尺寸，也是其对齐
+  static constexpr std::size_t kGrain = alignof(Obj);  /// 尺寸分级的粒度
+  static constexpr std::size_t kClasses = kArenaMaxSize / kGrain + 1;
+
+  /// 大块头部
+  struct Chunk
+  {
+    Chunk* mNext;      /// 所有大块串成的单向链表
+    std::size_t mSize; /// 槽位尺寸
+  };
+
+  /// 一个尺寸级别的分配状态
+  struct Class
+  {
+    void* mFree{ nullptr }; /// 空闲链表，链接指针存放在槽位开头
+    char* mTop{ nullptr };  /// 当前大块中下一个可分配的位置
+    char* mEnd{ nullptr };  /// 当前大块的末尾
+  };
+
+  Class mClasses[kClasses];
+  Chunk* mChunks{ nullptr };
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  void operator=(const Arena&) = delete;
+
+  /// 逐块释放全部内存，不会调用对象的析构函数
+  ~Arena();
+
+  /// 把 \p other 的大块全部并入本内存池，之后 \p other 为空
+  void adopt(Arena& other);
+
+  void* alloc(std::size_t size)
+  {
+    auto idx = (size + kGrain - 1) / kGrain;
+    auto& cls = mClasses[idx];
+
+    if (cls.mFree) {
+      auto ret = cls.mFree;
+      cls.mFree = *reinterpret_cast<void**>(ret);
+      return ret;
+    }
+
+    size = idx * kGrain;
+    if (std::size_t(cls.mEnd - cls.mTop) < size)
+      refill(cls, size);
+    auto ret = cls.mTop;
+    cls.mTop += size;
+    return ret;
+  }
+
+  void free(void* ptr)
+  {
+    auto chunk = reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(ptr) &
+                                          ~uintptr_t(kChunkSize - 1));
+    auto& cls = mClasses[chunk->mSize / kGrain];
+    *reinterpret_cast<void**>(ptr) = cls.mFree;
+    cls.mFree = ptr;
   }
 
-  static void gc_mark_dfs(Obj* obj);
+private:
+  /// 为尺寸级别 \p cls 申请一个新的大块，槽位尺寸为 \p size
+  void refill(Class& cls, std::size_t size);
 };
 
+inline void*
+Obj::Mgr::arena_alloc(std::size_t size)
+{
+  return mArena->alloc(size);
+}
+
+template<typename T, typename... Args, typename>
+T*
+Obj::Mgr::make(Args... args)
+{
+  T* obj;
+  if (mArena) {
+    static_assert(sizeof(T) <= kArenaMaxSize, "对象过大，无法从内存池分配");
+    static_assert(alignof(T) <= Arena::kGrain, "对象的对齐超过内存池的粒度");
+    auto slot = arena_alloc(sizeof(T));
+    try {
+      obj = new (slot) T(args...);
+    } catch (...) {
+      mArena->free(slot);
+      throw;
+    }
+  } else
+    obj = new T(args...);
+  obj->__next__ = __next__, __next__ = obj;
+  ++mCount, ++mYoung;
+  return obj;
+}
+
 /// 检查循环引用，防止无限递归。
 struct Obj::Walked
 {
@@ -146,12 +391,21 @@ struct Obj::Walked
   Walked(Obj* obj)
     : mObj(obj)
   {
-    ASSERT((reinterpret_cast<uintptr_t>(mObj->__next__) & 0b10) == 0);
-    reinterpret_cast<uintptr_t&>(mObj->__next__) |= uintptr_t(0b10);
+    enter(mObj);
+  }
+
+  ~Walked() { leave(mObj); }
+
+  /// 标记 \p obj 正在遍历中，已经在遍历中则中断。显式栈的遍历器进出结点不
+  /// 成对出现在同一个作用域里，直接调用这两个函数。
+  static void enter(Obj* obj)
+  {
+    ASSERT((obj->__bits__() & 0b10) == 0);
+    obj->__bits__(obj->__bits__() | uintptr_t(0b10));
   }
 
-  ~Walked()
+  static void leave(Obj* obj)
   {
-    reinterpret_cast<uintptr_t&>(mObj->__next__) &= ~uintptr_t(0b10);
+    obj->__bits__(obj->__bits__() & ~uintptr_t(0b10));
   }
 };
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 函数级并行
+ *
+ * 全局声明处理完之后，各个函数体的类型检查和 IR 生成互不依赖，可以分给一组
+ * 工作线程。下标区间先均分给各个线程，线程从自己区间的前端逐个取下标；自己的
+ * 取完了，就从剩得最多的线程那里偷走后一半，函数体大小悬殊时也不会有线程闲着。
+ *
+ * 线程数默认为 1，即不并行，可由环境变量 YATCC_FUNC_JOBS 指定。批量模式已经
+ * 按文件并行，不再按函数并行。
+ */
+namespace pool {
+
+/// 按函数并行的线程数
+inline unsigned
+num_jobs()
+{
+  if (auto env = std::getenv("YATCC_FUNC_JOBS")) {
+    auto n = std::atoi(env);
+    if (n > 0)
+      return n;
+  }
+  return 1;
+}
+
+/**
+ * 用 \p jobs 个线程对 [0, \p n) 中的每个下标 i 调用 \p fn(i, w)，w 是当前
+ * 线程的序号，小于 \p jobs，调用者可以据此给每个线程准备自己的状态。主线程
+ * 也干活，序号为 0。某次调用抛出异常后不再取新的下标，等各线程都停下之后
+ * 重新抛出第一个异常。
+ */
+template<typename Fn>
+void
+run(std::size_t n, unsigned jobs, Fn&& fn)
+{
+  // 每个线程的下标区间，各占一个缓存行，免得相邻的锁互相干扰
+  struct alignas(64) Range
+  {
+    std::mutex mMtx;
+    std::size_t mBegin{ 0 }, mEnd{ 0 };
+  };
+
+  jobs = std::max<std::size_t>(1, std::min<std::size_t>(jobs, n));
+  std::vector<Range> ranges(jobs);
+  for (unsigned w = 0; w < jobs; ++w)
+    ranges[w].mBegin = n * w / jobs, ranges[w].mEnd = n * (w + 1) / jobs;
+
+  // 从剩得最多的线程那里偷走后一半，一次只拿一把锁
+  auto steal = [&](unsigned w, std::size_t& i) {
+    while (true) {
+      unsigned victim = w;
+      std::size_t most = 0;
+      for (unsigned v = 0; v < jobs; ++v) {
+        std::lock_guard<std::mutex> lock(ranges[v].mMtx);
+        if (ranges[v].mEnd - ranges[v].mBegin > most)
+          victim = v, most = ranges[v].mEnd - ranges[v].mBegin;
+      }
+      if (most == 0)
+        return false;
+
+      std::size_t begin, end;
+      {
+        auto& r = ranges[victim];
+        std::lock_guard<std::mutex> lock(r.mMtx);
+        if (r.mBegin == r.mEnd)
+          continue; // 刚被取完，重新挑
+        end = r.mEnd;
+        begin = r.mEnd -= (r.mEnd - r.mBegin + 1) / 2;
+      }
+
+      i = begin;
+      std::lock_guard<std::mutex> lock(ranges[w].mMtx);
+      ranges[w].mBegin = begin + 1, ranges[w].mEnd = end;
+      return true;
+    }
+  };
+
+  auto next = [&](unsigned w, std::size_t& i) {
+    {
+      auto& r = ranges[w];
+      std::lock_guard<std::mutex> lock(r.mMtx);
+      if (r.mBegin < r.mEnd) {
+        i = r.mBegin++;
+        return true;
+      }
+    }
+    return steal(w, i);
+  };
+
+  std::atomic<bool> failed{ false };
+  std::exception_ptr error;
+  std::mutex errMtx;
+
+  auto work = [&](unsigned w) {
+    for (std::size_t i; !failed && next(w, i);) {
+      try {
+        fn(i, w);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errMtx);
+        if (!error)
+          error = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned w = 1; w < jobs; ++w)
+    threads.emplace_back(work, w);
+  work(0);
+  for (auto& t : threads)
+    t.join();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+} // namespace pool
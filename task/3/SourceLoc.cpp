@@ -0,0 +1,21 @@
+#include "SourceLoc.hpp"
+
+std::uint32_t
+SourceLoc::Files::id(std::string_view path)
+{
+  // 一次编译涉及的文件很少，顺序查找即可
+  for (std::uint32_t i = 1; i < mCount; ++i)
+    if (mNames[i] == path)
+      return i;
+
+  if (mCount == kMaxFiles)
+    return 0;
+  mNames[mCount] = path;
+  return mCount++;
+}
+
+void
+SourceLoc::Files::print(std::ostream& os, SourceLoc loc) const
+{
+  os << name(loc.file()) << ':' << loc.line() << ':' << loc.column();
+}
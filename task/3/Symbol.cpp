@@ -0,0 +1,74 @@
+#include "Symbol.hpp"
+#include "Obj.hpp"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+/// 字符串按块存放，块一旦分配就不再移动，读取时无需加锁
+constexpr std::uint32_t kChunkBits = 12;
+constexpr std::uint32_t kChunkSize = 1u << kChunkBits;
+constexpr std::uint32_t kMaxChunks = 1u << 12;
+
+std::atomic<std::string*> sChunks[kMaxChunks];
+
+/// 驻留表，首次使用时构造，保证编号 0 对应空串
+struct Table
+{
+  std::mutex mMutex;
+  std::uint32_t mCount{ 0 };
+  std::unordered_map<std::string_view, std::uint32_t> mIds;
+
+  Table() { append({}); }
+
+  /// 在持锁的情况下追加一个新字符串，返回其编号
+  std::uint32_t append(std::string_view str)
+  {
+    auto id = mCount;
+    ASSERT((id >> kChunkBits) < kMaxChunks); // 驻留表已满
+    auto& head = sChunks[id >> kChunkBits];
+    auto chunk = head.load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+      chunk = new std::string[kChunkSize];
+      head.store(chunk, std::memory_order_release);
+    }
+
+    auto& slot = chunk[id & (kChunkSize - 1)];
+    slot = str;
+    mIds.emplace(slot, id);
+    ++mCount;
+    return id;
+  }
+};
+
+Table&
+table()
+{
+  static Table sTable;
+  return sTable;
+}
+
+} // namespace
+
+Symbol::Symbol(std::string_view str)
+{
+  auto& t = table();
+  if (str.empty()) {
+    mId = 0;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(t.mMutex);
+  auto iter = t.mIds.find(str);
+  mId = iter != t.mIds.end() ? iter->second : t.append(str);
+}
+
+const std::string&
+Symbol::str() const
+{
+  if (mId == 0)
+    table(); // 空串所在的块可能还没有分配
+  auto chunk = sChunks[mId >> kChunkBits].load(std::memory_order_acquire);
+  return chunk[mId & (kChunkSize - 1)];
+}
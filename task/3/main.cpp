@@ -1,54 +1,101 @@
+#include "Compact.hpp"
 #include "EmitIR.hpp"
 #include "Json2Asg.hpp"
+#include "Manifest.hpp"
+#include "Pool.hpp"
 #include "asg.hpp"
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/MemoryBuffer.h>
 
-int
-main(int argc, char* argv[])
+/// 打印从 \p since 到现在经过的时间，并把 \p since 更新为现在
+static void
+print_elapsed(const char* phase, std::chrono::steady_clock::time_point& since)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> ms = now - since;
+  std::cout << "耗时[" << phase << "]：" << ms.count() << " ms" << std::endl;
+  since = now;
+}
 
-  auto inFileOrErr = llvm::MemoryBuffer::getFile(argv[1]);
+/// 把 JSON 文件 \p inName 翻译成 LLVM IR 写到 \p outName ，返回值同进程退出码。
+/// 每次调用有自己的 Obj::Mgr 和 LLVMContext，可以在多个线程中同时调用。
+/// 生成 IR 时用 \p jobs 个线程按函数并行。
+static int
+translate(const char* inName, const char* outName, bool verbose, unsigned jobs)
+{
+  // 较大的文件会被直接映射到内存，且保证以 '\0' 结尾
+  auto inFileOrErr = llvm::MemoryBuffer::getFile(inName);
   if (auto err = inFileOrErr.getError()) {
-    std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to open input file: " << inName << '\n';
     return -2;
   }
   auto inFile = std::move(inFileOrErr.get());
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
+  llvm::StringRef outPath(outName);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outName << '\n';
     return -3;
   }
 
-  auto json = llvm::json::parse(inFile->getBuffer());
-  if (!json) {
-    std::cout << "Error: unable to parse input file: " << argv[1] << '\n';
-    return 1;
-  }
+  auto since = std::chrono::steady_clock::now();
+  auto elapsed = [&](const char* phase) {
+    if (verbose)
+      print_elapsed(phase, since);
+  };
+  auto collected = [&](const Obj::Mgr::Stats& stats, const char* phase) {
+    if (verbose)
+      stats.print(phase);
+  };
 
   // 读取 JSON，转换为 ASG
-  Obj::Mgr mgr;
+  Obj::Mgr mgr(true); // 启用内存池模式
   Json2Asg json2asg(mgr);
-  auto asg = json2asg(json.get());
+  auto asg = json2asg(inFile->getBuffer());
   mgr.mRoot = asg;
-  mgr.gc();
+  elapsed("读取 JSON");
+  collected(mgr.gc(), "读取 JSON");
+  elapsed("垃圾回收");
+  // 由环境变量 YATCC_COMPACT 打开，比较指针布局和紧凑布局，见 Compact.hpp
+  if (verbose && std::getenv("YATCC_COMPACT")) {
+    asg::compact::report(asg, std::cout);
+    elapsed("比较布局");
+  }
 
   // 从 ASG 发射到 LLVM IR
   llvm::LLVMContext ctx;
   EmitIR emitIR(mgr, ctx);
-  auto& mod = emitIR(asg);
-  mgr.gc();
+  auto& mod = emitIR(asg, jobs);
+  elapsed("生成 IR");
+  collected(mgr.gc_young(), "生成 IR"); // 只回收生成 IR 时新建的结点
+  elapsed("垃圾回收");
 
   // 先把 LLVM IR 写出到文件里，再检查合不合法
   mod.print(outFile, nullptr, false, true);
-  if (llvm::verifyModule(mod, &llvm::outs()))
+  elapsed("输出 IR");
+  if (llvm::verifyModule(mod, verbose ? &llvm::outs() : nullptr))
     return 3;
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (manifest::is_manifest(argc, argv))
+    return manifest::main(argv[1], [](const manifest::Entry& entry) {
+      return translate(
+        entry.mInput.c_str(), entry.mOutput.c_str(), false, 1);
+    });
+
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " @<manifest>\n";
+    return -1;
+  }
+
+  return translate(argv[1], argv[2], true, pool::num_jobs());
 }
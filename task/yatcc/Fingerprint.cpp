@@ -0,0 +1,253 @@
+#include "Fingerprint.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#define self (*this)
+
+namespace asg {
+
+/// 逐个混入 64 位的值，每步都过一遍 MurmurHash3 的终结函数，顺序不同结果就不同
+struct Fingerprint::Hasher
+{
+  std::uint64_t mHash{ 0x9e3779b97f4a7c15 };
+
+  void operator()(std::uint64_t x)
+  {
+    x ^= mHash;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53;
+    x ^= x >> 33;
+    mHash = x;
+  }
+
+  void operator()(std::string_view str)
+  {
+    self(str.size());
+    for (std::size_t i = 0; i < str.size(); i += 8) {
+      std::uint64_t chunk = 0;
+      auto n = std::min<std::size_t>(8, str.size() - i);
+      std::memcpy(&chunk, str.data() + i, n);
+      self(chunk);
+    }
+  }
+};
+
+Fingerprint::Fingerprint(TranslationUnit* tu)
+{
+  // 全局常量的初始化只能引用在它之前声明的实体，按顺序算一遍即可
+  for (auto&& decl : tu->decls) {
+    auto var = decl->dcst<VarDecl>();
+    if (var && var->init && var->type && var->type->qual.const_) {
+      Hasher h;
+      walk(h, var->init);
+      mConsts.emplace(var, h.mHash);
+    }
+  }
+}
+
+std::uint64_t
+Fingerprint::operator()(FunctionDecl* func)
+{
+  mLocals.clear();
+  Hasher h;
+  h(func->name.str());
+  h(type(func->type));
+  h(func->params.size());
+  for (auto&& param : func->params)
+    local(h, param);
+  walk(h, func->body);
+  return h.mHash;
+}
+
+std::uint64_t
+Fingerprint::type(const Type* type)
+{
+  if (type == nullptr)
+    return 0;
+  if (auto iter = mTypes.find(type); iter != mTypes.end())
+    return iter->second;
+
+  Hasher h;
+  h(std::uint64_t(type->spec));
+  h(type->qual.const_);
+  for (auto texp = type->texp; texp; texp = texp->sub) {
+    h(std::uint64_t(texp->tag));
+    switch (texp->tag) {
+      case Kind::kPointerType:
+        h(texp->scst<PointerType>()->qual.const_);
+        break;
+
+      case Kind::kArrayType:
+        h(texp->scst<ArrayType>()->len);
+        break;
+
+      case Kind::kFunctionType: {
+        auto& params = texp->scst<FunctionType>()->params;
+        h(params.size());
+        for (auto&& param : params)
+          h(self.type(param));
+      } break;
+
+      default:
+        ABORT();
+    }
+  }
+  mTypes.emplace(type, h.mHash);
+  return h.mHash;
+}
+
+template<typename T>
+void
+Fingerprint::walk(Hasher& h, T* root)
+{
+  std::vector<std::pair<Obj*, Kind>> stack;
+  auto push = [&](auto* obj) { stack.emplace_back(obj, obj->tag); };
+
+  // 可空的子结点先混入有无，列表先混入长度，先序的编码才没有歧义
+  auto push_opt = [&](auto* obj) {
+    h(obj != nullptr);
+    if (obj)
+      push(obj);
+  };
+  auto push_all = [&](auto& vec) {
+    h(vec.size());
+    for (auto i = vec.rbegin(); i != vec.rend(); ++i)
+      push(*i);
+  };
+
+  push(root);
+  while (!stack.empty()) {
+    auto [obj, tag] = stack.back();
+    stack.pop_back();
+    h(std::uint64_t(tag));
+
+    if (tag >= Kind::kIntegerLiteral && tag <= Kind::kImplicitCastExpr) {
+      auto expr = obj->scst<Expr>();
+      h(type(expr->type));
+      h(std::uint64_t(expr->cate));
+    }
+
+    switch (tag) {
+      case Kind::kIntegerLiteral:
+        h(obj->scst<IntegerLiteral>()->val);
+        break;
+
+      case Kind::kStringLiteral:
+        h(std::string_view(obj->scst<StringLiteral>()->val));
+        break;
+
+      case Kind::kDeclRefExpr:
+        decl_ref(h, obj->scst<DeclRefExpr>()->decl);
+        break;
+
+      case Kind::kParenExpr:
+        push(obj->scst<ParenExpr>()->sub);
+        break;
+
+      case Kind::kUnaryExpr: {
+        auto p = obj->scst<UnaryExpr>();
+        h(std::uint64_t(p->op));
+        push(p->sub);
+      } break;
+
+      case Kind::kBinaryExpr: {
+        auto p = obj->scst<BinaryExpr>();
+        h(std::uint64_t(p->op));
+        push(p->rht), push(p->lft);
+      } break;
+
+      case Kind::kCallExpr: {
+        auto p = obj->scst<CallExpr>();
+        push_all(p->args), push(p->head);
+      } break;
+
+      case Kind::kInitListExpr:
+        push_all(obj->scst<InitListExpr>()->list);
+        break;
+
+      case Kind::kImplicitCastExpr: {
+        auto p = obj->scst<ImplicitCastExpr>();
+        h(std::uint64_t(p->kind));
+        push(p->sub);
+      } break;
+
+      case Kind::kImplicitInitExpr:
+      case Kind::kNullStmt:
+      case Kind::kBreakStmt:
+      case Kind::kContinueStmt:
+        break;
+
+      case Kind::kDeclStmt:
+        push_all(obj->scst<DeclStmt>()->decls);
+        break;
+
+      case Kind::kExprStmt:
+        push(obj->scst<ExprStmt>()->expr);
+        break;
+
+      case Kind::kCompoundStmt:
+        push_all(obj->scst<CompoundStmt>()->subs);
+        break;
+
+      case Kind::kIfStmt: {
+        auto p = obj->scst<IfStmt>();
+        push_opt(p->else_), push(p->then), push(p->cond);
+      } break;
+
+      case Kind::kWhileStmt: {
+        auto p = obj->scst<WhileStmt>();
+        push(p->body), push(p->cond);
+      } break;
+
+      case Kind::kDoStmt: {
+        auto p = obj->scst<DoStmt>();
+        push(p->cond), push(p->body);
+      } break;
+
+      case Kind::kReturnStmt:
+        push_opt(obj->scst<ReturnStmt>()->expr);
+        break;
+
+      case Kind::kVarDecl: {
+        auto p = obj->scst<VarDecl>();
+        local(h, p);
+        push_opt(p->init);
+      } break;
+
+      default:
+        ABORT();
+    }
+  }
+}
+
+void
+Fingerprint::decl_ref(Hasher& h, Decl* decl)
+{
+  if (auto iter = mLocals.find(decl); iter != mLocals.end()) {
+    h(0);
+    h(iter->second);
+    return;
+  }
+
+  h(1);
+  h(decl->name.str());
+  h(type(decl->type));
+  auto iter = mConsts.find(decl);
+  h(iter != mConsts.end());
+  if (iter != mConsts.end())
+    h(iter->second);
+}
+
+void
+Fingerprint::local(Hasher& h, Decl* decl)
+{
+  mLocals.emplace(decl, std::uint32_t(mLocals.size()));
+  h(decl->name.str());
+  h(type(decl->type));
+}
+
+} // namespace asg
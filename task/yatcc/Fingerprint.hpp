@@ -0,0 +1,50 @@
+#pragma once
+
+#include "asg.hpp"
+#include <cstdint>
+#include <unordered_map>
+
+namespace asg {
+
+/**
+ * @brief 函数的结构指纹
+ *
+ * 在类型检查之后的语义图上为有函数体的函数算一个 64 位哈希，两个函数生成的 IR
+ * 可能不同时指纹就不同，用作增量编译缓存的键。参与哈希的有：函数的名字和类型，
+ * 参数和局部变量的名字，函数体中每个结点的种类、运算符、值类别、类型和字面量，
+ * 以及引用到的全局变量和函数的名字、类型；引用带初始化的 const 全局变量时还有
+ * 它的初始化表达式，因为 EmitIR 会把它当作常量直接折叠进来。局部变量按声明的
+ * 先后编号，引用时只看编号。源代码位置不参与，在前面插入几行不会让后面的函数
+ * 失效。
+ *
+ * 指纹在多次运行之间保持稳定：名字按字符串而不是 Symbol 的编号哈希，也不看
+ * 任何指针。
+ */
+class Fingerprint
+{
+public:
+  /// 预先算出 \p tu 中 const 全局变量初始化表达式的指纹
+  explicit Fingerprint(TranslationUnit* tu);
+
+  /// 函数 \p func 的指纹，\p func 须有函数体
+  std::uint64_t operator()(FunctionDecl* func);
+
+private:
+  struct Hasher;
+
+  std::unordered_map<const Type*, std::uint64_t> mTypes;
+  std::unordered_map<const Decl*, std::uint64_t> mConsts; ///< 全局常量的初始化
+  std::unordered_map<const Decl*, std::uint32_t> mLocals; ///< 参数和局部变量
+
+  std::uint64_t type(const Type* type);
+
+  /// 用显式栈先序遍历以 \p root 为根的子树，逐个结点混入 \p h
+  template<typename T>
+  void walk(Hasher& h, T* root);
+
+  void decl_ref(Hasher& h, Decl* decl);
+
+  void local(Hasher& h, Decl* decl);
+};
+
+} // namespace asg
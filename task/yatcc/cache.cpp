@@ -0,0 +1,262 @@
+#include "cache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <tuple>
+
+namespace yatcc {
+
+namespace {
+
+/// MurmurHash3 的终结函数
+std::uint64_t
+mix(std::uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccd;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53;
+  x ^= x >> 33;
+  return x;
+}
+
+/// 函数体自己新建的私有常量，随函数体一起存进包
+bool
+private_const(const llvm::GlobalVariable& var)
+{
+  return var.hasLocalLinkage() && !var.isDeclaration();
+}
+
+/// 由 \p fn 写出 \p file 的内容，先写临时文件再改名，成功时返回 true
+bool
+write(const std::string& file,
+      llvm::function_ref<void(llvm::raw_ostream&)> fn)
+{
+  auto pid = llvm::sys::Process::getProcessId();
+  auto tmp = file + ".tmp" + std::to_string(pid);
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(tmp, ec);
+    if (ec)
+      return false;
+    fn(os);
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(tmp);
+      return false;
+    }
+  }
+  if (llvm::sys::fs::rename(tmp, file)) {
+    llvm::sys::fs::remove(tmp);
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+Cache::Cache(std::string dir, llvm::LLVMContext& ctx)
+  : mDir(std::move(dir))
+  , mCtx(ctx)
+{
+  llvm::sys::fs::create_directories(mDir);
+
+  // 按内容而不是大小和修改时间，复制、重新链接出相同的文件都不影响命中
+  static int anchor;
+  auto exe = llvm::sys::fs::getMainExecutable("yatcc", &anchor);
+  mSalt = llvm::xxHash64(LLVM_VERSION_STRING);
+  if (auto buf = llvm::MemoryBuffer::getFile(exe, false, false))
+    mSalt = mix(mSalt ^ llvm::xxHash64((*buf)->getBuffer()));
+}
+
+llvm::Function*
+Cache::load(std::uint64_t key, Stage stage, llvm::StringRef name)
+{
+  auto buf = llvm::MemoryBuffer::getFile(path(key, stage));
+  if (!buf)
+    return nullptr;
+
+  // 索引文件是“键 盐 包名”，键和盐对不上说明文件名撞上了别的条目
+  llvm::StringRef keyStr, saltStr, rest = (*buf)->getBuffer().trim();
+  std::tie(keyStr, rest) = rest.split(' ');
+  std::tie(saltStr, rest) = rest.split(' ');
+  std::uint64_t fileKey, fileSalt;
+  if (keyStr.getAsInteger(16, fileKey) || fileKey != key ||
+      saltStr.getAsInteger(16, fileSalt) || fileSalt != mSalt)
+    return nullptr;
+
+  auto mod = pack(rest.str());
+  if (mod == nullptr)
+    return nullptr;
+
+  auto func = mod->getFunction(name);
+  if (func == nullptr || func->isDeclaration())
+    return nullptr;
+  if (auto err = func->materialize()) {
+    llvm::consumeError(std::move(err));
+    return nullptr;
+  }
+  return func;
+}
+
+std::vector<llvm::GlobalVariable*>
+Cache::consts(llvm::Function* func) const
+{
+  std::vector<llvm::GlobalVariable*> ret;
+  llvm::SmallPtrSet<llvm::Constant*, 16> seen;
+  std::vector<llvm::Constant*> work;
+  for (auto&& bb : *func)
+    for (auto&& inst : bb)
+      for (auto&& op : inst.operands())
+        if (auto c = llvm::dyn_cast<llvm::Constant>(op))
+          work.push_back(c);
+
+  // 函数体直接或经由常量表达式引用的私有常量
+  while (!work.empty()) {
+    auto c = work.back();
+    work.pop_back();
+    if (llvm::isa<llvm::ConstantData>(c) || !seen.insert(c).second)
+      continue;
+    if (auto var = llvm::dyn_cast<llvm::GlobalVariable>(c)) {
+      if (private_const(*var)) {
+        ret.push_back(var);
+        work.push_back(var->getInitializer());
+      }
+    } else if (!llvm::isa<llvm::GlobalValue>(c)) {
+      for (auto&& op : c->operands())
+        work.push_back(llvm::cast<llvm::Constant>(op));
+    }
+  }
+
+  std::sort(ret.begin(), ret.end(), [&](auto a, auto b) {
+    return mOrder.at(a) < mOrder.at(b);
+  });
+  return ret;
+}
+
+std::vector<std::unique_ptr<llvm::Module>>
+Cache::release()
+{
+  std::vector<std::unique_ptr<llvm::Module>> ret;
+  for (auto&& [name, mod] : mPacks) {
+    if (mod == nullptr)
+      continue;
+    for (auto&& f : *mod)
+      if (!f.isDeclaration())
+        f.deleteBody(); // 没有解析的函数体也一样删去
+    for (auto&& g : llvm::make_early_inc_range(mod->globals()))
+      if (private_const(g)) {
+        g.removeDeadConstantUsers();
+        if (g.use_empty())
+          g.eraseFromParent();
+      }
+    ret.push_back(std::move(mod));
+  }
+  mPacks.clear();
+  mOrder.clear();
+  return ret;
+}
+
+std::size_t
+Cache::store(Stage stage,
+             llvm::Module& mod,
+             const std::vector<std::pair<std::string, std::uint64_t>>& funcs)
+{
+  llvm::StringSet<> names;
+  for (auto&& [name, key] : funcs)
+    names.insert(name);
+
+  // 只留下要存的函数体和它们用到的私有常量，其余的全局实体都改成声明
+  for (auto&& g : llvm::make_early_inc_range(mod.globals()))
+    if (g.hasAppendingLinkage()) // llvm.global_ctors
+      g.eraseFromParent();
+  for (auto&& f : mod)
+    if (!f.isDeclaration() && !names.count(f.getName()))
+      f.deleteBody();
+  for (auto&& g : llvm::make_early_inc_range(mod.globals())) {
+    if (private_const(g)) {
+      g.removeDeadConstantUsers();
+      if (g.use_empty())
+        g.eraseFromParent();
+    } else if (!g.isDeclaration())
+      g.setInitializer(nullptr);
+  }
+  for (auto&& f : llvm::make_early_inc_range(mod))
+    if (f.isDeclaration() && f.use_empty())
+      f.eraseFromParent();
+
+  // 包名只要在目录里不重复即可
+  auto now = std::chrono::system_clock::now().time_since_epoch().count();
+  char name[40];
+  std::snprintf(
+    name,
+    sizeof(name),
+    "pack-%016llx.bc",
+    static_cast<unsigned long long>(
+      mix(mSalt ^ mix(now) ^ llvm::sys::Process::getProcessId())));
+  if (!write(mDir + '/' + name, [&](llvm::raw_ostream& os) {
+        llvm::WriteBitcodeToFile(mod, os, true);
+      }))
+    return 0;
+
+  std::size_t stored = 0;
+  for (auto&& [func, key] : funcs) {
+    auto f = mod.getFunction(func);
+    if (f && !f->isDeclaration())
+      stored += write(path(key, stage), [&](llvm::raw_ostream& os) {
+        os << llvm::format_hex_no_prefix(key, 16) << ' '
+           << llvm::format_hex_no_prefix(mSalt, 16) << ' ' << name << '\n';
+      });
+  }
+  return stored;
+}
+
+std::string
+Cache::path(std::uint64_t key, Stage stage) const
+{
+  char name[32];
+  std::snprintf(name,
+                sizeof(name),
+                "%016llx.%s",
+                static_cast<unsigned long long>(mix(key ^ mSalt)),
+                stage == Stage::kEmitted ? "emit" : "opt");
+  return mDir + '/' + name;
+}
+
+llvm::Module*
+Cache::pack(const std::string& name)
+{
+  auto& mod = mPacks[name];
+  if (mod != nullptr)
+    return mod.get();
+
+  auto buf = llvm::MemoryBuffer::getFile(mDir + '/' + name);
+  if (!buf)
+    return nullptr;
+  // 惰性解析，只有用到的函数体才会被 load 解析出来
+  auto lazy = llvm::getOwningLazyBitcodeModule(std::move(*buf), mCtx);
+  if (!lazy) {
+    llvm::consumeError(lazy.takeError());
+    return nullptr;
+  }
+  mod = std::move(*lazy);
+  for (auto&& g : mod->globals())
+    mOrder.emplace(&g, mOrder.size());
+  return mod.get();
+}
+
+} // namespace yatcc
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <llvm/IR/Module.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace yatcc {
+
+/**
+ * @brief 增量编译的函数缓存
+ *
+ * 以 asg::Fingerprint 算出的指纹为键，按阶段分为生成后和优化后两种。每次运行
+ * 把没命中的函数一起写进一个 bitcode 包，包里是这些函数体、它们新建的私有常量，
+ * 以及引用到的其他全局实体的声明；每个键另有一个索引文件，记着完整的键和它在
+ * 哪个包里。
+ * 读的时候按需惰性解析包里的函数，交给 EmitIR::splice_body 与
+ * EmitIR::resolve 接进当前模块。
+ *
+ * 不把函数一个个单独写成 bitcode，是因为要保留使用列表的顺序（它决定了基本块
+ * 前驱的顺序，进而影响 phi 的操作数顺序和输出的注释），而写出时预测使用列表
+ * 顺序要遍历常量在整个 LLVMContext 里的全部使用，逐个写就成了平方复杂度。
+ *
+ * 每个条目还带着盐：yatcc 可执行文件内容的哈希和 LLVM 的版本，重新编译过
+ * yatcc（比如改了 EmitIR 或优化）或换了 LLVM 之后旧的条目自然失效。索引文件
+ * 的文件名只是键和盐混合后的 64 位哈希，读的时候还要核对文件里记着的键和盐，
+ * 两个条目的文件名撞上时只会不命中，不会读错。写入时先写临时文件再改名，多个
+ * 进程共用一个目录也不会读到写了一半的文件。
+ */
+class Cache
+{
+public:
+  enum class Stage
+  {
+    kEmitted,   ///< EmitIR 刚生成的 IR
+    kOptimized, ///< 经过任务 4 的优化之后的 IR
+  };
+
+  /// 使用目录 \p dir，不存在时创建，读出的包都放在 \p ctx 中
+  Cache(std::string dir, llvm::LLVMContext& ctx);
+
+  /// 读出键为 \p key、名为 \p name 的函数体，没有或读不出时返回空。返回的
+  /// 函数属于 Cache 持有的包
+  llvm::Function* load(std::uint64_t key, Stage stage, llvm::StringRef name);
+
+  /// load 读出的函数 \p func 用到的私有常量，按在包中的先后排列
+  std::vector<llvm::GlobalVariable*> consts(llvm::Function* func) const;
+
+  /// 交出读过的包，其中没有用到的函数体和私有常量已经删去，剩下的都是声明
+  std::vector<std::unique_ptr<llvm::Module>> release();
+
+  /**
+   * @brief 把 \p mod 中名为 \p funcs 的函数写成一个包，返回写成功的个数
+   *
+   * \p funcs 是函数名和键。\p mod 会被就地删减成包的内容，此后只能销毁。
+   */
+  std::size_t store(
+    Stage stage,
+    llvm::Module& mod,
+    const std::vector<std::pair<std::string, std::uint64_t>>& funcs);
+
+private:
+  std::string mDir;
+  llvm::LLVMContext& mCtx;
+  std::uint64_t mSalt{ 0 }; ///< yatcc 可执行文件内容的哈希混入 LLVM 的版本
+
+  std::unordered_map<std::string, std::unique_ptr<llvm::Module>> mPacks;
+  std::unordered_map<const llvm::GlobalValue*, std::size_t> mOrder;
+
+  /// 键为 \p key 的条目的索引文件路径，其内容是键、盐和包的文件名
+  std::string path(std::uint64_t key, Stage stage) const;
+
+  /// 读出名为 \p name 的包，读不出时返回空
+  llvm::Module* pack(const std::string& name);
+};
+
+} // namespace yatcc
@@ -0,0 +1,216 @@
+#include "ConstantFolding.hpp"
+#include "EmitIR.hpp"
+#include "Fingerprint.hpp"
+#include "Mem2Reg.hpp"
+#include "cache.hpp"
+#include "yatcc.hpp"
+#include <iostream>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+#include <unordered_set>
+
+namespace yatcc {
+
+namespace {
+
+/// 运行任务 4 的优化，与 task4 的 opt 相同，但不打印分析报告
+void
+opt(llvm::Module& mod)
+{
+  using namespace llvm;
+
+  LoopAnalysisManager lam;
+  FunctionAnalysisManager fam;
+  CGSCCAnalysisManager cgam;
+  ModuleAnalysisManager mam;
+  ModulePassManager mpm;
+
+  PassBuilder pb;
+  pb.registerModuleAnalyses(mam);
+  pb.registerCGSCCAnalyses(cgam);
+  pb.registerFunctionAnalyses(fam);
+  pb.registerLoopAnalyses(lam);
+  pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+  mpm.addPass(Mem2Reg());
+  mpm.addPass(ConstantFolding(llvm::nulls()));
+  mpm.run(mod, mam);
+}
+
+/// 用本机目标把 \p mod 编译成目标文件写到 \p out，失败时返回 false
+bool
+emit_object(llvm::Module& mod, llvm::raw_pwrite_stream& out)
+{
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  auto triple = llvm::sys::getDefaultTargetTriple();
+  std::string err;
+  auto target = llvm::TargetRegistry::lookupTarget(triple, err);
+  if (target == nullptr) {
+    std::cout << "Error: " << err << '\n';
+    return false;
+  }
+
+  std::unique_ptr<llvm::TargetMachine> tm(target->createTargetMachine(
+    triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::PIC_));
+  mod.setTargetTriple(triple);
+  mod.setDataLayout(tm->createDataLayout());
+
+  llvm::legacy::PassManager pm;
+  if (tm->addPassesToEmitFile(
+        pm, out, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+    std::cout << "Error: target can't emit object file\n";
+    return false;
+  }
+  pm.run(mod);
+  return true;
+}
+
+/// 经 bitcode 复制 \p mod，保留使用列表的顺序
+std::unique_ptr<llvm::Module>
+copy_module(const llvm::Module& mod)
+{
+  llvm::SmallVector<char, 0> buf;
+  llvm::raw_svector_ostream os(buf);
+  llvm::WriteBitcodeToFile(mod, os, true);
+  llvm::MemoryBufferRef ref(llvm::StringRef(buf.data(), buf.size()),
+                            mod.getModuleIdentifier());
+  return llvm::cantFail(llvm::parseBitcodeFile(ref, mod.getContext()));
+}
+
+/// 从缓存读回的函数体
+using Hits = std::vector<std::pair<asg::FunctionDecl*, llvm::Function*>>;
+
+/// 把 \p hits 的函数体接进 \p emitIR 的模块
+void
+splice(EmitIR& emitIR, Cache& cache, Hits& hits)
+{
+  for (auto [func, body] : hits)
+    emitIR.splice_body(func, body, cache.consts(body));
+  for (auto&& pack : cache.release())
+    emitIR.resolve(*pack);
+  hits.clear();
+}
+
+} // namespace
+
+int
+emit(const Options& opts,
+     Obj::Mgr& mgr,
+     asg::TranslationUnit* tu,
+     std::chrono::steady_clock::time_point& since)
+{
+  std::error_code ec;
+  llvm::raw_fd_ostream outFile(opts.mOutput, ec);
+  if (ec) {
+    std::cout << "Error: unable to open output file: " << opts.mOutput << '\n';
+    return -3;
+  }
+
+  llvm::LLVMContext ctx;
+  EmitIR emitIR(mgr, ctx, opts.mInput);
+
+  // 增量编译：按指纹从缓存读回没有变的函数，它们只生成声明。要优化又不输出
+  // 未优化的 IR 时，直接缓存优化后的 IR，命中的函数连优化也省掉
+  using Stage = Cache::Stage;
+  auto stage = opts.mOptimize && !opts.mDumpIr ? Stage::kOptimized
+                                               : Stage::kEmitted;
+  std::unique_ptr<Cache> cache;
+  Hits hits;
+  std::vector<std::pair<std::string, std::uint64_t>> misses;
+  if (opts.mCache) {
+    cache = std::make_unique<Cache>(opts.mCache, ctx);
+    asg::Fingerprint fingerprint(tu);
+    std::vector<std::pair<asg::FunctionDecl*, std::uint64_t>> keys;
+    for (auto&& decl : tu->decls)
+      if (auto func = decl->dcst<asg::FunctionDecl>(); func && func->body)
+        keys.emplace_back(func, fingerprint(func));
+    print_elapsed("计算指纹", since);
+
+    for (auto [func, key] : keys) {
+      if (auto body = cache->load(key, stage, func->name.str()))
+        hits.emplace_back(func, body);
+      else
+        misses.emplace_back(func->name.str(), key);
+    }
+    std::cout << "缓存：命中 " << hits.size() << " 个函数，未命中 "
+              << misses.size() << " 个" << std::endl;
+    print_elapsed("读取缓存", since);
+
+    std::unordered_set<asg::FunctionDecl*> deferred;
+    for (auto [func, body] : hits)
+      deferred.insert(func);
+    emitIR.mDeferBody = [deferred = std::move(deferred)](auto func) {
+      return deferred.count(func) != 0;
+    };
+  }
+
+  // 从 ASG 发射到 LLVM IR
+  auto& mod = emitIR(tu, opts.mJobs);
+  if (cache && stage == Stage::kEmitted)
+    splice(emitIR, *cache, hits);
+  print_elapsed("生成 IR", since);
+
+  if (opts.mDumpIr) {
+    llvm::raw_fd_ostream irFile(opts.mDumpIr, ec);
+    if (ec) {
+      std::cout << "Error: unable to open output file: " << opts.mDumpIr
+                << '\n';
+      return -3;
+    }
+    mod.print(irFile, nullptr, false, true);
+    print_elapsed("输出 IR", since);
+  }
+
+  if (llvm::verifyModule(mod, &llvm::outs()))
+    return 3;
+
+  // 要缓存的 IR 之后还会被优化或者编译成目标文件改动，先复制一份
+  std::unique_ptr<llvm::Module> toStore;
+  auto keep = [&] {
+    if (cache && !misses.empty()) {
+      toStore = copy_module(mod);
+      print_elapsed("复制 IR", since);
+    }
+  };
+  if (stage == Stage::kEmitted && (opts.mOptimize || opts.mObject))
+    keep();
+
+  if (opts.mOptimize) {
+    opt(mod);
+    print_elapsed("优化", since);
+  }
+
+  if (cache && stage == Stage::kOptimized) {
+    if (opts.mObject)
+      keep();
+    splice(emitIR, *cache, hits);
+    print_elapsed("合并缓存", since);
+  }
+
+  if (opts.mObject) {
+    if (!emit_object(mod, outFile))
+      return 4;
+    print_elapsed("输出目标文件", since);
+  } else {
+    mod.print(outFile, nullptr, false, true);
+    print_elapsed("输出 IR", since);
+  }
+
+  if (cache && !misses.empty()) {
+    auto n = cache->store(stage, toStore ? *toStore : mod, misses);
+    std::cout << "缓存：写入 " << n << " 个函数" << std::endl;
+    print_elapsed("写入缓存", since);
+  }
+
+  return 0;
+}
+
+} // namespace yatcc
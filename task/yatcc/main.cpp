@@ -0,0 +1,152 @@
+#include "Asg2Json.hpp"
+#include "Pool.hpp"
+#include "Typing.hpp"
+#include "par.y.hh"
+#include "scan.hpp"
+#include "yatcc.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace yatcc {
+
+void
+print_elapsed(const char* phase, std::chrono::steady_clock::time_point& since)
+{
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> ms = now - since;
+  std::cout << "耗时[" << phase << "]：" << ms.count() << " ms" << std::endl;
+  since = now;
+}
+
+} // namespace yatcc
+
+static void
+usage(const char* argv0)
+{
+  std::cout << "Usage: " << argv0 << " [options] <input> <output>\n"
+            << "  -c                 输出目标文件（默认输出 LLVM IR 文本）\n"
+            << "  -O0                不运行任务 4 的优化\n"
+            << "  -j<n>              按函数并行的线程数（默认取 YATCC_FUNC_JOBS）\n"
+            << "  --cache=<dir>      增量编译的缓存目录（默认取 YATCC_CACHE）\n"
+            << "  --dump-tokens=<f>  另外输出任务 1 格式的词法单元流\n"
+            << "  --dump-asg=<f>     另外输出任务 2 格式的 JSON 语法树\n"
+            << "  --dump-ir=<f>      另外输出任务 3 格式的未优化 IR\n";
+}
+
+/// 解析命令行，成功时返回 true
+static bool
+parse_args(int argc, char* argv[], yatcc::Options& opts)
+{
+  auto value = [](const char* arg, const char* prefix) -> const char* {
+    auto len = std::strlen(prefix);
+    return std::strncmp(arg, prefix, len) == 0 ? arg + len : nullptr;
+  };
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = argv[i];
+    if (std::strcmp(arg, "-c") == 0)
+      opts.mObject = true;
+    else if (std::strcmp(arg, "-O0") == 0)
+      opts.mOptimize = false;
+    else if (auto v = value(arg, "-j"); v && std::atoi(v) > 0)
+      opts.mJobs = std::atoi(v);
+    else if (auto v = value(arg, "--cache="))
+      opts.mCache = *v ? v : nullptr;
+    else if (auto v = value(arg, "--dump-tokens="))
+      opts.mDumpTokens = v;
+    else if (auto v = value(arg, "--dump-asg="))
+      opts.mDumpAsg = v;
+    else if (auto v = value(arg, "--dump-ir="))
+      opts.mDumpIr = v;
+    else if (arg[0] == '-')
+      return false;
+    else if (opts.mInput == nullptr)
+      opts.mInput = arg;
+    else if (opts.mOutput == nullptr)
+      opts.mOutput = arg;
+    else
+      return false;
+  }
+
+  return opts.mOutput != nullptr;
+}
+
+int
+main(int argc, char* argv[])
+{
+  yatcc::Options opts;
+  opts.mJobs = pool::num_jobs();
+  if (auto env = std::getenv("YATCC_CACHE"); env && *env)
+    opts.mCache = env;
+  if (!parse_args(argc, argv, opts)) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  auto inFile = fopen(opts.mInput, "r");
+  if (!inFile) {
+    std::cerr << "Failed to open " << opts.mInput << '\n';
+    return -2;
+  }
+
+  auto since = std::chrono::steady_clock::now();
+  lex::G lexer;
+
+  // 词法单元流只作为调试输出，单独扫描一遍，好让它的开销单独计时
+  if (opts.mDumpTokens) {
+    std::ofstream tokFile(opts.mDumpTokens);
+    if (!tokFile) {
+      std::cout << "Error: unable to open output file: " << opts.mDumpTokens
+                << '\n';
+      return -3;
+    }
+    scan::open(lexer, inFile, opts.mInput);
+    scan::gDump = &tokFile;
+    while (scan::next(lexer))
+      ;
+    scan::gDump = nullptr;
+    scan::close(lexer);
+    rewind(inFile);
+    yatcc::print_elapsed("输出词法单元", since);
+  }
+
+  // 直接从源代码扫描、分析，得到抽象语义图
+  par::Context ctx;
+  ctx.mLex = &lexer;
+  scan::open(lexer, inFile, opts.mInput);
+  auto e = yyparse(ctx);
+  scan::close(lexer);
+  fclose(inFile);
+  if (e)
+    return e;
+  ctx.mMgr.mRoot = ctx.mTranslationUnit;
+  yatcc::print_elapsed("语法分析", since);
+  ctx.mMgr.gc().print("语法分析");
+  yatcc::print_elapsed("垃圾回收", since);
+
+  // 执行类型检查
+  asg::Typing typing(ctx.mMgr);
+  typing(ctx.mTranslationUnit, opts.mJobs);
+  yatcc::print_elapsed("类型检查", since);
+  typing.mTypeCache.clear();
+  ctx.mMgr.gc_young().print("类型检查"); // 只回收类型检查新建的结点
+  yatcc::print_elapsed("垃圾回收", since);
+
+  if (opts.mDumpAsg) {
+    std::error_code ec;
+    llvm::raw_fd_ostream asgFile(opts.mDumpAsg, ec);
+    if (ec) {
+      std::cout << "Error: unable to open output file: " << opts.mDumpAsg
+                << '\n';
+      return -3;
+    }
+    asg::Asg2Json asg2json(asgFile);
+    asg2json(ctx.mTranslationUnit);
+    asgFile << '\n';
+    yatcc::print_elapsed("输出 JSON", since);
+  }
+
+  return yatcc::emit(opts, ctx.mMgr, ctx.mTranslationUnit, since);
+}
@@ -0,0 +1,90 @@
+#include "scan.hpp"
+
+namespace scan {
+
+std::ostream* gDump{ nullptr };
+
+namespace {
+
+void
+dump(lex::G& g, std::ostream& out)
+{
+  out << tok::name(lex::token_kind(g.mId)) << " '" << g.mText << "'";
+  if (g.mStartOfLine)
+    out << "\t[StartOfLine]";
+  if (g.mLeadingSpace)
+    out << "\t[LeadingSpace]";
+  out << "\tLoc=<" << g.mFile << ':' << g.mLine << ':'
+      << g.mColumn << ">\n";
+}
+
+} // namespace
+
+void
+newline(lex::G& g)
+{
+  ++g.mLine;
+  g.mColumn = 1;
+  g.mStartOfLine = true;
+  g.mLeadingSpace = false;
+}
+
+void
+space(lex::G& g, int yyleng)
+{
+  g.mColumn += yyleng;
+  g.mLeadingSpace = true;
+}
+
+void
+line_marker(lex::G& g, const char* yytext, int yyleng)
+{
+  std::string_view text(yytext, yyleng);
+  auto p = text.find_first_not_of(" \t", 1);
+  if (p != text.npos && text.compare(p, 4, "line") == 0) // #line 指令
+    p = text.find_first_not_of(" \t", p + 4);
+
+  // 不是行标记（如 #pragma），只当作空白
+  if (p == text.npos || text[p] < '0' || text[p] > '9') {
+    space(g, yyleng);
+    return;
+  }
+  int line = 0;
+  for (; p < text.size() && '0' <= text[p] && text[p] <= '9'; ++p)
+    line = line * 10 + (text[p] - '0');
+
+  auto q = text.find('"', p);
+  if (q != text.npos) {
+    auto r = text.find('"', q + 1);
+    auto file = text.substr(q + 1, r == text.npos ? r : r - q - 1);
+    if (file != g.mFile) {
+      g.mFile = file;
+      g.mFileId = g.mFiles.id(file);
+    }
+  }
+
+  // 行标记本身所在行末尾的换行会再把行号加一
+  g.mLine = line - 1;
+  g.mColumn += yyleng;
+}
+
+int
+come(lex::G& g, int tokenId, const char* yytext, int yyleng)
+{
+  g.mId = tokenId;
+  g.mText = { yytext, std::size_t(yyleng) };
+  *g.mLloc = SourceLoc(g.mFileId, g.mLine, g.mColumn);
+
+  if (gDump)
+    dump(g, *gDump);
+  else if (tokenId == IDENTIFIER || tokenId == CONSTANT)
+    g.mLval->Sym = Symbol(g.mText);
+
+  g.mColumn += yyleng;
+  g.mStartOfLine = false;
+  g.mLeadingSpace = false;
+
+  return tokenId;
+}
+
+} // namespace scan
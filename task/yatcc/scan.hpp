@@ -0,0 +1,42 @@
+#pragma once
+
+#include "lex.hpp"
+#include <ostream>
+
+/// 直接扫描源代码的词法分析器，词号与 task2 的 par.y 一致，语义值直接写入
+/// yylval，不再经过任务 1 的文本词法单元流。状态沿用 task2 的 lex::G，flex
+/// 扫描器是可重入的，通过 yyextra 取得它。
+namespace scan {
+
+/// 非空时把词法单元按任务 1 的格式写到这里，此时不产生语义值
+extern std::ostream* gDump;
+
+/// 为 \p g 创建扫描器，从 \p in 读取源代码，\p file 是它的路径
+void
+open(lex::G& g, std::FILE* in, const char* file);
+
+/// 释放 open 创建的扫描器
+void
+close(lex::G& g);
+
+/// 不经过语法分析器，直接取下一个词法单元，用于输出词法单元流
+int
+next(lex::G& g);
+
+/// 换行，更新 \p g 里的行列号
+void
+newline(lex::G& g);
+
+/// 空白或注释，更新 \p g 里的列号
+void
+space(lex::G& g, int yyleng);
+
+/// 预处理器留下的行标记 `# 行号 "文件" ...`，更新 \p g 里的文件和行号
+void
+line_marker(lex::G& g, const char* yytext, int yyleng);
+
+/// 报告一个词法单元，语义值写入 *g.mLval，位置写入 *g.mLloc
+int
+come(lex::G& g, int tokenId, const char* yytext, int yyleng);
+
+} // namespace scan
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "asg.hpp"
+#include <chrono>
+
+namespace yatcc {
+
+/// 命令行选项
+struct Options
+{
+  const char* mInput{ nullptr };      ///< 源代码（预处理后的 .sysu.c）
+  const char* mOutput{ nullptr };     ///< 输出文件
+  const char* mDumpTokens{ nullptr }; ///< 非空时输出任务 1 格式的词法单元流
+  const char* mDumpAsg{ nullptr };    ///< 非空时输出任务 2 格式的 JSON
+  const char* mDumpIr{ nullptr };     ///< 非空时输出任务 3 格式的（未优化）IR
+  bool mObject{ false };              ///< 输出目标文件而不是 IR 文本
+  bool mOptimize{ true };             ///< 运行任务 4 的优化
+  unsigned mJobs{ 1 }; ///< 类型检查和生成 IR 时按函数并行的线程数
+  const char* mCache{ nullptr }; ///< 非空时在此目录下缓存各函数的 IR
+};
+
+/// 打印从 \p since 到现在经过的时间，并把 \p since 更新为现在
+void
+print_elapsed(const char* phase, std::chrono::steady_clock::time_point& since);
+
+/// 后端：从抽象语义图生成 LLVM IR，优化后写出到 Options::mOutput
+int
+emit(const Options& opts,
+     Obj::Mgr& mgr,
+     asg::TranslationUnit* tu,
+     std::chrono::steady_clock::time_point& since);
+
+} // namespace yatcc
@@ -0,0 +1,55 @@
+"""把 performance 目录下全部测例预处理后的源码拼接起来（可重复多遍），
+交给实验一的程序做词法分析，报告每秒处理的词法单元数。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import subprocess as subps
+import time
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验一吞吐量测试", description=__doc__)
+    parser.add_argument("srcdir", help="预处理后的 performance 测例目录")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task1_exe", help="实验一程序路径")
+    parser.add_argument("--repeat", type=int, default=10, help="拼接的遍数")
+    parser.add_argument("--runs", type=int, default=3, help="运行次数，取最快一次")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    names = sorted(n for n in os.listdir(args.srcdir) if n.endswith(".sysu.c"))
+    if not names:
+        print("没有找到预处理后的测例：", args.srcdir)
+        sys.exit(1)
+
+    input_path = osp.join(args.bindir, "bench-input.sysu.c")
+    output_path = osp.join(args.bindir, "bench-output.txt")
+    with open(input_path, "wb") as out:
+        for _ in range(args.repeat):
+            for name in names:
+                with open(osp.join(args.srcdir, name), "rb") as f:
+                    out.write(f.read())
+    print("输入：", input_path, osp.getsize(input_path), "字节")
+
+    best = None
+    for _ in range(args.runs):
+        start = time.perf_counter()
+        subps.run(
+            [args.task1_exe, input_path, output_path],
+            stdout=subps.DEVNULL,
+            check=True,
+        )
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+
+    with open(output_path, "rb") as f:
+        tokens = sum(1 for _ in f)
+
+    print(f"词法单元：{tokens}")
+    print(f"耗时：{best * 1000:.1f} ms")
+    print(f"吞吐量：{tokens / best:,.0f} 词法单元/秒")
@@ -0,0 +1,175 @@
+// 测量 Obj::Mgr::gc 在百万结点的对象图上的耗时。标记阶段改用显式标记栈之前
+// 是递归标记，深链在默认的栈空间下会直接栈溢出。
+//
+// 用法：task2-bench-gc [结点数]
+// 深链：每个结点只引用下一个结点，嵌套深度等于结点数；
+// 宽图：每个结点挂在之前随机一个结点下面，深度只有对数级，但遍历顺序与分配
+// 顺序无关，访存是分散的。
+//
+// 最后在宽图上检查新生代回收：全量回收把宽图晋升为老对象之后，新分配一批
+// 结点，一半经由写屏障写进老结点的字段，其中又有一些再挂着新结点，另一半
+// 是垃圾。新生代回收必须保留前者、只释放后者，并且不动老对象中的垃圾，留给
+// 随后的全量回收；它只扫描记忆集，耗时应与老对象的个数无关。存活和释放的
+// 个数不符时返回 1。
+
+#include "Obj.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Node : Obj
+{
+  Node* mNext{ nullptr };
+  std::vector<Node*> mKids;
+
+private:
+  void __mark__(Mark mark) override
+  {
+    mark(mNext);
+    for (auto kid : mKids)
+      mark(kid);
+  }
+};
+
+Node*
+chain(Obj::Mgr& mgr, std::size_t n)
+{
+  Node* head = nullptr;
+  for (std::size_t i = 0; i < n; ++i) {
+    auto node = mgr.make<Node>();
+    node->mNext = head, head = node;
+  }
+  return head;
+}
+
+/// 建成宽图，全部结点按分配的顺序放进 \p nodes
+void
+wide(Obj::Mgr& mgr, std::size_t n, std::vector<Node*>& nodes)
+{
+  std::mt19937_64 rng(0);
+  nodes.reserve(n);
+  nodes.push_back(mgr.make<Node>());
+  for (std::size_t i = 1; i < n; ++i) {
+    auto node = mgr.make<Node>();
+    nodes[rng() % i]->mKids.push_back(node);
+    nodes.push_back(node);
+  }
+}
+
+Node*
+wide(Obj::Mgr& mgr, std::size_t n)
+{
+  std::vector<Node*> nodes;
+  wide(mgr, n, nodes);
+  return nodes[0];
+}
+
+/// 在 \p build 建成的全部存活的图上回收 \p repeat 次，返回最快一次的毫秒数
+template<typename F>
+double
+measure(std::size_t n, int repeat, F&& build)
+{
+  using Clock = std::chrono::steady_clock;
+  Obj::Mgr mgr;
+  mgr.mRoot = build(mgr, n);
+
+  double best = 0;
+  for (int i = 0; i < repeat; ++i) {
+    auto begin = Clock::now();
+    mgr.gc();
+    auto ms = std::chrono::duration<double, std::milli>(Clock::now() - begin)
+                .count();
+    if (i == 0 || ms < best)
+      best = ms;
+  }
+  return best;
+}
+
+/// 检查新生代回收和全量回收的存活个数，并比较两者的耗时
+bool
+check_young(std::size_t n)
+{
+  using Clock = std::chrono::steady_clock;
+  auto since = [](Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin)
+      .count();
+  };
+
+  bool ok = true;
+  auto expect = [&](const char* what, std::size_t got, std::size_t want) {
+    if (got != want) {
+      std::printf("不符：%s为 %zu，应为 %zu\n", what, got, want);
+      ok = false;
+    }
+  };
+
+  // 根下挂着宽图和一条老的短链，短链随后会被摘掉成为老对象中的垃圾
+  Obj::Mgr mgr;
+  auto root = mgr.make<Node>();
+  mgr.mRoot = root;
+  std::vector<Node*> olds;
+  wide(mgr, n, olds);
+  root->mNext = olds[0];
+  std::size_t nOldChain = n / 100;
+  root->mKids.push_back(chain(mgr, nOldChain));
+  std::size_t nOld = 1 + n + nOldChain;
+  expect("首次全量回收后的存活数", mgr.gc().mLive, nOld);
+
+  std::mt19937_64 rng(1);
+  std::size_t nYoung = n / 10, nLive = 0, nDead = 0;
+  for (std::size_t i = 0; i < nYoung; ++i) {
+    auto node = mgr.make<Node>();
+    auto old = olds[rng() % olds.size()];
+    if (i % 2 == 0) {
+      old->mKids.push_back(node), mgr.write_barrier(old, node), ++nLive;
+      if (i % 4 == 0) // 只能经由新结点到达的新结点
+        node->mNext = mgr.make<Node>(), ++nLive;
+    } else
+      node->mNext = old, ++nDead; // 垃圾引用老对象，不应让任何东西存活
+  }
+
+  auto begin = Clock::now();
+  auto stats = mgr.gc_young();
+  auto youngMs = since(begin);
+  expect("新生代回收的新分配数", stats.mAllocated, nLive + nDead);
+  expect("新生代回收的遍历数", stats.mTraced, 1 + nLive);
+  expect("新生代回收的释放数", stats.mFreed, nDead);
+  expect("新生代回收后的存活数", stats.mLive, nOld + nLive);
+  if (!ok) // 错放了存活的新结点时，老结点里已经是悬空指针，不能再回收
+    return false;
+
+  // 老对象中的垃圾只有全量回收才会释放
+  root->mKids.clear();
+  expect("新生代回收释放老对象", mgr.gc_young().mFreed, 0);
+  begin = Clock::now();
+  stats = mgr.gc();
+  auto fullMs = since(begin);
+  expect("全量回收的释放数", stats.mFreed, nOldChain);
+  expect("全量回收后的存活数", stats.mLive, nOld - nOldChain + nLive);
+
+  std::printf("新生代回收：%.1f ms，全量回收：%.1f ms\n", youngMs, fullMs);
+  return ok;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  std::printf("结点数：%zu\n", n);
+
+  auto chainMs = measure(n, 5, chain);
+  std::printf("深链：%.1f ms，%.1f ns/结点\n", chainMs, chainMs * 1e6 / n);
+
+  auto wideMs = measure(n, 5, [](Obj::Mgr& mgr, std::size_t n) {
+    return wide(mgr, n);
+  });
+  std::printf("宽图：%.1f ms，%.1f ns/结点\n", wideMs, wideMs * 1e6 / n);
+
+  return check_young(n) ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// 比较按名字查词法单元种类的两种做法：改用 TokenKinds.hpp 的完美散列之前，
+// 前端每行先 sscanf 出名字再查 std::unordered_map<std::string, int>。
+//
+// 用法：task2-bench-tokens <目录或词法单元转储文件>...
+// 目录会被递归搜索其中的 answer.txt；不给参数时轮流查所有种类的名字。
+
+#include "TokenKinds.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void
+load(const fs::path& path, std::vector<std::string>& names)
+{
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line))
+    names.push_back(line.substr(0, line.find(' ')));
+}
+
+/// 重复查找直到累计约 0.5 秒，返回每次查找的纳秒数
+template<typename F>
+double
+measure(const std::vector<std::string>& names, F&& f)
+{
+  using Clock = std::chrono::steady_clock;
+  std::size_t count = 0, sink = 0;
+  auto begin = Clock::now();
+  Clock::duration elapsed{};
+  do {
+    for (auto& name : names)
+      sink += f(name);
+    count += names.size();
+    elapsed = Clock::now() - begin;
+  } while (elapsed < std::chrono::milliseconds(500));
+
+  // 防止查找被整个优化掉
+  static volatile std::size_t sSink;
+  sSink = sink;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  std::vector<std::string> names;
+  for (int i = 1; i < argc; ++i) {
+    if (fs::is_directory(argv[i])) {
+      for (auto& entry : fs::recursive_directory_iterator(argv[i]))
+        if (entry.path().filename() == "answer.txt")
+          load(entry.path(), names);
+    } else
+      load(argv[i], names);
+  }
+  if (names.empty())
+    for (std::size_t i = 1; i < tok::kNumKinds; ++i)
+      names.emplace_back(tok::kInfos[i].name);
+  std::cout << "词法单元：" << names.size() << '\n';
+
+  std::unordered_map<std::string, int> map;
+  for (std::size_t i = 1; i < tok::kNumKinds; ++i)
+    map.emplace(tok::kInfos[i].name, int(i));
+
+  auto mapNs = measure(names, [&](const std::string& name) {
+    char buf[64];
+    std::sscanf(name.c_str(), "%63s", buf);
+    auto iter = map.find(buf);
+    return iter == map.end() ? 0 : iter->second;
+  });
+
+  auto findNs = measure(names, [&](const std::string& name) {
+    auto iter = map.find(name);
+    return iter == map.end() ? 0 : iter->second;
+  });
+
+  auto hashNs = measure(names, [](const std::string& name) {
+    return int(tok::from_name(name));
+  });
+
+  std::printf("sscanf + unordered_map：%.1f ns/词法单元\n", mapNs);
+  std::printf("只查 unordered_map：%.1f ns/词法单元\n", findNs);
+  std::printf("完美散列：%.1f ns/词法单元\n", hashNs);
+}
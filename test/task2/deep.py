@@ -0,0 +1,170 @@
+"""深层嵌套输入的压力测试：生成嵌套极深或者极宽的程序，直接写成实验二输入的
+词法单元格式，在调小了栈空间的进程里逐个分析，要求都能成功输出，且输出的结点数
+与生成时一致。各个阶段用显式栈遍历语义图之后，原生栈的深度不再随嵌套加深。
+
+生成的程序只用到两种语法分析器都支持的语法：加减、取负、赋值、逗号、代码块和
+初始化列表。ANTLR 生成的是递归下降的语法分析器，分析本身就会随嵌套加深而占用
+原生栈，不在本测试的范围之内。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import re
+import resource
+import subprocess as subps
+import time
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+NAMES = {
+    "int": "int",
+    "return": "return",
+    "(": "l_paren",
+    ")": "r_paren",
+    "{": "l_brace",
+    "}": "r_brace",
+    "[": "l_square",
+    "]": "r_square",
+    ";": "semi",
+    ",": "comma",
+    "=": "equal",
+    "+": "plus",
+    "-": "minus",
+}
+
+TOKEN = re.compile(r"[A-Za-z_]\w*|\d+|\S")
+
+
+def write_tokens(path, lines):
+    """把源代码逐行切成词法单元，按 clang -dump-tokens 的格式写出"""
+
+    fname = osp.basename(path)[: -len(".txt")] + ".c"
+    with open(path, "w", encoding="utf-8") as f:
+        for row, line in enumerate(lines, 1):
+            end = 0
+            for k, m in enumerate(TOKEN.finditer(line)):
+                text = m.group()
+                if text in NAMES:
+                    name = NAMES[text]
+                elif text[0].isdigit():
+                    name = "numeric_constant"
+                else:
+                    name = "identifier"
+                flags = ""
+                if k == 0:
+                    flags += "\t[StartOfLine]"
+                if m.start() > end:
+                    flags += "\t[LeadingSpace]"
+                f.write(f"{name} '{text}'{flags}\tLoc=<{fname}:{row}:{m.start() + 1}>\n")
+                end = m.end()
+        f.write(f"eof ''\t\tLoc=<{fname}:{len(lines) + 1}:1>\n")
+
+
+def cases(n):
+    """生成各个测例，返回 (名字, 源代码行, {结点种类: 个数})"""
+
+    # 左结合的加减，语法分析栈很浅，语义图却有 n 层
+    terms = " ".join(("+ 1" if i % 2 else "- 1") for i in range(n))
+    yield (
+        "add",
+        ["int main() {", f"  return 1 {terms};", "}"],
+        {"BinaryOperator": n, "IntegerLiteral": n + 1},
+    )
+
+    # 逗号也是左结合的
+    yield (
+        "comma",
+        ["int main() {", "  return 1" + ", 1" * n + ";", "}"],
+        {"BinaryOperator": n, "IntegerLiteral": n + 1},
+    )
+
+    # 右结合的赋值和取负
+    yield (
+        "assign",
+        ["int main() {", "  int a;", "  a" + " = a" * n + " = 1;", "  return a;", "}"],
+        {"BinaryOperator": n + 1},
+    )
+    yield (
+        "neg",
+        ["int main() {", "  return" + " -" * n + " 1;", "}"],
+        {"UnaryOperator": n},
+    )
+
+    # 层层嵌套的代码块
+    yield (
+        "block",
+        ["int main() {"] + ["{"] * n + ["}"] * n + ["  return 0;", "}"],
+        {"CompoundStmt": n + 1},
+    )
+
+    # 很宽的初始化列表
+    yield (
+        "init",
+        [f"int a[{n}] = {{" + ", ".join(str(i % 10) for i in range(n)) + "};",
+         "int main() {", "  return 0;", "}"],
+        {"InitListExpr": 1, "IntegerLiteral": n + 1},
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验二深层嵌套测试", description=__doc__)
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task2_exe", help="实验二程序路径")
+    parser.add_argument("--depth", type=int, default=100000, help="嵌套深度")
+    parser.add_argument(
+        "--stack", type=int, default=1024, help="分析时的栈空间上限（KiB）"
+    )
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    workdir = osp.join(args.bindir, "deep")
+    os.makedirs(workdir, exist_ok=True)
+
+    def limit_stack():
+        limit = args.stack * 1024
+        resource.setrlimit(resource.RLIMIT_STACK, (limit, limit))
+
+    failed = 0
+    for name, lines, expect in cases(args.depth):
+        input = osp.join(workdir, name + ".txt")
+        output = osp.join(workdir, name + ".json")
+        write_tokens(input, lines)
+        if osp.exists(output):
+            os.remove(output)
+
+        start = time.perf_counter()
+        p = subps.run(
+            [args.task2_exe, input, output],
+            stdout=subps.DEVNULL,
+            stderr=subps.DEVNULL,
+            preexec_fn=limit_stack,
+            check=False,
+        )
+        elapsed = time.perf_counter() - start
+
+        if p.returncode != 0 or not osp.exists(output):
+            print(f"失败[{name}]：返回值 {p.returncode}")
+            failed += 1
+            continue
+
+        # 输出嵌套很深，不用 json 模块解析，直接数各种结点出现的次数
+        with open(output, "r", encoding="utf-8") as f:
+            text = f.read()
+        counts = {kind: text.count(f'"kind":"{kind}"') for kind in expect}
+        wrong = [
+            f"{kind} {counts[kind]}/{count}"
+            for kind, count in expect.items()
+            if counts[kind] != count
+        ]
+        if wrong:
+            print(f"不一致[{name}]：", "，".join(wrong))
+            failed += 1
+            continue
+
+        print(f"通过[{name}]：{elapsed * 1000:.1f} ms")
+
+    print(f"失败：{failed}")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,86 @@
+"""批量模式的多文件测试：生成比文件号能表示的文件数（64）更多的小程序，各自的
+文件名都不同，先逐个用实验二的程序分析，再写成一份清单在一个进程里批量分析，
+分别用 1 个和多个线程（环境变量 YATCC_JOBS），要求每个文件的退出状态和输出的
+语义图都与逐个分析时逐字节相同。
+
+其中夹着一个类型检查时会 ABORT 的文件：逐个分析时它必须失败，批量分析时只有
+它失败，进程返回 1，其它文件照常输出。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import filecmp
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+from deep import write_tokens
+from parallel import program
+
+# 有返回值的函数里 return 不带表达式，类型检查时 ABORT
+BAD_PROGRAM = ["int main() {", "  return;", "}"]
+
+
+def batch(task2_exe, manifest, pairs, jobs):
+    with open(manifest, "w", encoding="utf-8") as f:
+        for input, output in pairs:
+            f.write(f"{input} {output}\n")
+    env = dict(os.environ, YATCC_JOBS=str(jobs))
+    return subps.run(
+        [task2_exe, "@" + manifest], env=env, capture_output=True, check=False
+    ).returncode
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验二批量模式多文件测试", description=__doc__)
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task2_exe", help="实验二程序路径")
+    parser.add_argument("--files", type=int, default=100, help="文件个数")
+    parser.add_argument(
+        "--jobs", type=int, default=2 * (os.cpu_count() or 1), help="线程数"
+    )
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    outdir = osp.join(args.bindir, "many")
+    os.makedirs(outdir, exist_ok=True)
+
+    # 文件名取自输入的路径，各不相同
+    inputs = []
+    bad = args.files // 2
+    for i in range(args.files):
+        input = osp.join(outdir, f"f{i}.txt")
+        write_tokens(input, BAD_PROGRAM if i == bad else program(3, seed=i))
+        inputs.append(input)
+
+    failed = 0
+    for i, input in enumerate(inputs):
+        p = subps.run(
+            [args.task2_exe, input, osp.join(outdir, f"{i}.ref.json")],
+            capture_output=True,
+            check=False,
+        )
+        if (p.returncode != 0) != (i == bad):
+            print(f"逐个分析返回 {p.returncode}：", input)
+            failed += 1
+
+    for jobs in (1, args.jobs):
+        pairs = [
+            (x, osp.join(outdir, f"{i}.{jobs}.json")) for i, x in enumerate(inputs)
+        ]
+        code = batch(args.task2_exe, osp.join(outdir, f"{jobs}.txt"), pairs, jobs)
+        if code != 1:
+            print(f"{jobs} 线程批量分析返回 {code}，应为 1")
+            failed += 1
+        for i, (input, output) in enumerate(pairs):
+            if i == bad:
+                continue
+            ref = osp.join(outdir, f"{i}.ref.json")
+            if not osp.exists(output) or not filecmp.cmp(ref, output, shallow=False):
+                print(f"不一致（{jobs} 线程）：", input)
+                failed += 1
+
+    print(f"{args.files} 个文件，不一致：{failed}")
+    sys.exit(1 if failed else 0)
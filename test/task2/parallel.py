@@ -0,0 +1,98 @@
+"""按函数并行的类型检查测试：生成一个有很多函数的程序，直接写成实验二输入的词法
+单元格式，分别用 1 个和多个线程（环境变量 YATCC_FUNC_JOBS）分析，要求输出的
+语义图逐字节相同，并比较两者类型检查阶段的耗时。
+
+生成的程序只用到两种语法分析器都支持的语法。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import random
+import re
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+from deep import write_tokens
+
+ELAPSED = re.compile(r"耗时\[类型检查\]：([\d.]+) ms")
+
+
+def program(nfuncs, seed=0):
+    """生成有 nfuncs 个函数的程序，函数体引用在它之前定义的全局变量"""
+
+    r = random.Random(seed)
+    lines = []
+    names = []
+    for i in range(nfuncs):
+        lines.append(f"int g{i} = {r.randint(0, 99)};")
+        lines.append(f"int a{i}[4] = {{{r.randint(0, 9)}, {r.randint(0, 9)}}};")
+        names.append(f"g{i}")
+        lines.append(f"int f{i}(int p, int q) {{")
+        lines.append("  int x = p + q, y;")
+        lines.append(f"  int t[{r.randint(1, 8)}] = {{1, 2}};")
+        for _ in range(r.randint(4, 40)):
+            terms = " ".join(
+                r.choice(["x", "y", "p", "q", r.choice(names), str(r.randint(1, 9))])
+                + r.choice([" +", " -"])
+                for _ in range(r.randint(1, 6))
+            )
+            lines.append(f"  y = {terms} - x;")
+            lines.append(f"  x = y, y = -{r.choice(names)};")
+        lines.append("  return x + y;")
+        lines.append("}")
+    lines.append("int main() {")
+    lines.append("  return 0;")
+    lines.append("}")
+    return lines
+
+
+def run(task2_exe, input, output, jobs):
+    """返回类型检查的耗时（毫秒）"""
+
+    env = dict(os.environ, YATCC_FUNC_JOBS=str(jobs))
+    p = subps.run(
+        [task2_exe, input, output], env=env, capture_output=True, text=True, check=False
+    )
+    m = ELAPSED.search(p.stdout)
+    if p.returncode != 0 or m is None:
+        print(f"失败[{jobs} 线程]：返回值 {p.returncode}")
+        sys.exit(1)
+    return float(m.group(1))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验二按函数并行测试", description=__doc__)
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task2_exe", help="实验二程序路径")
+    parser.add_argument("--funcs", type=int, default=4000, help="函数个数")
+    parser.add_argument("--repeat", type=int, default=3, help="重复次数，取最快的一次")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="线程数")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    workdir = osp.join(args.bindir, "parallel")
+    os.makedirs(workdir, exist_ok=True)
+    input = osp.join(workdir, "funcs.txt")
+    write_tokens(input, program(args.funcs))
+
+    outputs = {}
+    for jobs in sorted({1, args.jobs}):
+        output = osp.join(workdir, f"funcs.{jobs}.json")
+        best = min(run(args.task2_exe, input, output, jobs) for _ in range(args.repeat))
+        outputs[jobs] = output
+        print(f"{jobs} 线程：类型检查 {best:.1f} ms")
+        if jobs == 1:
+            serial = best
+        else:
+            print(f"加速比：{serial / best:.2f}")
+
+    with open(outputs[1], "rb") as f:
+        expect = f.read()
+    with open(outputs[args.jobs], "rb") as f:
+        if f.read() != expect:
+            print("不一致：并行与串行输出的语义图不同")
+            sys.exit(1)
+    print("一致")
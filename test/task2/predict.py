@@ -0,0 +1,89 @@
+"""比较 ANTLR 实现的两种预测策略：只用 LL 和先 SLL 后 LL。
+
+每个输入单独起一个进程分析，与评测时一样每次都从冷启动开始，统计程序报告的
+“语法分析”耗时之和。先 SLL 后 LL 时的输出须与只用 LL 时逐字节相同。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import filecmp
+import re
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+PARSE_TIME = re.compile(r"耗时\[语法分析\]：([0-9.e+-]+) ms")
+
+
+def run(task2_exe, inputs, outdir, env_value):
+    """逐个分析 inputs，返回语法分析总耗时（毫秒）和退回 LL 的文件数"""
+
+    env = dict(os.environ, YATCC_ANTLR=env_value)
+    total, fell_back = 0.0, 0
+    for i, x in enumerate(inputs):
+        p = subps.run(
+            [task2_exe, x, osp.join(outdir, f"{i}.json")],
+            env=env,
+            stdout=subps.PIPE,
+            stderr=subps.DEVNULL,
+            text=True,
+            check=False,
+        )
+        m = PARSE_TIME.search(p.stdout)
+        if m:
+            total += float(m.group(1))
+        if "改用 LL" in p.stdout:
+            fell_back += 1
+    return total, fell_back
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验二预测策略对比", description=__doc__)
+    parser.add_argument("manifest", help="task2-batch 使用的清单")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task2_exe", help="实验二程序路径")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    with open(args.manifest, "r", encoding="utf-8") as f:
+        inputs = [
+            line.split()[0] for line in f if line.strip() and line[0] != "#"
+        ]
+    if not inputs:
+        print("清单为空：", args.manifest)
+        sys.exit(1)
+
+    workdir = osp.join(args.bindir, "predict")
+    os.makedirs(workdir, exist_ok=True)
+
+    configs = [("LL", "ll"), ("SLL+LL", "")]
+
+    results = []
+    for name, value in configs:
+        outdir = osp.join(workdir, str(len(results)))
+        os.makedirs(outdir, exist_ok=True)
+        total, fell_back = run(args.task2_exe, inputs, outdir, value)
+        results.append((name, outdir, total, fell_back))
+
+    failed = 0
+    base_dir = results[0][1]
+    for name, outdir, _, _ in results[1:]:
+        for i, x in enumerate(inputs):
+            base = osp.join(base_dir, f"{i}.json")
+            out = osp.join(outdir, f"{i}.json")
+            if osp.exists(base) and not (
+                osp.exists(out) and filecmp.cmp(base, out, shallow=False)
+            ):
+                print(f"不一致[{name}]：", x)
+                failed += 1
+
+    base_total = results[0][2]
+    print(f"{len(inputs)} 个文件，每个文件一个进程，语法分析耗时之和：")
+    for name, _, total, fell_back in results:
+        speedup = base_total / total if total > 0 else 0.0
+        print(f"  {name:<8}{total:10.1f} ms  {speedup:5.2f}x  退回 LL {fell_back} 次")
+    print(f"不一致：{failed}")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,80 @@
+"""并发压力测试：先用单个线程分析清单里的全部输入，得到参考输出；再把每个输入
+重复多遍，用多个线程在同一个进程里同时分析，要求每一份输出的语义图（JSON）都与
+参考输出逐字节相同。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import filecmp
+import subprocess as subps
+import time
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+
+def run(task2_exe, manifest, pairs, jobs):
+    """把 pairs 写成清单交给实验二的程序，返回耗时（秒）"""
+
+    with open(manifest, "w", encoding="utf-8") as f:
+        for input, output in pairs:
+            f.write(f"{input} {output}\n")
+
+    env = dict(os.environ, YATCC_JOBS=str(jobs))
+    start = time.perf_counter()
+    subps.run([task2_exe, "@" + manifest], env=env, check=False)
+    return time.perf_counter() - start
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验二并发压力测试", description=__doc__)
+    parser.add_argument("manifest", help="task2-batch 使用的清单")
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task2_exe", help="实验二程序路径")
+    parser.add_argument("--repeat", type=int, default=4, help="每个输入分析的遍数")
+    parser.add_argument(
+        "--jobs", type=int, default=2 * (os.cpu_count() or 1), help="线程数"
+    )
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    with open(args.manifest, "r", encoding="utf-8") as f:
+        inputs = [
+            line.split()[0] for line in f if line.strip() and line[0] != "#"
+        ]
+    if not inputs:
+        print("清单为空：", args.manifest)
+        sys.exit(1)
+
+    outdir = osp.join(args.bindir, "stress")
+    os.makedirs(outdir, exist_ok=True)
+
+    ref = [(x, osp.join(outdir, f"{i}.ref.json")) for i, x in enumerate(inputs)]
+    elapsed = run(args.task2_exe, osp.join(outdir, "ref.txt"), ref, 1)
+    print(f"单线程：{len(ref)} 个文件，{elapsed * 1000:.1f} ms")
+
+    # 交错排列，让同一个输入的多遍分析落在不同的线程上
+    pairs = []
+    for r in range(args.repeat):
+        for i, x in enumerate(inputs):
+            pairs.append((x, osp.join(outdir, f"{i}.{r}.json")))
+    elapsed = run(args.task2_exe, osp.join(outdir, "stress.txt"), pairs, args.jobs)
+    print(f"{args.jobs} 线程：{len(pairs)} 个文件，{elapsed * 1000:.1f} ms")
+
+    failed = 0
+    for r in range(args.repeat):
+        for i, x in enumerate(inputs):
+            ref_path = ref[i][1]
+            out_path = osp.join(outdir, f"{i}.{r}.json")
+            if not osp.exists(ref_path):
+                continue  # 单线程时就分析失败的输入，不算在并发问题里
+            if not osp.exists(out_path) or not filecmp.cmp(
+                ref_path, out_path, shallow=False
+            ):
+                print("不一致：", x, out_path)
+                failed += 1
+
+    print(f"不一致：{failed}")
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,85 @@
+"""比较语义图的两种布局：对清单里 performance/ 下的测例逐个运行实验三，由环境变量
+YATCC_COMPACT 让它把读入的语义图再拷成紧凑布局，打印两种布局每个结点平均占用的
+内存和遍历一遍的耗时，最后汇总。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import re
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+LAYOUT = re.compile(
+    r"布局\[(\S+)\]：(\d+) 个结点，(\d+) 字节，平均 [\d.e+-]+ 字节/结点，"
+    r"遍历 ([\d.e+-]+) ms"
+)
+
+
+def measure(task3_exe, input, output):
+    """返回 {布局: (结点数, 字节数, 遍历毫秒数)}，失败时返回空"""
+
+    env = dict(os.environ, YATCC_COMPACT="1")
+    p = subps.run(
+        [task3_exe, input, output], env=env, capture_output=True, text=True, check=False
+    )
+    return {
+        m.group(1): (int(m.group(2)), int(m.group(3)), float(m.group(4)))
+        for m in LAYOUT.finditer(p.stdout)
+    }
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验三语义图布局比较", description=__doc__)
+    parser.add_argument("manifest", help="task3-batch 使用的清单")
+    parser.add_argument("task3_exe", help="实验三程序路径")
+    parser.add_argument("--filter", default="performance/", help="只看路径含此串的测例")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    with open(args.manifest, "r", encoding="utf-8") as f:
+        pairs = [
+            line.split()
+            for line in f
+            if line.strip() and line[0] != "#" and args.filter in line
+        ]
+    if not pairs:
+        print("没有要比较的测例：", args.manifest)
+        sys.exit(1)
+
+    total = {}
+    print(f"{'测例':<40}{'结点':>10}{'指针 B/结点':>14}{'紧凑 B/结点':>14}"
+          f"{'指针 ms':>10}{'紧凑 ms':>10}")
+    for input, output in pairs:
+        name = osp.relpath(osp.dirname(output), osp.dirname(args.manifest))
+        res = measure(args.task3_exe, input, output)
+        if set(res) != {"指针", "紧凑"}:
+            print(f"{name:<40}失败")
+            continue
+        nodes = res["指针"][0]
+        for layout, (n, b, ms) in res.items():
+            t = total.setdefault(layout, [0, 0, 0.0])
+            t[0] += n
+            t[1] += b
+            t[2] += ms
+        print(
+            f"{name:<40}{nodes:>10}"
+            f"{res['指针'][1] / nodes:>14.1f}{res['紧凑'][1] / nodes:>14.1f}"
+            f"{res['指针'][2]:>10.3f}{res['紧凑'][2]:>10.3f}"
+        )
+
+    if not total:
+        sys.exit(1)
+    nodes = total["指针"][0]
+    print(
+        f"{'合计':<40}{nodes:>10}"
+        f"{total['指针'][1] / nodes:>14.1f}{total['紧凑'][1] / nodes:>14.1f}"
+        f"{total['指针'][2]:>10.3f}{total['紧凑'][2]:>10.3f}"
+    )
+    print(
+        f"内存降为 {total['紧凑'][1] / total['指针'][1]:.0%}，"
+        f"遍历快 {total['指针'][2] / total['紧凑'][2]:.2f} 倍"
+    )
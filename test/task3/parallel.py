@@ -0,0 +1,193 @@
+"""按函数并行的 IR 生成测试：生成一个有很多函数的程序，写成 clang 语义图 JSON
+的格式作为实验三的输入，分别用 1 个和多个线程（环境变量 YATCC_FUNC_JOBS）生成
+IR，要求输出的 .ll 逐字节相同，并比较两者生成 IR 阶段的耗时和整个进程的墙钟
+时间。并行要把各线程的模块写成 bitcode 再读回主线程，只有一个核时只会更慢。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import itertools
+import json
+import random
+import re
+import subprocess as subps
+import time
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+from common import print_parsed_args
+
+ELAPSED = re.compile(r"耗时\[生成 IR\]：([\d.]+) ms")
+
+
+class Builder:
+    """按 clang -ast-dump=json 的格式构造结点，只填实验三用到的键"""
+
+    def __init__(self):
+        self.ids = itertools.count(0x1000, 0x10)
+
+    def node(self, kind, inner=None, **kw):
+        n = {"id": hex(next(self.ids)), "kind": kind, **kw}
+        if inner is not None:
+            n["inner"] = inner
+        return n
+
+    def lit(self, v):
+        return self.node(
+            "IntegerLiteral",
+            type={"qualType": "int"},
+            valueCategory="prvalue",
+            value=str(v),
+        )
+
+    def ref(self, decl):
+        return self.node(
+            "DeclRefExpr",
+            type=decl["type"],
+            valueCategory="lvalue",
+            referencedDecl={k: decl[k] for k in ("id", "kind", "name", "type")},
+        )
+
+    def rvalue(self, expr):
+        return self.node(
+            "ImplicitCastExpr",
+            [expr],
+            type=expr["type"],
+            valueCategory="prvalue",
+            castKind="LValueToRValue",
+        )
+
+    def binop(self, op, lft, rht, cat="prvalue"):
+        return self.node(
+            "BinaryOperator",
+            [lft, rht],
+            type={"qualType": "int"},
+            valueCategory=cat,
+            opcode=op,
+        )
+
+    def call(self, func, args):
+        fty = func["type"]["qualType"]
+        ptr = fty.replace(" (", " (*)(", 1)
+        callee = self.node(
+            "ImplicitCastExpr",
+            [self.ref(func)],
+            type={"qualType": ptr},
+            valueCategory="prvalue",
+            castKind="FunctionToPointerDecay",
+        )
+        return self.node(
+            "CallExpr",
+            [callee, *args],
+            type={"qualType": fty.split(" ", 1)[0]},
+            valueCategory="prvalue",
+        )
+
+
+def program(nfuncs, seed=0):
+    """生成有 nfuncs 个函数的翻译单元，每个函数读写全局变量、循环并调用之前的函数"""
+
+    r = random.Random(seed)
+    b = Builder()
+    decls = []
+    funcs = []
+    for i in range(nfuncs):
+        g = b.node(
+            "VarDecl", [b.lit(r.randint(0, 99))], name=f"g{i}", type={"qualType": "int"}
+        )
+        decls.append(g)
+
+        p = b.node("ParmVarDecl", name="p", type={"qualType": "int"})
+        q = b.node("ParmVarDecl", name="q", type={"qualType": "int"})
+        x = b.node(
+            "VarDecl",
+            [b.binop("+", b.rvalue(b.ref(p)), b.rvalue(b.ref(q)))],
+            name="x",
+            type={"qualType": "int"},
+        )
+        body = [b.node("DeclStmt", [x])]
+        for _ in range(r.randint(4, 40)):
+            rht = b.binop("-", b.rvalue(b.ref(x)), b.lit(r.randint(1, 9)))
+            body.append(b.binop("=", b.ref(x), rht, "lvalue"))
+            body.append(b.binop("=", b.ref(g), b.rvalue(b.ref(x)), "lvalue"))
+        cond = b.binop(">", b.rvalue(b.ref(x)), b.lit(r.randint(0, 9)))
+        dec = b.binop("=", b.ref(x), b.binop("-", b.rvalue(b.ref(x)), b.lit(1)), "lvalue")
+        body.append(b.node("WhileStmt", [cond, b.node("CompoundStmt", [dec])]))
+        if funcs:
+            callee = r.choice(funcs)
+            body.append(b.call(callee, [b.rvalue(b.ref(x)), b.rvalue(b.ref(g))]))
+        body.append(b.node("ReturnStmt", [b.rvalue(b.ref(x))]))
+
+        f = b.node(
+            "FunctionDecl",
+            [p, q, b.node("CompoundStmt", body)],
+            name=f"f{i}",
+            type={"qualType": "int (int, int)"},
+        )
+        decls.append(f)
+        funcs.append(f)
+
+    main = b.node(
+        "FunctionDecl",
+        [b.node("CompoundStmt", [b.node("ReturnStmt", [b.lit(0)])])],
+        name="main",
+        type={"qualType": "int ()"},
+    )
+    decls.append(main)
+    return b.node("TranslationUnitDecl", decls)
+
+
+def run(task3_exe, input, output, jobs):
+    """返回生成 IR 的耗时和整个进程的墙钟时间（毫秒）"""
+
+    env = dict(os.environ, YATCC_FUNC_JOBS=str(jobs))
+    begin = time.perf_counter()
+    p = subps.run(
+        [task3_exe, input, output], env=env, capture_output=True, text=True, check=False
+    )
+    wall = (time.perf_counter() - begin) * 1000
+    m = ELAPSED.search(p.stdout)
+    if p.returncode != 0 or m is None:
+        print(f"失败[{jobs} 线程]：返回值 {p.returncode}")
+        sys.exit(1)
+    return float(m.group(1)), wall
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("实验三按函数并行测试", description=__doc__)
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("task3_exe", help="实验三程序路径")
+    parser.add_argument("--funcs", type=int, default=4000, help="函数个数")
+    parser.add_argument("--repeat", type=int, default=3, help="重复次数，取最快的一次")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="线程数")
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    workdir = osp.join(args.bindir, "parallel")
+    os.makedirs(workdir, exist_ok=True)
+    input = osp.join(workdir, "funcs.json")
+    with open(input, "w", encoding="utf-8") as f:
+        json.dump(program(args.funcs), f)
+
+    print(f"CPU 核数：{os.cpu_count()}")
+    outputs = {}
+    for jobs in sorted({1, args.jobs}):
+        output = osp.join(workdir, f"funcs.{jobs}.ll")
+        times = [run(args.task3_exe, input, output, jobs) for _ in range(args.repeat)]
+        best = min(t[0] for t in times)
+        wall = min(t[1] for t in times)
+        outputs[jobs] = output
+        print(f"{jobs} 线程：生成 IR {best:.1f} ms，墙钟 {wall:.1f} ms")
+        if jobs == 1:
+            serial, serialWall = best, wall
+        else:
+            print(f"加速比：生成 IR {serial / best:.2f}，墙钟 {serialWall / wall:.2f}")
+
+    with open(outputs[1], "rb") as f:
+        expect = f.read()
+    with open(outputs[args.jobs], "rb") as f:
+        if f.read() != expect:
+            print("不一致：并行与串行输出的 IR 不同")
+            sys.exit(1)
+    print("一致")
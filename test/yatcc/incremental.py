@@ -0,0 +1,122 @@
+"""增量编译测试：生成一个有很多函数的程序，用 yatcc 依次在下面几种情形下编译，
+要求用了缓存的输出与不用缓存时逐字节相同，命中和未命中的函数个数符合预期，并比较
+各情形的耗时：
+
+- 不用缓存；
+- 冷启动：缓存目录是空的，全部未命中，编译完写入缓存；
+- 全部命中：源代码不变再编译一次；
+- 改动一个函数：只改中间一个函数的函数体，只有它未命中。
+
+耗时是 yatcc 打印的各阶段耗时之和，不含进程启动。
+"""
+
+import sys
+import os
+import os.path as osp
+import argparse
+import re
+import shutil
+import subprocess as subps
+
+sys.path.append(osp.abspath(__file__ + "/../.."))
+sys.path.append(osp.abspath(__file__ + "/../../task2"))
+from common import print_parsed_args
+from parallel import program
+
+ELAPSED = re.compile(r"耗时\[(.+?)\]：([\d.]+) ms")
+CACHE = re.compile(r"缓存：命中 (\d+) 个函数，未命中 (\d+) 个")
+
+
+def run(yatcc_exe, input, output, cache, extra):
+    """返回 (各阶段耗时之和, 命中数, 未命中数)，不用缓存时命中数为 None"""
+
+    cmd = [yatcc_exe, *extra, f"--cache={cache or ''}", input, output]
+    p = subps.run(cmd, capture_output=True, text=True, check=False)
+    if p.returncode != 0:
+        print(f"失败：{' '.join(cmd)} 返回 {p.returncode}")
+        print(p.stdout)
+        sys.exit(1)
+    total = sum(float(m.group(2)) for m in ELAPSED.finditer(p.stdout))
+    m = CACHE.search(p.stdout)
+    if m is None:
+        return total, None, None
+    return total, int(m.group(1)), int(m.group(2))
+
+
+def same(a, b):
+    with open(a, "rb") as fa, open(b, "rb") as fb:
+        return fa.read() == fb.read()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser("yatcc 增量编译测试", description=__doc__)
+    parser.add_argument("bindir", help="输出目录")
+    parser.add_argument("yatcc_exe", help="yatcc 程序路径")
+    parser.add_argument("--funcs", type=int, default=2000, help="函数个数")
+    parser.add_argument("--repeat", type=int, default=3, help="重复次数，取最快的一次")
+    parser.add_argument(
+        "--extra", default="", help="另外传给 yatcc 的选项，比如 -O0 或 -j4"
+    )
+    args = parser.parse_args()
+    print_parsed_args(parser, args)
+
+    workdir = osp.join(args.bindir, "incremental")
+    cache = osp.join(workdir, "cache")
+    os.makedirs(workdir, exist_ok=True)
+    shutil.rmtree(cache, ignore_errors=True)
+
+    lines = program(args.funcs)
+    input = osp.join(workdir, "funcs.sysu.c")
+    with open(input, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines) + "\n")
+
+    # 改动中间那个函数的返回值
+    edited_lines = list(lines)
+    target = f"int f{args.funcs // 2}(int p, int q) {{"
+    i = edited_lines.index("  return x + y;", edited_lines.index(target))
+    edited_lines[i] = "  return x + y + 1;"
+    edited = osp.join(workdir, "edited.sysu.c")
+    with open(edited, "w", encoding="utf-8") as f:
+        f.write("\n".join(edited_lines) + "\n")
+
+    extra = args.extra.split()
+    nfuncs = args.funcs + 1  # 还有 main
+    output = lambda name: osp.join(workdir, name + ".ll")
+
+    def best(input, name, cache):
+        res = [run(args.yatcc_exe, input, output(name), cache, extra)
+               for _ in range(args.repeat)]
+        return min(res)
+
+    # 冷启动只能跑一次，跑完缓存就有了
+    plain, _, _ = best(input, "plain", None)
+    cold = run(args.yatcc_exe, input, output("cold"), cache, extra)
+    warm = best(input, "warm", cache)
+    edited_plain, _, _ = best(edited, "edited-plain", None)
+    # 改动的函数第一次编译后就进了缓存，每次都要换一个新的改法才算数，这里只跑一次
+    edit = run(args.yatcc_exe, edited, output("edited"), cache, extra)
+
+    ok = True
+    checks = [
+        ("冷启动", "cold", "plain", cold, (0, nfuncs)),
+        ("全部命中", "warm", "plain", warm, (nfuncs, 0)),
+        ("改动一个函数", "edited", "edited-plain", edit, (nfuncs - 1, 1)),
+    ]
+    print(f"{'情形':<12}{'命中':>8}{'未命中':>8}{'耗时 ms':>12}{'节省':>10}")
+    print(f"{'不用缓存':<12}{'':>8}{'':>8}{plain:>12.1f}{'':>10}")
+    for title, name, expect_name, (total, hits, misses), counts in checks:
+        base = edited_plain if name == "edited" else plain
+        print(
+            f"{title:<12}{hits:>8}{misses:>8}{total:>12.1f}"
+            f"{(base - total) / base:>10.0%}"
+        )
+        if (hits, misses) != counts:
+            print(f"不符：{title}应当命中 {counts[0]} 个、未命中 {counts[1]} 个")
+            ok = False
+        if not same(output(name), output(expect_name)):
+            print(f"不一致：{title}的输出与不用缓存时不同")
+            ok = False
+
+    if not ok:
+        sys.exit(1)
+    print("一致")